@@ -74,6 +74,6 @@ end
 find_tcltk
 
 # Source files for the extension
-$srcs = ['tcltkbridge.c', 'tkphoto.c', 'tkfont.c', 'tkwin.c', 'tkeventsource.c']
+$srcs = ['tcltkbridge.c', 'tkphoto.c', 'tkfont.c', 'tkwin.c', 'tkeventsource.c', 'tkbatch.c', 'tclobj.c', 'tclscript.c', 'tclfuture.c', 'tkframes.c', 'tkstats.c', 'tkvars.c', 'tkwidgets.c', 'tktimer.c', 'tkcallbacks.c', 'tkcoalesce.c', 'tkiowatch.c']
 
 create_makefile('tcltklib')
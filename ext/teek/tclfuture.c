@@ -0,0 +1,327 @@
+/*
+ * tclfuture.c - Results of asynchronous cross-thread requests
+ *
+ * Interp#tcl_eval_async / #tcl_invoke_async queue a request from a
+ * background thread without waiting for it and return a Teek::Future.
+ * The future takes the place of the sleeping thread in the request's
+ * ring slot: when the main thread finishes the request it stores the
+ * reply here, frees the slot, and wakes whoever is waiting on #value.
+ *
+ * Like the ring, a future's state is only touched while holding the
+ * GVL, so no separate lock is needed.
+ */
+
+#include "tcltkbridge.h"
+
+static VALUE cFuture;
+
+struct tcl_future {
+    VALUE interp;       /* Owning Teek::Interp (GC-marked) */
+    int done;
+    VALUE value;        /* Result once done (GC-marked) */
+    VALUE exception;    /* Exception once done, or Qnil (GC-marked) */
+    VALUE waiters;      /* Threads sleeping in #wait/#value, or Qnil (GC-marked) */
+    VALUE callbacks;    /* [block, Future] pairs from #then, or Qnil (GC-marked) */
+};
+
+/* ---------------------------------------------------------
+ * TypedData functions
+ * --------------------------------------------------------- */
+
+static void
+future_mark(void *ptr)
+{
+    struct tcl_future *f = ptr;
+    rb_gc_mark(f->interp);
+    rb_gc_mark(f->value);
+    rb_gc_mark(f->exception);
+    rb_gc_mark(f->waiters);
+    rb_gc_mark(f->callbacks);
+}
+
+static size_t
+future_memsize(const void *ptr)
+{
+    return sizeof(struct tcl_future);
+}
+
+static const rb_data_type_t future_type = {
+    .wrap_struct_name = "Teek::Future",
+    .function = {
+        .dmark = future_mark,
+        .dfree = RUBY_TYPED_DEFAULT_FREE,
+        .dsize = future_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static struct tcl_future *
+get_future(VALUE self)
+{
+    struct tcl_future *f;
+    TypedData_Get_Struct(self, struct tcl_future, &future_type, f);
+    return f;
+}
+
+/* ---------------------------------------------------------
+ * Shared helpers (declared in tcltkbridge.h)
+ * --------------------------------------------------------- */
+
+VALUE
+teek_future_new(VALUE interp)
+{
+    struct tcl_future *f;
+    VALUE self = TypedData_Make_Struct(cFuture, struct tcl_future, &future_type, f);
+
+    f->interp = interp;
+    f->done = 0;
+    f->value = Qnil;
+    f->exception = Qnil;
+    f->waiters = Qnil;
+    f->callbacks = Qnil;
+    return self;
+}
+
+int
+teek_future_p(VALUE val)
+{
+    return !SPECIAL_CONST_P(val) && rb_typeddata_is_kind_of(val, &future_type);
+}
+
+static VALUE
+call_then_block(VALUE arg)
+{
+    VALUE *pair = (VALUE *)arg;
+    return rb_proc_call(pair[0], rb_ary_new3(1, pair[1]));
+}
+
+/* Settle a #then-derived future from its source's outcome */
+static void
+run_then(VALUE block, VALUE derived, VALUE value, VALUE exception)
+{
+    VALUE pair[2];
+    VALUE result;
+    int state = 0;
+
+    if (!NIL_P(exception)) {
+        teek_future_resolve(derived, Qnil, exception);
+        return;
+    }
+
+    pair[0] = block;
+    pair[1] = value;
+    result = rb_protect(call_then_block, (VALUE)pair, &state);
+    if (state) {
+        VALUE err = rb_errinfo();
+        rb_set_errinfo(Qnil);
+        teek_future_resolve(derived, Qnil, err);
+    } else {
+        teek_future_resolve(derived, result, Qnil);
+    }
+}
+
+void
+teek_future_resolve(VALUE self, VALUE value, VALUE exception)
+{
+    struct tcl_future *f = get_future(self);
+    VALUE waiters, callbacks;
+    long i;
+
+    if (f->done) return;
+    f->done = 1;
+    f->value = value;
+    f->exception = exception;
+
+    waiters = f->waiters;
+    callbacks = f->callbacks;
+    f->waiters = Qnil;
+    f->callbacks = Qnil;
+
+    if (!NIL_P(waiters)) {
+        for (i = 0; i < RARRAY_LEN(waiters); i++) {
+            rb_thread_wakeup_alive(RARRAY_AREF(waiters, i));
+        }
+    }
+    if (!NIL_P(callbacks)) {
+        for (i = 0; i < RARRAY_LEN(callbacks); i++) {
+            VALUE entry = RARRAY_AREF(callbacks, i);
+            run_then(RARRAY_AREF(entry, 0), RARRAY_AREF(entry, 1), value, exception);
+        }
+    }
+}
+
+/* ---------------------------------------------------------
+ * Waiting
+ * --------------------------------------------------------- */
+
+struct future_waiter {
+    VALUE self;
+    struct tcl_future *f;
+    VALUE thread;
+    Tcl_WideInt deadline;   /* teek_now_us() deadline, or -1 for none */
+};
+
+static VALUE
+future_wait_body(VALUE arg)
+{
+    struct future_waiter *w = (struct future_waiter *)arg;
+
+    if (NIL_P(w->f->waiters)) {
+        w->f->waiters = rb_ary_new();
+    }
+    rb_ary_push(w->f->waiters, w->thread);
+
+    while (!w->f->done) {
+        if (w->deadline < 0) {
+            rb_thread_sleep_forever();
+        } else {
+            Tcl_WideInt left = w->deadline - teek_now_us();
+            struct timeval tv;
+
+            if (left <= 0) break;
+            tv.tv_sec = (time_t)(left / 1000000);
+            tv.tv_usec = (long)(left % 1000000);
+            rb_thread_wait_for(tv);
+        }
+    }
+    return Qnil;
+}
+
+static VALUE
+future_wait_ensure(VALUE arg)
+{
+    struct future_waiter *w = (struct future_waiter *)arg;
+
+    /* A stale entry would wake this thread out of some later sleep */
+    if (!NIL_P(w->f->waiters)) {
+        rb_ary_delete(w->f->waiters, w->thread);
+    }
+    return Qnil;
+}
+
+/* Wait until done or timeout (seconds, < 0 for none). Returns done. */
+static int
+future_await(VALUE self, double timeout)
+{
+    struct tcl_future *f = get_future(self);
+    struct tcltk_interp *tip;
+    struct future_waiter w;
+
+    if (f->done) return 1;
+
+    tip = get_interp(f->interp);
+    if (Tcl_GetCurrentThread() == tip->main_thread_id) {
+        /* Nobody else can run the request: drain the queue here */
+        while (!f->done) {
+            if (!teek_drain_requests(tip)) {
+                rb_raise(eTclError,
+                         "future can't complete: its request is already running on this thread");
+            }
+        }
+        return 1;
+    }
+
+    w.self = self;
+    w.f = f;
+    w.thread = rb_thread_current();
+    w.deadline = timeout < 0 ? -1 : teek_now_us() + (Tcl_WideInt)(timeout * 1e6);
+    rb_ensure(future_wait_body, (VALUE)&w, future_wait_ensure, (VALUE)&w);
+    return f->done;
+}
+
+/* ---------------------------------------------------------
+ * Ruby methods
+ * --------------------------------------------------------- */
+
+/*
+ * Future#value -> Object
+ *
+ * Waits for the request and returns its result, or raises the error it
+ * failed with (a Teek::TclError for Tcl errors). On the main thread the
+ * queued requests are run in place rather than waited for.
+ */
+static VALUE
+future_value(VALUE self)
+{
+    struct tcl_future *f = get_future(self);
+
+    future_await(self, -1.0);
+    if (!NIL_P(f->exception)) {
+        rb_exc_raise(f->exception);
+    }
+    return f->value;
+}
+
+/*
+ * Future#wait(timeout = nil) -> self or nil
+ *
+ * Waits up to timeout seconds (forever when nil). Returns self once the
+ * request has finished, nil on timeout. Never raises the request's error.
+ */
+static VALUE
+future_wait(int argc, VALUE *argv, VALUE self)
+{
+    VALUE timeout;
+    double secs = -1.0;
+
+    rb_scan_args(argc, argv, "01", &timeout);
+    if (!NIL_P(timeout)) {
+        secs = NUM2DBL(timeout);
+        if (secs < 0) secs = 0;
+    }
+    return future_await(self, secs) ? self : Qnil;
+}
+
+/*
+ * Future#done? -> true/false
+ */
+static VALUE
+future_done_p(VALUE self)
+{
+    return get_future(self)->done ? Qtrue : Qfalse;
+}
+
+/*
+ * Future#then { |value| ... } -> Future
+ *
+ * Returns a future for the block's result. The block runs on the main
+ * thread as soon as the request finishes, so it may touch Tk; if this
+ * future is already done it runs right away on the calling thread.
+ * Errors skip the block and pass through to the returned future.
+ */
+static VALUE
+future_then(VALUE self)
+{
+    struct tcl_future *f = get_future(self);
+    VALUE block, derived;
+
+    rb_need_block();
+    block = rb_block_proc();
+    derived = teek_future_new(f->interp);
+
+    if (f->done) {
+        run_then(block, derived, f->value, f->exception);
+    } else {
+        if (NIL_P(f->callbacks)) {
+            f->callbacks = rb_ary_new();
+        }
+        rb_ary_push(f->callbacks, rb_assoc_new(block, derived));
+    }
+    return derived;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tclfuture(VALUE mTeek)
+{
+    cFuture = rb_define_class_under(mTeek, "Future", rb_cObject);
+    rb_undef_alloc_func(cFuture);  /* Only created by the *_async methods */
+
+    rb_define_method(cFuture, "value", future_value, 0);
+    rb_define_method(cFuture, "wait", future_wait, -1);
+    rb_define_method(cFuture, "done?", future_done_p, 0);
+    rb_define_method(cFuture, "then", future_then, 0);
+}
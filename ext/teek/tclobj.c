@@ -0,0 +1,309 @@
+/*
+ * tclobj.c - Persistent Tcl_Obj handles
+ *
+ * Teek::TclObj holds a reference to a Tcl_Obj so its internal
+ * representation (parsed list, numeric value, resolved command name,
+ * bytecode) survives between calls. Handles are accepted anywhere
+ * tcl_invoke, command or batch take an argument, including the command
+ * word, and are passed to Tcl as-is instead of being rebuilt from a
+ * string each time.
+ *
+ * Tcl_Objs belong to the thread that created them. A handle can only
+ * be used on its owning thread; if the GC frees one elsewhere the
+ * final Tcl_DecrRefCount is sent back to the owner as a Tcl event.
+ */
+
+#include "tcltkbridge.h"
+
+static VALUE cTclObj;
+
+struct tcl_obj_handle {
+    Tcl_Obj *obj;           /* One reference held while non-NULL */
+    Tcl_ThreadId owner;     /* Thread the Tcl_Obj belongs to */
+};
+
+/* Event used to release a handle's Tcl_Obj on its owning thread */
+struct tcl_obj_release_event {
+    Tcl_Event event;
+    Tcl_Obj *obj;
+};
+
+/* ---------------------------------------------------------
+ * TypedData functions
+ * --------------------------------------------------------- */
+
+static int
+release_event_proc(Tcl_Event *evPtr, int flags)
+{
+    struct tcl_obj_release_event *ev = (struct tcl_obj_release_event *)evPtr;
+    Tcl_DecrRefCount(ev->obj);
+    return 1;
+}
+
+void
+teek_release_tcl_obj(Tcl_Obj *obj, Tcl_ThreadId owner)
+{
+    if (owner == Tcl_GetCurrentThread()) {
+        Tcl_DecrRefCount(obj);
+    } else {
+        /* No Ruby API here - ckalloc and the notifier are safe from dfree */
+        struct tcl_obj_release_event *ev =
+            (struct tcl_obj_release_event *)ckalloc(sizeof(*ev));
+        ev->event.proc = release_event_proc;
+        ev->obj = obj;
+        Tcl_ThreadQueueEvent(owner, (Tcl_Event *)ev, TCL_QUEUE_TAIL);
+        Tcl_ThreadAlert(owner);
+    }
+}
+
+static void
+tclobj_free(void *ptr)
+{
+    struct tcl_obj_handle *h = ptr;
+
+    if (h->obj) {
+        teek_release_tcl_obj(h->obj, h->owner);
+    }
+    xfree(h);
+}
+
+static size_t
+tclobj_memsize(const void *ptr)
+{
+    const struct tcl_obj_handle *h = ptr;
+    size_t size = sizeof(struct tcl_obj_handle);
+
+    if (h->obj) {
+        size += sizeof(Tcl_Obj);
+        if (h->obj->bytes) size += (size_t)h->obj->length;
+    }
+    return size;
+}
+
+static const rb_data_type_t tclobj_type = {
+    .wrap_struct_name = "Teek::TclObj",
+    .function = {
+        .dmark = NULL,  /* No Ruby VALUEs to mark */
+        .dfree = tclobj_free,
+        .dsize = tclobj_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+tclobj_alloc(VALUE klass)
+{
+    struct tcl_obj_handle *h;
+    VALUE self = TypedData_Make_Struct(klass, struct tcl_obj_handle, &tclobj_type, h);
+    h->obj = NULL;
+    h->owner = NULL;
+    return self;
+}
+
+static struct tcl_obj_handle *
+get_handle(VALUE self)
+{
+    struct tcl_obj_handle *h;
+
+    TypedData_Get_Struct(self, struct tcl_obj_handle, &tclobj_type, h);
+    if (h->obj == NULL) {
+        rb_raise(eTclError, "uninitialized Teek::TclObj");
+    }
+    if (h->owner != Tcl_GetCurrentThread()) {
+        rb_raise(eTclError, "Teek::TclObj used from a thread other than the one that created it");
+    }
+    return h;
+}
+
+static void
+handle_set(struct tcl_obj_handle *h, Tcl_Obj *obj)
+{
+    Tcl_IncrRefCount(obj);
+    h->obj = obj;
+    h->owner = Tcl_GetCurrentThread();
+}
+
+/* ---------------------------------------------------------
+ * Shared helpers (declared in tcltkbridge.h)
+ * --------------------------------------------------------- */
+
+Tcl_Obj *
+teek_tclobj_ptr(VALUE val)
+{
+    if (SPECIAL_CONST_P(val) || !rb_typeddata_is_kind_of(val, &tclobj_type)) {
+        return NULL;
+    }
+    return get_handle(val)->obj;
+}
+
+VALUE
+teek_tclobj_new(Tcl_Obj *obj)
+{
+    VALUE self = tclobj_alloc(cTclObj);
+    struct tcl_obj_handle *h;
+
+    TypedData_Get_Struct(self, struct tcl_obj_handle, &tclobj_type, h);
+    handle_set(h, obj);
+    return self;
+}
+
+/* ---------------------------------------------------------
+ * Ruby methods
+ * --------------------------------------------------------- */
+
+struct convert_state {
+    struct tcl_obj_handle *h;
+    Tcl_Obj *list;
+    VALUE value;
+};
+
+static VALUE
+convert_body(VALUE arg)
+{
+    struct convert_state *st = (struct convert_state *)arg;
+    Tcl_Obj *elem;
+
+    teek_append_ruby_value(NULL, st->list, st->value);
+    Tcl_ListObjIndex(NULL, st->list, 0, &elem);
+    handle_set(st->h, elem);
+    return Qnil;
+}
+
+static VALUE
+convert_cleanup(VALUE arg)
+{
+    struct convert_state *st = (struct convert_state *)arg;
+    Tcl_DecrRefCount(st->list);
+    return Qnil;
+}
+
+/*
+ * TclObj.new(value) -> TclObj
+ *
+ * Converts value with the same rules as Interp#command (Integer, Float,
+ * Array -> list, Symbol, nil, another TclObj, else to_s). Procs are
+ * rejected since there is no interpreter to register them with.
+ */
+static VALUE
+tclobj_initialize(VALUE self, VALUE value)
+{
+    struct convert_state st;
+
+    TypedData_Get_Struct(self, struct tcl_obj_handle, &tclobj_type, st.h);
+    if (st.h->obj) {
+        rb_raise(eTclError, "Teek::TclObj already initialized");
+    }
+
+    /* Convert into a temporary list so nested values can't leak on raise */
+    st.list = Tcl_NewListObj(0, NULL);
+    st.value = value;
+    Tcl_IncrRefCount(st.list);
+    rb_ensure(convert_body, (VALUE)&st, convert_cleanup, (VALUE)&st);
+    return self;
+}
+
+/*
+ * TclObj#to_s -> String
+ *
+ * The string representation. Generating it does not discard the
+ * internal representation.
+ */
+static VALUE
+tclobj_to_s(VALUE self)
+{
+    struct tcl_obj_handle *h = get_handle(self);
+    Tcl_Size len;
+    const char *str = Tcl_GetStringFromObj(h->obj, &len);
+    return rb_utf8_str_new(str, len);
+}
+
+/*
+ * TclObj#value(mode = :auto) -> Object
+ *
+ * Convert to Ruby using a result: mode (see Interp#tcl_eval).
+ */
+static VALUE
+tclobj_value(int argc, VALUE *argv, VALUE self)
+{
+    struct tcl_obj_handle *h = get_handle(self);
+    VALUE mode;
+
+    rb_scan_args(argc, argv, "01", &mode);
+    return teek_tcl_to_ruby(h->obj,
+        NIL_P(mode) ? TEEK_RESULT_AUTO : teek_result_mode(mode));
+}
+
+/*
+ * TclObj#to_a -> Array of Strings
+ */
+static VALUE
+tclobj_to_a(VALUE self)
+{
+    struct tcl_obj_handle *h = get_handle(self);
+    return teek_tcl_to_ruby(h->obj, TEEK_RESULT_LIST);
+}
+
+/*
+ * TclObj#length -> Integer (list length; raises TclError if not a list)
+ */
+static VALUE
+tclobj_length(VALUE self)
+{
+    struct tcl_obj_handle *h = get_handle(self);
+    Tcl_Size len;
+
+    if (Tcl_ListObjLength(NULL, h->obj, &len) != TCL_OK) {
+        rb_raise(eTclError, "expected list but got \"%s\"", Tcl_GetString(h->obj));
+    }
+    return LONG2NUM((long)len);
+}
+
+/*
+ * TclObj#type -> String or nil
+ *
+ * Name of the current internal representation ("list", "int", ...),
+ * nil when the object is a pure string.
+ */
+static VALUE
+tclobj_type_name(VALUE self)
+{
+    struct tcl_obj_handle *h = get_handle(self);
+
+    if (h->obj->typePtr == NULL) return Qnil;
+    return rb_utf8_str_new_cstr(h->obj->typePtr->name);
+}
+
+static VALUE
+tclobj_init_copy(VALUE self, VALUE orig)
+{
+    struct tcl_obj_handle *h, *src;
+
+    if (self == orig) return self;
+    TypedData_Get_Struct(self, struct tcl_obj_handle, &tclobj_type, h);
+    src = get_handle(orig);
+    if (h->obj) {
+        Tcl_DecrRefCount(h->obj);
+        h->obj = NULL;
+    }
+    handle_set(h, src->obj);
+    return self;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tclobj(VALUE mTeek)
+{
+    cTclObj = rb_define_class_under(mTeek, "TclObj", rb_cObject);
+    rb_define_alloc_func(cTclObj, tclobj_alloc);
+
+    rb_define_method(cTclObj, "initialize", tclobj_initialize, 1);
+    rb_define_method(cTclObj, "initialize_copy", tclobj_init_copy, 1);
+    rb_define_method(cTclObj, "to_s", tclobj_to_s, 0);
+    rb_define_method(cTclObj, "value", tclobj_value, -1);
+    rb_define_method(cTclObj, "to_a", tclobj_to_a, 0);
+    rb_define_method(cTclObj, "length", tclobj_length, 0);
+    rb_define_method(cTclObj, "type", tclobj_type_name, 0);
+}
@@ -0,0 +1,299 @@
+/*
+ * tclscript.c - Compiled script handles
+ *
+ * Interp#compile(script) returns a Teek::Script that keeps the script in
+ * a retained Tcl_Obj. Evaluating it with Tcl_EvalObjEx lets Tcl reuse the
+ * bytecode cached in the object's internal rep instead of recompiling
+ * the source string on every tcl_eval.
+ *
+ * Scripts with params: are wrapped as an `apply` lambda; both the lambda
+ * and the `apply` command word are retained, so the compiled lambda body
+ * and the resolved command are cached across calls too.
+ *
+ * The Tcl_Objs are created on the interp's main thread, on first use if
+ * the script was compiled from a background thread.
+ */
+
+#include "tcltkbridge.h"
+
+static VALUE cScript;
+static ID id_params_kw, id_result_kw, id_call_on_main;
+
+struct tcl_script {
+    VALUE interp;        /* Owning Teek::Interp (GC-marked) */
+    VALUE source;        /* Frozen script String (GC-marked) */
+    VALUE params;        /* Frozen Array of parameter names, or nil (GC-marked) */
+    Tcl_Obj *body;       /* Script obj; bytecode cached in its internal rep */
+    Tcl_Obj *apply_cmd;  /* "apply" command word (params only) */
+    Tcl_Obj *lambda;     /* {params body} lambda (params only) */
+    Tcl_ThreadId owner;  /* Thread the Tcl_Objs belong to */
+};
+
+/* ---------------------------------------------------------
+ * TypedData functions
+ * --------------------------------------------------------- */
+
+static void
+script_mark(void *ptr)
+{
+    struct tcl_script *sc = ptr;
+    rb_gc_mark(sc->interp);
+    rb_gc_mark(sc->source);
+    rb_gc_mark(sc->params);
+}
+
+static void
+script_free(void *ptr)
+{
+    struct tcl_script *sc = ptr;
+
+    if (sc->body) teek_release_tcl_obj(sc->body, sc->owner);
+    if (sc->apply_cmd) teek_release_tcl_obj(sc->apply_cmd, sc->owner);
+    if (sc->lambda) teek_release_tcl_obj(sc->lambda, sc->owner);
+    xfree(sc);
+}
+
+static size_t
+script_memsize(const void *ptr)
+{
+    return sizeof(struct tcl_script);
+}
+
+static const rb_data_type_t script_type = {
+    .wrap_struct_name = "Teek::Script",
+    .function = {
+        .dmark = script_mark,
+        .dfree = script_free,
+        .dsize = script_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static struct tcl_script *
+get_script(VALUE self)
+{
+    struct tcl_script *sc;
+    TypedData_Get_Struct(self, struct tcl_script, &script_type, sc);
+    return sc;
+}
+
+/* Build the retained Tcl_Objs (main thread only) */
+static void
+script_prepare(struct tcl_script *sc)
+{
+    long i;
+
+    if (sc->body) return;
+
+    sc->owner = Tcl_GetCurrentThread();
+    sc->body = Tcl_NewStringObj(RSTRING_PTR(sc->source), RSTRING_LEN(sc->source));
+    Tcl_IncrRefCount(sc->body);
+
+    if (!NIL_P(sc->params)) {
+        Tcl_Obj *names = Tcl_NewListObj(0, NULL);
+        for (i = 0; i < RARRAY_LEN(sc->params); i++) {
+            VALUE name = RARRAY_AREF(sc->params, i);
+            Tcl_ListObjAppendElement(NULL, names,
+                Tcl_NewStringObj(RSTRING_PTR(name), RSTRING_LEN(name)));
+        }
+        sc->lambda = Tcl_NewListObj(0, NULL);
+        Tcl_ListObjAppendElement(NULL, sc->lambda, names);
+        Tcl_ListObjAppendElement(NULL, sc->lambda, sc->body);
+        Tcl_IncrRefCount(sc->lambda);
+
+        sc->apply_cmd = Tcl_NewStringObj("apply", -1);
+        Tcl_IncrRefCount(sc->apply_cmd);
+    }
+}
+
+/* ---------------------------------------------------------
+ * Evaluation (main thread)
+ * --------------------------------------------------------- */
+
+struct apply_state {
+    struct tcl_script *sc;
+    struct tcltk_interp *tip;
+    Tcl_Obj *cmdlist;
+    VALUE args;
+};
+
+static VALUE
+apply_body(VALUE arg)
+{
+    struct apply_state *st = (struct apply_state *)arg;
+    Tcl_Size objc;
+    Tcl_Obj **objv;
+    long i;
+
+    Tcl_ListObjAppendElement(NULL, st->cmdlist, st->sc->apply_cmd);
+    Tcl_ListObjAppendElement(NULL, st->cmdlist, st->sc->lambda);
+    for (i = 0; i < RARRAY_LEN(st->args); i++) {
+        teek_append_ruby_value(st->tip, st->cmdlist, RARRAY_AREF(st->args, i));
+    }
+
+    Tcl_ListObjGetElements(NULL, st->cmdlist, &objc, &objv);
+    return INT2FIX(Tcl_EvalObjv(st->tip->interp, objc, objv, 0));
+}
+
+static VALUE
+apply_cleanup(VALUE arg)
+{
+    struct apply_state *st = (struct apply_state *)arg;
+    Tcl_DecrRefCount(st->cmdlist);
+    return Qnil;
+}
+
+static VALUE
+script_run(VALUE self, int mode, VALUE args)
+{
+    struct tcl_script *sc = get_script(self);
+    struct tcltk_interp *tip = get_interp(sc->interp);
+    int result;
+
+    script_prepare(sc);
+
+    if (sc->lambda == NULL) {
+        if (RARRAY_LEN(args) > 0) {
+            rb_raise(rb_eArgError, "script was compiled without params: (given %ld arguments)",
+                     RARRAY_LEN(args));
+        }
+        result = Tcl_EvalObjEx(tip->interp, sc->body, 0);
+    } else {
+        struct apply_state st;
+
+        st.sc = sc;
+        st.tip = tip;
+        st.args = args;
+        st.cmdlist = Tcl_NewListObj(0, NULL);
+        Tcl_IncrRefCount(st.cmdlist);
+        result = FIX2INT(rb_ensure(apply_body, (VALUE)&st, apply_cleanup, (VALUE)&st));
+    }
+
+    if (result != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+    return teek_interp_result(tip, mode);
+}
+
+/* Private: target of calls queued from a background thread */
+static VALUE
+script_call_on_main(VALUE self, VALUE mode, VALUE args)
+{
+    return script_run(self, FIX2INT(mode), args);
+}
+
+/*
+ * Script#call(*args, result: :string) -> String (or per result:)
+ *
+ * Evaluates the compiled script. Arguments bind to the params given to
+ * Interp#compile and are converted like Interp#command arguments.
+ * Thread-safe: from a background thread the call runs on the main thread.
+ */
+static VALUE
+script_call(int argc, VALUE *argv, VALUE self)
+{
+    struct tcl_script *sc = get_script(self);
+    struct tcltk_interp *tip = get_interp(sc->interp);
+    VALUE args, opts, mode_val = Qundef;
+    int mode;
+
+    rb_scan_args(argc, argv, "*:", &args, &opts);
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, &id_result_kw, 0, 1, &mode_val);
+    }
+    mode = teek_result_mode(mode_val == Qundef ? Qnil : mode_val);
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, id_call_on_main,
+                                  rb_ary_new3(2, INT2FIX(mode), args));
+    }
+    return script_run(self, mode, args);
+}
+
+/*
+ * Script#source -> String
+ */
+static VALUE
+script_source(VALUE self)
+{
+    return get_script(self)->source;
+}
+
+/*
+ * Script#params -> Array of Strings, or nil
+ */
+static VALUE
+script_params(VALUE self)
+{
+    return get_script(self)->params;
+}
+
+/* ---------------------------------------------------------
+ * Interp#compile(script, params: nil) -> Teek::Script
+ *
+ * params: Array of parameter names (Strings or Symbols). The script
+ * then runs as the body of an `apply` lambda, so it gets its own local
+ * scope; use `global` or `upvar #0` to reach global variables.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_compile(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct tcl_script *sc;
+    VALUE source, opts, params = Qundef, obj;
+    long i;
+
+    rb_scan_args(argc, argv, "1:", &source, &opts);
+    StringValue(source);
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, &id_params_kw, 0, 1, &params);
+    }
+
+    if (params == Qundef || NIL_P(params)) {
+        params = Qnil;
+    } else {
+        VALUE names = rb_Array(params);
+        params = rb_ary_new_capa(RARRAY_LEN(names));
+        for (i = 0; i < RARRAY_LEN(names); i++) {
+            VALUE name = RARRAY_AREF(names, i);
+            rb_ary_push(params, rb_str_new_frozen(
+                SYMBOL_P(name) ? rb_sym2str(name) : StringValue(name)));
+        }
+        rb_ary_freeze(params);
+    }
+
+    obj = TypedData_Make_Struct(cScript, struct tcl_script, &script_type, sc);
+    sc->interp = self;
+    sc->source = rb_str_new_frozen(source);
+    sc->params = params;
+
+    /* Build the Tcl_Objs now when we're on the thread that will run them */
+    if (Tcl_GetCurrentThread() == tip->main_thread_id) {
+        script_prepare(sc);
+    }
+    return obj;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tclscript(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    id_params_kw = rb_intern("params");
+    id_result_kw = rb_intern("result");
+    id_call_on_main = rb_intern("__call_on_main");
+
+    cScript = rb_define_class_under(mTeek, "Script", rb_cObject);
+    rb_undef_alloc_func(cScript);  /* Only created by Interp#compile */
+    rb_define_method(cScript, "call", script_call, -1);
+    rb_define_method(cScript, "source", script_source, 0);
+    rb_define_method(cScript, "params", script_params, 0);
+    rb_define_private_method(cScript, "__call_on_main", script_call_on_main, 2);
+
+    rb_define_method(cInterp, "compile", interp_compile, -1);
+}
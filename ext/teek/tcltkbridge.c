@@ -16,6 +16,7 @@
 #include <tcl.h>
 #include <tk.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -111,12 +112,15 @@ VALUE eTclError;  /* Non-static: shared with tkphoto.c */
 
 /* Track if stubs have been initialized (once per process) */
 static int tcl_stubs_initialized = 0;
+static void init_tcl_obj_types(void);
 
-/* Lightweight Tcl interp for utility functions (split_list, make_list).
- * Created at module load time to initialize stubs and provide error
- * reporting without requiring the user to create a Teek::Interp first.
- * No Tk loaded — just bare Tcl. */
+/* Lightweight Tcl interp created at module load time to initialize
+ * stubs without requiring the user to create a Teek::Interp first.
+ * No Tk loaded — just bare Tcl. The conversion module functions
+ * (make_list, split_list, ...) parse with a NULL interp and only borrow
+ * one to word an error message; see conversion_error(). */
 static Tcl_Interp *utility_interp = NULL;
+static Tcl_ThreadId utility_interp_thread;
 
 /* Track live interpreter instances for multi-interp safety checks */
 static VALUE live_instances;  /* Ruby Array of live Teek::Interp objects */
@@ -125,11 +129,17 @@ static VALUE live_instances;  /* Ruby Array of live Teek::Interp objects */
 static int ruby_callback_proc(ClientData, Tcl_Interp *, int, Tcl_Obj *const *);
 static int ruby_eval_proc(ClientData, Tcl_Interp *, int, Tcl_Obj *const *);
 static void interp_deleted_callback(ClientData, Tcl_Interp *);
+static void ring_idle_drain(ClientData);
+static int mainloop_mode_from_sym(VALUE);
 
 /* Default timer interval for thread-aware mainloop (ms) */
 /* 16ms ≈ 60fps - balances UI responsiveness with scheduler contention */
 #define DEFAULT_TIMER_INTERVAL_MS 16
 
+/* Default time budget for one drain of the cross-thread request ring (ms) */
+/* Half a 60fps frame, so a burst of background requests can't freeze redraws */
+#define DEFAULT_DRAIN_BUDGET_MS 8
+
 /* struct tcltk_interp is defined in tcltkbridge.h */
 
 /* ---------------------------------------------------------
@@ -138,8 +148,9 @@ static void interp_deleted_callback(ClientData, Tcl_Interp *);
  * Background threads cannot safely call Tcl/Tk directly.
  * Uses Tcl's native Tcl_ThreadQueueEvent mechanism.
  *
- * Design: Command data is stored in Ruby objects (GC-protected in
- * thread_queue). The Tcl event just triggers execution.
+ * Design: requests are written into preallocated slots of a ring on the
+ * interp (tip->ring, GC-marked). At most one Tcl event is queued at a
+ * time; its handler drains every pending slot in order.
  * --------------------------------------------------------- */
 
 struct ruby_thread_event {
@@ -147,14 +158,130 @@ struct ruby_thread_event {
     struct tcltk_interp *tip;  /* Interpreter context */
 };
 
-/* Ruby Queue class for thread synchronization */
-static VALUE cQueue = Qundef;
-
 /* Track callback depth for unsafe operation detection */
 static int rbtk_callback_depth = 0;
 
 /* Callback control flow exceptions - for signaling break/continue/return to Tcl */
 
+/* ---------------------------------------------------------
+ * GVL handoff for Tcl handlers
+ *
+ * The event-driven mainloop runs Tcl_DoOneEvent without the GVL. Tcl
+ * handlers that enter Ruby (ruby_callback, ruby, the thread-queue
+ * drain) go through teek_call_with_gvl, which takes the GVL back only
+ * if this thread gave it up.
+ *
+ * An exception can't unwind through rb_thread_call_with_gvl, so there
+ * the handler runs under rb_protect and anything it lets escape (in
+ * practice SystemExit/Interrupt) is parked in deferred_exception until
+ * the mainloop holds the GVL again.
+ * --------------------------------------------------------- */
+
+struct gvl_state {
+    int released;   /* This thread is inside Tcl_DoOneEvent without the GVL */
+};
+
+static Tcl_ThreadDataKey gvl_state_key;
+
+static VALUE deferred_exception = Qnil;
+
+static struct gvl_state *
+gvl_state(void)
+{
+    return (struct gvl_state *)Tcl_GetThreadData(&gvl_state_key, sizeof(struct gvl_state));
+}
+
+struct gvl_call {
+    void *(*func)(void *);
+    void *arg;
+    void *ret;
+};
+
+static VALUE
+gvl_call_protected(VALUE arg)
+{
+    struct gvl_call *c = (struct gvl_call *)arg;
+    c->ret = c->func(c->arg);
+    return Qnil;
+}
+
+static void *
+gvl_call_body(void *arg)
+{
+    int state = 0;
+
+    rb_protect(gvl_call_protected, (VALUE)arg, &state);
+    if (state) {
+        VALUE exc = rb_errinfo();
+        rb_set_errinfo(Qnil);
+        if (NIL_P(deferred_exception)) deferred_exception = exc;
+    }
+    return NULL;
+}
+
+void *
+teek_call_with_gvl(void *(*func)(void *), void *arg)
+{
+    struct gvl_state *gs = gvl_state();
+    struct gvl_call c;
+
+    if (!gs->released) return func(arg);
+
+    c.func = func;
+    c.arg = arg;
+    c.ret = NULL;
+    gs->released = 0;
+    rb_thread_call_with_gvl(gvl_call_body, &c);
+    gs->released = 1;
+    return c.ret;
+}
+
+/* Re-raise what a handler let escape while the GVL was released */
+static void
+raise_deferred_exception(void)
+{
+    VALUE exc = deferred_exception;
+
+    if (NIL_P(exc)) return;
+    deferred_exception = Qnil;
+    rb_exc_raise(exc);
+}
+
+/* A Tcl command invocation, for running a handler through teek_call_with_gvl */
+struct tcl_cmd_call {
+    int (*proc)(ClientData, Tcl_Interp *, int, Tcl_Obj *const *);
+    ClientData clientData;
+    Tcl_Interp *interp;
+    int objc;
+    Tcl_Obj *const *objv;
+    int code;
+};
+
+static void *
+tcl_cmd_call_body(void *arg)
+{
+    struct tcl_cmd_call *c = (struct tcl_cmd_call *)arg;
+    c->code = c->proc(c->clientData, c->interp, c->objc, c->objv);
+    return NULL;
+}
+
+static int
+tcl_cmd_with_gvl(int (*proc)(ClientData, Tcl_Interp *, int, Tcl_Obj *const *),
+                 ClientData clientData, Tcl_Interp *interp,
+                 int objc, Tcl_Obj *const objv[])
+{
+    struct tcl_cmd_call c;
+
+    c.proc = proc;
+    c.clientData = clientData;
+    c.interp = interp;
+    c.objc = objc;
+    c.objv = objv;
+    c.code = TCL_ERROR;  /* Kept if the handler raised */
+    teek_call_with_gvl(tcl_cmd_call_body, &c);
+    return c.code;
+}
+
 /* ---------------------------------------------------------
  * Memory management
  * --------------------------------------------------------- */
@@ -163,17 +290,61 @@ static void
 interp_mark(void *ptr)
 {
     struct tcltk_interp *tip = ptr;
-    rb_gc_mark(tip->callbacks);    /* Mark callback procs so GC doesn't collect them */
-    rb_gc_mark(tip->thread_queue); /* Mark procs queued from other threads */
+    long i;
+
+    /* Mark callback procs so GC doesn't collect them */
+    for (i = 0; i < tip->cb_used; i++) {
+        rb_gc_mark(tip->cb_slots[i].proc);
+        rb_gc_mark(tip->cb_slots[i].site);
+    }
+
+    /* Mark requests queued from other threads */
+    if (tip->ring) {
+        for (i = 0; i < THREAD_RING_SIZE; i++) {
+            struct thread_request *req = &tip->ring[i];
+            if (req->state == THREAD_REQ_FREE) continue;
+            rb_gc_mark(req->type);
+            rb_gc_mark(req->payload);
+            rb_gc_mark(req->waiter);
+            rb_gc_mark(req->result);
+            rb_gc_mark(req->exception);
+        }
+    }
+
+    teek_var_traces_mark(tip);
+    teek_widgets_mark(tip);
+    teek_timers_mark(tip);
+    teek_io_watches_mark(tip);
 }
 
 static void
 interp_free(void *ptr)
 {
     struct tcltk_interp *tip = ptr;
+    long i;
+
     if (tip->interp && !tip->deleted) {
         Tcl_DeleteInterp(tip->interp);
     }
+    teek_var_traces_free(tip);
+    teek_widgets_free(tip);
+    teek_timers_free(tip);
+    teek_io_watches_free(tip);
+    teek_callbacks_free(tip);
+    teek_coalesce_free(tip);
+    for (i = 0; i < tip->cb_used; i++) {
+        xfree(tip->cb_slots[i].types);
+    }
+    xfree(tip->cb_slots);
+    if (tip->cb_by_proc) {
+        Tcl_DeleteHashTable(tip->cb_by_proc);
+        ckfree((char *)tip->cb_by_proc);
+    }
+    teek_retired_stats_clear(tip);
+    if (tip->ring_event_pending) {
+        Tcl_CancelIdleCall(ring_idle_drain, (ClientData)tip);
+    }
+    xfree(tip->ring);
     xfree(tip);
 }
 
@@ -197,7 +368,10 @@ interp_deleted_callback(ClientData clientData, Tcl_Interp *interp)
 static size_t
 interp_memsize(const void *ptr)
 {
-    return sizeof(struct tcltk_interp);
+    const struct tcltk_interp *tip = ptr;
+    return sizeof(struct tcltk_interp) +
+           (size_t)tip->cb_capa * sizeof(struct callback_slot) +
+           (tip->ring ? THREAD_RING_SIZE * sizeof(struct thread_request) : 0);
 }
 
 /* Non-static: shared with tkphoto.c */
@@ -218,10 +392,31 @@ interp_alloc(VALUE klass)
     VALUE obj = TypedData_Make_Struct(klass, struct tcltk_interp, &interp_type, tip);
     tip->interp = NULL;
     tip->deleted = 0;
-    tip->callbacks = rb_hash_new();
-    tip->thread_queue = rb_ary_new();
-    tip->next_id = 1;
+    tip->cb_slots = NULL;
+    tip->cb_capa = 0;
+    tip->cb_used = 0;
+    tip->cb_free = -1;
+    tip->cb_by_proc = NULL;
+    tip->cb_retired = NULL;
+    memset(&tip->cb_counts, 0, sizeof(tip->cb_counts));
+    tip->cb_collect = NULL;
+    tip->cb_owners = NULL;
+    tip->ring = NULL;
+    tip->ring_head = 0;
+    tip->ring_tail = 0;
+    tip->ring_event_pending = 0;
+    tip->drain_budget_ms = DEFAULT_DRAIN_BUDGET_MS;
+    memset(&tip->tq_stats, 0, sizeof(tip->tq_stats));
+    memset(&tip->loop_stats, 0, sizeof(tip->loop_stats));
     tip->timer_interval_ms = DEFAULT_TIMER_INTERVAL_MS;
+    tip->mainloop_event_driven = 0;
+    tip->frame_loop_active = 0;
+    tip->frame_cb_us = 0;
+    tip->var_traces = NULL;
+    tip->widgets = NULL;
+    tip->timers = NULL;
+    tip->coalesce = NULL;
+    tip->io_watches = NULL;
     tip->main_thread_id = NULL;
     return obj;
 }
@@ -257,6 +452,13 @@ get_interp(VALUE self)
  *                      - 20ms: Minimal CPU, noticeable latency for threads
  *                      - 0:    Disable timer (threads won't run during mainloop)
  *
+ *   :mainloop_mode - :timer (default) or :event; see Interp#mainloop_mode=
+ *
+ *   :thread_drain_budget_ms - Max time one pass over requests queued from
+ *                      background threads may take (default: 8). The rest
+ *                      runs from an idle callback so redraws aren't starved.
+ *                      0 drains everything in one go.
+ *
  * Initialization order (verified empirically on Tcl/Tk 9.0.3):
  * 1. Tcl_FindExecutable - sets up internal paths (NOT stubbed)
  * 2. Tcl_CreateInterp - create interpreter (NOT stubbed)
@@ -284,6 +486,9 @@ interp_initialize(int argc, VALUE *argv, VALUE self)
     /* Parse legacy (name, opts) or new (opts) argument forms */
     rb_scan_args(argc, argv, "02", &name, &opts);
     /* name is ignored - kept for legacy compatibility */
+    if (NIL_P(opts) && RB_TYPE_P(name, T_HASH)) {
+        opts = name;  /* Interp.new(thread_timer_ms: ...) */
+    }
 
     /* Check for options in opts hash */
     if (!NIL_P(opts) && TYPE(opts) == T_HASH) {
@@ -295,6 +500,18 @@ interp_initialize(int argc, VALUE *argv, VALUE self)
             }
             tip->timer_interval_ms = ms;
         }
+        val = rb_hash_aref(opts, ID2SYM(rb_intern("mainloop_mode")));
+        if (!NIL_P(val)) {
+            tip->mainloop_event_driven = mainloop_mode_from_sym(val);
+        }
+        val = rb_hash_aref(opts, ID2SYM(rb_intern("thread_drain_budget_ms")));
+        if (!NIL_P(val)) {
+            int ms = NUM2INT(val);
+            if (ms < 0) {
+                rb_raise(rb_eArgError, "thread_drain_budget_ms must be >= 0 (got %d)", ms);
+            }
+            tip->drain_budget_ms = ms;
+        }
     }
 
     /* 1. Tell Tcl where to find itself (once per process) */
@@ -351,6 +568,10 @@ interp_initialize(int argc, VALUE *argv, VALUE self)
         rb_raise(eTclError, "Tk_InitStubs failed: %s", err);
     }
 
+    /* Hooks for Interp#stats event classification (once per thread) */
+    teek_stats_install();
+
+    if (!tcl_stubs_initialized) init_tcl_obj_types();
     tcl_stubs_initialized = 1;
 
     /* 8. Register Tcl commands for Ruby integration */
@@ -360,6 +581,7 @@ interp_initialize(int argc, VALUE *argv, VALUE self)
                          ruby_eval_proc, (ClientData)tip, NULL);
     Tcl_CreateObjCommand(tip->interp, "ruby_eval",
                          ruby_eval_proc, (ClientData)tip, NULL);
+    teek_coalesce_install(tip);
 
     /* 9. Register callback for when Tcl deletes this interpreter */
     Tcl_CallWhenDeleted(tip->interp, interp_deleted_callback, (ClientData)tip);
@@ -373,6 +595,188 @@ interp_initialize(int argc, VALUE *argv, VALUE self)
     return self;
 }
 
+/* ---------------------------------------------------------
+ * Callback table
+ *
+ * Procs live in a slot array on the interp. Freed slots go on a
+ * free list and are reused; the generation packed into the id makes
+ * a stale id miss instead of calling the slot's new proc.
+ *
+ * Procs converted as command arguments are also indexed by identity
+ * in cb_by_proc, so passing the same Proc again reuses its id, and
+ * may be owned by widgets (tkcallbacks.c) that free them on destroy.
+ * --------------------------------------------------------- */
+
+static struct callback_slot *
+callback_lookup(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    long idx = CALLBACK_IDX(id);
+    struct callback_slot *slot;
+
+    if (id <= 0 || idx < 0 || idx >= tip->cb_used) return NULL;
+    slot = &tip->cb_slots[idx];
+    if (NIL_P(slot->proc) || slot->generation != CALLBACK_GEN(id)) return NULL;
+    return slot;
+}
+
+static Tcl_WideInt
+register_callback_internal(struct tcltk_interp *tip, VALUE proc)
+{
+    struct callback_slot *slot;
+    long idx;
+
+    if (tip->cb_free >= 0) {
+        idx = tip->cb_free;
+        slot = &tip->cb_slots[idx];
+        tip->cb_free = slot->next_free;
+    } else {
+        if (tip->cb_used == tip->cb_capa) {
+            long capa;
+            if (tip->cb_capa >= 0x40000000L) {
+                rb_raise(eTclError, "too many registered callbacks");
+            }
+            capa = tip->cb_capa ? tip->cb_capa * 2 : 64;
+            REALLOC_N(tip->cb_slots, struct callback_slot, capa);
+            tip->cb_capa = capa;
+        }
+        idx = tip->cb_used;
+        slot = &tip->cb_slots[idx];
+        slot->generation = 0;
+        slot->proc = Qnil;
+        slot->site = Qnil;
+        slot->types = NULL;
+        slot->ntypes = 0;
+        slot->owners = 0;
+        tip->cb_used++;
+    }
+
+    slot->proc = proc;
+    slot->next_free = -1;
+    slot->calls = 0;
+    slot->total_us = 0;
+    slot->max_us = 0;
+    slot->errors = 0;
+    slot->site = Qnil;
+    slot->owners = 0;
+    slot->pinned = 0;
+    slot->shared = 0;
+    tip->cb_counts.registered++;
+    return CALLBACK_ID(idx, slot->generation);
+}
+
+/* The retired total for site (nil is keyed as ""), created on first use */
+static struct teek_retired_stats *
+retired_stats_for(struct tcltk_interp *tip, VALUE site)
+{
+    struct teek_retired_stats *rs;
+    Tcl_HashEntry *entry;
+    int is_new;
+
+    if (tip->cb_retired == NULL) {
+        tip->cb_retired = (Tcl_HashTable *)ckalloc(sizeof(Tcl_HashTable));
+        Tcl_InitHashTable(tip->cb_retired, TCL_STRING_KEYS);
+    }
+    entry = Tcl_CreateHashEntry(tip->cb_retired,
+                                NIL_P(site) ? "" : StringValueCStr(site), &is_new);
+    if (is_new) {
+        rs = (struct teek_retired_stats *)ckalloc(sizeof(*rs));
+        memset(rs, 0, sizeof(*rs));
+        Tcl_SetHashValue(entry, rs);
+    } else {
+        rs = (struct teek_retired_stats *)Tcl_GetHashValue(entry);
+    }
+    return rs;
+}
+
+void
+teek_retired_stats_clear(struct tcltk_interp *tip)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *entry;
+
+    if (tip->cb_retired == NULL) return;
+    for (entry = Tcl_FirstHashEntry(tip->cb_retired, &search); entry;
+         entry = Tcl_NextHashEntry(&search)) {
+        ckfree((char *)Tcl_GetHashValue(entry));
+    }
+    Tcl_DeleteHashTable(tip->cb_retired);
+    ckfree((char *)tip->cb_retired);
+    tip->cb_retired = NULL;
+}
+
+static void
+unregister_callback_internal(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    struct callback_slot *slot = callback_lookup(tip, id);
+
+    if (!slot) return;
+    if (slot->calls > 0) {
+        struct teek_retired_stats *rs = retired_stats_for(tip, slot->site);
+        rs->calls += slot->calls;
+        rs->total_us += slot->total_us;
+        if (slot->max_us > rs->max_us) rs->max_us = slot->max_us;
+        rs->errors += slot->errors;
+    }
+    if (slot->shared) {
+        Tcl_HashEntry *entry = Tcl_FindHashEntry(tip->cb_by_proc, (char *)slot->proc);
+        if (entry) Tcl_DeleteHashEntry(entry);
+    }
+    if (slot->owners > 0) tip->cb_counts.owned--;
+    tip->cb_counts.released++;
+    slot->proc = Qnil;
+    slot->site = Qnil;
+    xfree(slot->types);
+    slot->types = NULL;
+    slot->ntypes = 0;
+    slot->generation = (slot->generation + 1) & CALLBACK_GEN_MASK;
+    slot->next_free = tip->cb_free;
+    tip->cb_free = CALLBACK_IDX(id);
+    slot->owners = 0;
+    slot->pinned = 0;
+    slot->shared = 0;
+}
+
+/* Id for a Proc converted as a command argument: the one it already
+ * has if it was converted before, else a new registration. */
+static Tcl_WideInt
+proc_callback_id(struct tcltk_interp *tip, VALUE proc, int *fresh)
+{
+    Tcl_HashEntry *entry;
+    struct callback_slot *slot;
+    Tcl_WideInt id;
+    long idx;
+    int is_new;
+
+    if (tip->cb_by_proc == NULL) {
+        tip->cb_by_proc = (Tcl_HashTable *)ckalloc(sizeof(Tcl_HashTable));
+        Tcl_InitHashTable(tip->cb_by_proc, TCL_ONE_WORD_KEYS);
+    }
+
+    /* Registered procs are GC-marked, so never moved by compaction.
+     * The entry holds the slot index; unregister removes it. */
+    entry = Tcl_FindHashEntry(tip->cb_by_proc, (char *)proc);
+    if (entry) {
+        idx = (long)(intptr_t)Tcl_GetHashValue(entry);
+        slot = &tip->cb_slots[idx];
+        tip->cb_counts.reused++;
+        *fresh = 0;
+        return CALLBACK_ID(idx, slot->generation);
+    }
+
+    id = register_callback_internal(tip, proc);  /* may raise */
+    callback_lookup(tip, id)->shared = 1;
+    entry = Tcl_CreateHashEntry(tip->cb_by_proc, (char *)proc, &is_new);
+    Tcl_SetHashValue(entry, (ClientData)(intptr_t)CALLBACK_IDX(id));
+    *fresh = 1;
+    return id;
+}
+
+struct callback_slot *
+teek_callback_slot(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    return callback_lookup(tip, id);
+}
+
 /* ---------------------------------------------------------
  * ruby_callback - Tcl command that invokes Ruby procs
  *
@@ -393,45 +797,60 @@ callback_invoke(VALUE varg)
     return rb_proc_call(cargs->proc, cargs->args);
 }
 
-static int
-ruby_callback_proc(ClientData clientData, Tcl_Interp *interp,
-                   int objc, Tcl_Obj *const objv[])
+/* Charge a finished call to its slot and the loop stats. A callback
+ * that released itself while running (a one-shot timer, say) is charged
+ * to its site's retired total instead; site was read before the call. */
+static void
+callback_account(struct tcltk_interp *tip, Tcl_WideInt id, VALUE site,
+                 Tcl_WideInt us, int failed)
 {
-    struct tcltk_interp *tip = (struct tcltk_interp *)clientData;
-    VALUE id_str, proc, args, result;
-    struct callback_args cargs;
-    int i, state;
-
-    if (objc < 2) {
-        Tcl_SetResult(interp, "wrong # args: should be \"ruby_callback id ?args?\"",
-                      TCL_STATIC);
-        return TCL_ERROR;
+    struct callback_slot *slot = callback_lookup(tip, id);
+    struct teek_loop_stats *st = &tip->loop_stats;
+
+    if (slot) {
+        slot->calls++;
+        slot->total_us += us;
+        if (us > slot->max_us) slot->max_us = us;
+        if (failed) slot->errors++;
+    } else if (id > 0) {
+        struct teek_retired_stats *rs = retired_stats_for(tip, site);
+        rs->calls++;
+        rs->total_us += us;
+        if (us > rs->max_us) rs->max_us = us;
+        if (failed) rs->errors++;
     }
-
-    /* Look up proc by ID */
-    id_str = rb_utf8_str_new_cstr(Tcl_GetString(objv[1]));
-    proc = rb_hash_aref(tip->callbacks, id_str);
-
-    if (NIL_P(proc)) {
-        Tcl_SetObjResult(interp, Tcl_ObjPrintf("unknown callback id: %s",
-                         Tcl_GetString(objv[1])));
-        return TCL_ERROR;
+    st->callbacks++;
+    teek_hist_add(&st->callback_hist, us);
+
+    /* Nested callbacks are already inside the outer one's time */
+    if (rbtk_callback_depth == 0) {
+        st->callback_us += us;
+        /* run_frames reports the callback share of each frame */
+        if (tip->frame_loop_active) tip->frame_cb_us += us;
     }
+}
 
-    /* Build args array */
-    args = rb_ary_new2(objc - 2);
-    for (i = 2; i < objc; i++) {
-        Tcl_Size len;
-        const char *str = Tcl_GetStringFromObj(objv[i], &len);
-        rb_ary_push(args, rb_utf8_str_new(str, len));
-    }
+/* Call proc with args under rb_protect and charge the time to callback
+ * id. Returns the proc's result, or Qundef with the exception message
+ * as interp's result. SystemExit and Interrupt propagate. */
+static VALUE
+run_callback_proc(struct tcltk_interp *tip, Tcl_Interp *interp, Tcl_WideInt id,
+                  VALUE proc, VALUE args)
+{
+    struct callback_args cargs;
+    struct callback_slot *slot = callback_lookup(tip, id);
+    volatile VALUE site = slot ? slot->site : Qnil;
+    Tcl_WideInt start;
+    VALUE result;
+    int state;
 
-    /* Call the proc with exception protection */
     cargs.proc = proc;
     cargs.args = args;
+    start = teek_now_us();
     rbtk_callback_depth++;
     result = rb_protect(callback_invoke, (VALUE)&cargs, &state);
     rbtk_callback_depth--;
+    callback_account(tip, id, site, teek_now_us() - start, state != 0);
 
     if (state) {
         VALUE errinfo = rb_errinfo();
@@ -446,8 +865,102 @@ ruby_callback_proc(ClientData clientData, Tcl_Interp *interp,
         /* Other exceptions: convert to Tcl error */
         VALUE msg = rb_funcall(errinfo, rb_intern("message"), 0);
         Tcl_SetResult(interp, StringValueCStr(msg), TCL_VOLATILE);
+        return Qundef;
+    }
+    return result;
+}
+
+Tcl_WideInt
+teek_register_callback(struct tcltk_interp *tip, VALUE proc, VALUE site)
+{
+    Tcl_WideInt id = register_callback_internal(tip, proc);
+    callback_lookup(tip, id)->site = site;
+    return id;
+}
+
+void
+teek_unregister_callback(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    unregister_callback_internal(tip, id);
+}
+
+int
+teek_run_callback(struct tcltk_interp *tip, Tcl_WideInt id, VALUE args)
+{
+    struct callback_slot *slot = callback_lookup(tip, id);
+
+    if (slot == NULL) {
+        Tcl_SetObjResult(tip->interp, Tcl_ObjPrintf("unknown callback id: %" TCL_LL_MODIFIER "d", id));
+        return TCL_ERROR;
+    }
+    return run_callback_proc(tip, tip->interp, id, slot->proc, args) == Qundef
+        ? TCL_ERROR : TCL_OK;
+}
+
+/* Build the proc's argument Array, converting typed positions straight
+ * from the Tcl_Obj. Values that don't parse (e.g. Tk's "??") stay strings. */
+VALUE
+teek_callback_args(struct callback_slot *slot, Tcl_Size objc, Tcl_Obj *const objv[])
+{
+    VALUE args = rb_ary_new2(objc);
+    Tcl_Size i;
+
+    for (i = 0; i < objc; i++) {
+        int type = (i < slot->ntypes) ? slot->types[i] : CALLBACK_ARG_STR;
+        Tcl_WideInt wide;
+        double dbl;
+        int flag;
+        Tcl_Size len;
+        const char *str;
+
+        if (type == CALLBACK_ARG_INT &&
+            Tcl_GetWideIntFromObj(NULL, objv[i], &wide) == TCL_OK) {
+            rb_ary_push(args, LL2NUM(wide));
+            continue;
+        }
+        if (type == CALLBACK_ARG_FLOAT &&
+            Tcl_GetDoubleFromObj(NULL, objv[i], &dbl) == TCL_OK) {
+            rb_ary_push(args, DBL2NUM(dbl));
+            continue;
+        }
+        if (type == CALLBACK_ARG_BOOL &&
+            Tcl_GetBooleanFromObj(NULL, objv[i], &flag) == TCL_OK) {
+            rb_ary_push(args, flag ? Qtrue : Qfalse);
+            continue;
+        }
+        str = Tcl_GetStringFromObj(objv[i], &len);
+        rb_ary_push(args, rb_utf8_str_new(str, len));
+    }
+    return args;
+}
+
+static int
+ruby_callback_impl(ClientData clientData, Tcl_Interp *interp,
+                   int objc, Tcl_Obj *const objv[])
+{
+    struct tcltk_interp *tip = (struct tcltk_interp *)clientData;
+    struct callback_slot *slot;
+    Tcl_WideInt id;
+    VALUE proc, args, result;
+
+    if (objc < 2) {
+        Tcl_SetResult(interp, "wrong # args: should be \"ruby_callback id ?args?\"",
+                      TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    /* Look up proc by ID - no Ruby allocation on this path */
+    if (Tcl_GetWideIntFromObj(NULL, objv[1], &id) != TCL_OK ||
+        (slot = callback_lookup(tip, id)) == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("unknown callback id: %s",
+                         Tcl_GetString(objv[1])));
         return TCL_ERROR;
     }
+    proc = slot->proc;
+    args = teek_callback_args(slot, objc - 2, objv + 2);
+
+    result = run_callback_proc(tip, interp, id, proc, args);
+    if (result == Qundef) return TCL_ERROR;
 
     /* Check return value for Tcl control flow signals.
      * Callbacks wrapped by Teek::App#register_callback use catch/throw
@@ -480,7 +993,7 @@ eval_ruby_string(VALUE arg)
 }
 
 static int
-ruby_eval_proc(ClientData clientData, Tcl_Interp *interp,
+ruby_eval_impl(ClientData clientData, Tcl_Interp *interp,
                int objc, Tcl_Obj *const objv[])
 {
     VALUE code_str, result;
@@ -521,83 +1034,380 @@ ruby_eval_proc(ClientData clientData, Tcl_Interp *interp,
     return TCL_OK;
 }
 
+static int
+ruby_callback_proc(ClientData clientData, Tcl_Interp *interp,
+                   int objc, Tcl_Obj *const objv[])
+{
+    return tcl_cmd_with_gvl(ruby_callback_impl, clientData, interp, objc, objv);
+}
+
+static int
+ruby_eval_proc(ClientData clientData, Tcl_Interp *interp,
+               int objc, Tcl_Obj *const objv[])
+{
+    return tcl_cmd_with_gvl(ruby_eval_impl, clientData, interp, objc, objv);
+}
+
 /* ---------------------------------------------------------
- * Interp#register_callback(proc) - Store proc, return ID
+ * Interp#register_callback(proc, types: nil, site: nil) - Store proc, return ID
+ *
+ * types: optional Array of :str, :int, :float or :bool, one per
+ * ruby_callback argument. Typed positions are converted directly from
+ * the Tcl_Obj (Tcl_GetWideIntFromObj etc.) so e.g. %x arrives as an
+ * Integer with no intermediate String. Arguments past the end of the
+ * array, and values that fail to parse, are passed as Strings.
+ *
+ * site: where the callback was created ("file:line"), reported by
+ * Interp#stats and #callback_top. App#register_callback fills it in.
  * --------------------------------------------------------- */
 
+static int
+callback_arg_type(VALUE sym)
+{
+    ID id;
+
+    if (!SYMBOL_P(sym)) {
+        rb_raise(rb_eTypeError, "callback type must be a Symbol, got %"PRIsVALUE,
+                 rb_obj_class(sym));
+    }
+    id = SYM2ID(sym);
+    if (id == rb_intern("str")) return CALLBACK_ARG_STR;
+    if (id == rb_intern("int")) return CALLBACK_ARG_INT;
+    if (id == rb_intern("float")) return CALLBACK_ARG_FLOAT;
+    if (id == rb_intern("bool")) return CALLBACK_ARG_BOOL;
+    rb_raise(rb_eArgError, "unknown callback type: %"PRIsVALUE
+             " (expected :str, :int, :float or :bool)", sym);
+    return CALLBACK_ARG_STR;
+}
+
 static VALUE
-interp_register_callback(VALUE self, VALUE proc)
+interp_register_callback(int argc, VALUE *argv, VALUE self)
 {
     struct tcltk_interp *tip = get_interp(self);
-    char id_buf[32];
-    VALUE id_str;
+    VALUE proc, opts, types = Qnil, site = Qnil;
+    long n = 0, i;
+    Tcl_WideInt id;
+
+    rb_scan_args(argc, argv, "1:", &proc, &opts);
+    if (!NIL_P(opts)) {
+        ID kw[2];
+        VALUE vals[2];
+
+        kw[0] = rb_intern("types");
+        kw[1] = rb_intern("site");
+        rb_get_kwargs(opts, kw, 0, 2, vals);
+        if (vals[0] != Qundef) types = vals[0];
+        if (vals[1] != Qundef && !NIL_P(vals[1])) {
+            site = rb_str_new_frozen(rb_String(vals[1]));
+        }
+    }
 
-    snprintf(id_buf, sizeof(id_buf), "cb%lu", tip->next_id++);
-    id_str = rb_utf8_str_new_cstr(id_buf);
+    if (!NIL_P(types)) {
+        types = rb_Array(types);
+        n = RARRAY_LEN(types);
+        for (i = 0; i < n; i++) callback_arg_type(RARRAY_AREF(types, i));
+    }
 
-    rb_hash_aset(tip->callbacks, id_str, proc);
-    return id_str;
+    id = register_callback_internal(tip, proc);
+    callback_lookup(tip, id)->site = site;
+    if (n > 0) {
+        struct callback_slot *slot = callback_lookup(tip, id);
+        slot->types = ALLOC_N(unsigned char, n);
+        slot->ntypes = (int)n;
+        for (i = 0; i < n; i++) {
+            slot->types[i] = (unsigned char)callback_arg_type(RARRAY_AREF(types, i));
+        }
+    }
+    return LL2NUM(id);
 }
 
 /* ---------------------------------------------------------
  * Interp#unregister_callback(id) - Remove proc by ID
+ *
+ * Unknown or already-removed ids are ignored.
  * --------------------------------------------------------- */
 
 static VALUE
 interp_unregister_callback(VALUE self, VALUE id)
 {
     struct tcltk_interp *tip = get_interp(self);
-    rb_hash_delete(tip->callbacks, id);
+
+    if (RB_TYPE_P(id, T_STRING)) {
+        id = rb_str_to_inum(id, 10, 0);
+    }
+    if (!RB_INTEGER_TYPE_P(id) || rb_absint_size(id, NULL) > sizeof(Tcl_WideInt)) {
+        return Qnil;
+    }
+    unregister_callback_internal(tip, (Tcl_WideInt)NUM2LL(id));
     return Qnil;
 }
 
 /* ---------------------------------------------------------
- * Thread-safe event queue: run Ruby proc on main Tcl thread
+ * Tcl_Obj -> Ruby conversion for the result: keyword
  *
- * Background threads cannot safely call Tcl/Tk directly.
- * This mechanism queues a proc to execute on the main thread.
+ *   :string (default) - String
+ *   :list             - Array of Strings
+ *   :int / :double    - Integer / Float
+ *   :bool             - true / false
+ *   :dict             - Hash of String => String
+ *   :auto             - picked from the object's internal rep without
+ *                       generating a string: int -> Integer,
+ *                       double -> Float, list -> Array, dict -> Hash
+ *                       (recursively), anything else -> String
+ *   :obj              - Teek::TclObj holding the result object itself
+ *
+ * Works on Tcl_GetObjResult directly, so e.g. `winfo children` with
+ * result: :list never round-trips through a string and split_list.
  * --------------------------------------------------------- */
 
-/* Symbol IDs for queued command hash keys */
-static ID sym_type, sym_proc, sym_script, sym_args, sym_queue;
-static VALUE sym_eval, sym_invoke, sym_proc_val;
+static ID id_result_kw;
+static ID id_result_string, id_result_list, id_result_int, id_result_double;
+static ID id_result_bool, id_result_dict, id_result_auto, id_result_obj;
 
-/* Execute a Tcl eval on behalf of a queued request */
-static VALUE
-execute_queued_eval(VALUE arg)
+/* Looked up once the stubs table exists (Init_tcltklib, or the first
+ * Interp if that bootstrap failed) and read-only after that, so the
+ * Ractor-safe conversions can share them. */
+static const Tcl_ObjType *tcl_int_type;
+static const Tcl_ObjType *tcl_wide_type;
+static const Tcl_ObjType *tcl_bignum_type;
+static const Tcl_ObjType *tcl_double_type;
+static const Tcl_ObjType *tcl_list_type;
+static const Tcl_ObjType *tcl_dict_type;
+
+static void
+init_tcl_obj_types(void)
 {
-    VALUE *args = (VALUE *)arg;
-    struct tcltk_interp *tip = (struct tcltk_interp *)args[0];
-    VALUE script = args[1];
-    const char *script_cstr = StringValueCStr(script);
-    int result = Tcl_Eval(tip->interp, script_cstr);
+    tcl_int_type = Tcl_GetObjType("int");
+    tcl_wide_type = Tcl_GetObjType("wideInt");   /* Tcl 8.6 only */
+    tcl_bignum_type = Tcl_GetObjType("bignum");
+    tcl_double_type = Tcl_GetObjType("double");
+    tcl_list_type = Tcl_GetObjType("list");
+    tcl_dict_type = Tcl_GetObjType("dict");
+}
 
-    if (result != TCL_OK) {
-        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+int
+teek_result_mode(VALUE mode)
+{
+    ID id;
+
+    if (NIL_P(mode)) return TEEK_RESULT_STRING;
+    if (!SYMBOL_P(mode)) {
+        rb_raise(rb_eTypeError, "result: must be a Symbol, got %"PRIsVALUE,
+                 rb_obj_class(mode));
     }
-    return rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+    id = SYM2ID(mode);
+    if (id == id_result_string) return TEEK_RESULT_STRING;
+    if (id == id_result_list) return TEEK_RESULT_LIST;
+    if (id == id_result_int) return TEEK_RESULT_INT;
+    if (id == id_result_double) return TEEK_RESULT_DOUBLE;
+    if (id == id_result_bool) return TEEK_RESULT_BOOL;
+    if (id == id_result_dict) return TEEK_RESULT_DICT;
+    if (id == id_result_auto) return TEEK_RESULT_AUTO;
+    if (id == id_result_obj) return TEEK_RESULT_OBJ;
+    rb_raise(rb_eArgError, "unknown result mode: %"PRIsVALUE
+             " (expected :string, :list, :int, :double, :bool, :dict, :auto or :obj)", mode);
+    return TEEK_RESULT_STRING;
 }
 
-/* Execute a Tcl invoke on behalf of a queued request */
 static VALUE
-execute_queued_invoke(VALUE arg)
+tcl_obj_to_str(Tcl_Obj *obj)
 {
-    VALUE *args = (VALUE *)arg;
-    struct tcltk_interp *tip = (struct tcltk_interp *)args[0];
-    VALUE argv_ary = args[1];
-    int argc = (int)RARRAY_LEN(argv_ary);
-    Tcl_Obj **objv;
-    int i, result;
+    Tcl_Size len;
+    const char *str = Tcl_GetStringFromObj(obj, &len);
+    return rb_utf8_str_new(str, len);
+}
 
-    objv = ALLOCA_N(Tcl_Obj *, argc);
-    for (i = 0; i < argc; i++) {
-        VALUE arg = rb_ary_entry(argv_ary, i);
-        const char *str;
-        Tcl_Size len;
+static void
+raise_expected(const char *what, Tcl_Obj *obj)
+{
+    rb_raise(eTclError, "expected %s but got \"%s\"", what, Tcl_GetString(obj));
+}
 
-        if (NIL_P(arg)) {
-            str = "";
-            len = 0;
+static VALUE tcl_obj_to_auto(Tcl_Obj *obj);
+
+static VALUE
+tcl_dict_to_hash(Tcl_Obj *obj, int auto_values)
+{
+    Tcl_DictSearch search;
+    Tcl_Obj *key, *value;
+    int done;
+    VALUE hash;
+
+    if (Tcl_DictObjFirst(NULL, obj, &search, &key, &value, &done) != TCL_OK) {
+        raise_expected("dictionary", obj);
+    }
+    hash = rb_hash_new();
+    for (; !done; Tcl_DictObjNext(&search, &key, &value, &done)) {
+        rb_hash_aset(hash, tcl_obj_to_str(key),
+                     auto_values ? tcl_obj_to_auto(value) : tcl_obj_to_str(value));
+    }
+    Tcl_DictObjDone(&search);
+    return hash;
+}
+
+static VALUE
+tcl_obj_to_auto(Tcl_Obj *obj)
+{
+    const Tcl_ObjType *type = obj->typePtr;
+
+    if (type == NULL) {
+        return tcl_obj_to_str(obj);
+    }
+    if (type == tcl_int_type || (tcl_wide_type && type == tcl_wide_type)) {
+        Tcl_WideInt wide;
+        if (Tcl_GetWideIntFromObj(NULL, obj, &wide) == TCL_OK) {
+            return LL2NUM(wide);
+        }
+    } else if (tcl_bignum_type && type == tcl_bignum_type) {
+        return rb_cstr_to_inum(Tcl_GetString(obj), 10, 0);
+    } else if (type == tcl_double_type) {
+        double dbl;
+        if (Tcl_GetDoubleFromObj(NULL, obj, &dbl) == TCL_OK) {
+            return DBL2NUM(dbl);
+        }
+    } else if (type == tcl_list_type) {
+        Tcl_Size objc, i;
+        Tcl_Obj **objv;
+        VALUE ary;
+
+        Tcl_ListObjGetElements(NULL, obj, &objc, &objv);
+        ary = rb_ary_new_capa(objc);
+        for (i = 0; i < objc; i++) {
+            rb_ary_push(ary, tcl_obj_to_auto(objv[i]));
+        }
+        return ary;
+    } else if (tcl_dict_type && type == tcl_dict_type) {
+        return tcl_dict_to_hash(obj, 1);
+    }
+    return tcl_obj_to_str(obj);
+}
+
+VALUE
+teek_tcl_to_ruby(Tcl_Obj *obj, int mode)
+{
+    switch (mode) {
+      case TEEK_RESULT_LIST: {
+        Tcl_Size objc, i;
+        Tcl_Obj **objv;
+        VALUE ary;
+
+        if (Tcl_ListObjGetElements(NULL, obj, &objc, &objv) != TCL_OK) {
+            raise_expected("list", obj);
+        }
+        ary = rb_ary_new_capa(objc);
+        for (i = 0; i < objc; i++) {
+            rb_ary_push(ary, tcl_obj_to_str(objv[i]));
+        }
+        return ary;
+      }
+      case TEEK_RESULT_INT: {
+        Tcl_WideInt wide;
+        if (Tcl_GetWideIntFromObj(NULL, obj, &wide) != TCL_OK) {
+            raise_expected("integer", obj);
+        }
+        return LL2NUM(wide);
+      }
+      case TEEK_RESULT_DOUBLE: {
+        double dbl;
+        if (Tcl_GetDoubleFromObj(NULL, obj, &dbl) != TCL_OK) {
+            raise_expected("floating-point number", obj);
+        }
+        return DBL2NUM(dbl);
+      }
+      case TEEK_RESULT_BOOL: {
+        int flag;
+        if (Tcl_GetBooleanFromObj(NULL, obj, &flag) != TCL_OK) {
+            raise_expected("boolean value", obj);
+        }
+        return flag ? Qtrue : Qfalse;
+      }
+      case TEEK_RESULT_DICT:
+        return tcl_dict_to_hash(obj, 0);
+      case TEEK_RESULT_AUTO:
+        return tcl_obj_to_auto(obj);
+      case TEEK_RESULT_OBJ:
+        return teek_tclobj_new(obj);
+      default:
+        return tcl_obj_to_str(obj);
+    }
+}
+
+/* Convert the interp's current result per mode */
+VALUE
+teek_interp_result(struct tcltk_interp *tip, int mode)
+{
+    if (mode == TEEK_RESULT_STRING) {
+        return rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+    }
+    return teek_tcl_to_ruby(Tcl_GetObjResult(tip->interp), mode);
+}
+
+/* Parse the optional result: keyword out of an options Hash */
+static int
+result_mode_from_opts(VALUE opts)
+{
+    ID kw = id_result_kw;
+    VALUE mode = Qundef;
+
+    if (NIL_P(opts)) return TEEK_RESULT_STRING;
+    rb_get_kwargs(opts, &kw, 0, 1, &mode);
+    return teek_result_mode(mode == Qundef ? Qnil : mode);
+}
+
+/* ---------------------------------------------------------
+ * Thread-safe event queue: run Ruby proc on main Tcl thread
+ *
+ * Background threads cannot safely call Tcl/Tk directly.
+ * This mechanism queues a proc to execute on the main thread.
+ * --------------------------------------------------------- */
+
+/* Request kinds for the cross-thread ring */
+static VALUE sym_eval, sym_invoke, sym_command, sym_batch, sym_funcall, sym_proc_val;
+
+static VALUE run_command(struct tcltk_interp *tip, VALUE cmd, VALUE args, VALUE kwargs);
+
+/* Execute a Tcl eval on behalf of a queued request */
+static VALUE
+execute_queued_eval(VALUE arg)
+{
+    VALUE *args = (VALUE *)arg;
+    struct tcltk_interp *tip = (struct tcltk_interp *)args[0];
+    VALUE script = args[1];
+    const char *script_cstr = StringValueCStr(script);
+    int result = Tcl_EvalEx(tip->interp, script_cstr, -1, 0);
+
+    if (result != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+    return teek_interp_result(tip, FIX2INT(args[2]));
+}
+
+/* Execute a Tcl invoke on behalf of a queued request */
+static VALUE
+execute_queued_invoke(VALUE arg)
+{
+    VALUE *args = (VALUE *)arg;
+    struct tcltk_interp *tip = (struct tcltk_interp *)args[0];
+    VALUE argv_ary = args[1];
+    int argc = (int)RARRAY_LEN(argv_ary);
+    Tcl_Obj **objv;
+    int i, result;
+
+    objv = ALLOCA_N(Tcl_Obj *, argc);
+    for (i = 0; i < argc; i++) {
+        VALUE arg = rb_ary_entry(argv_ary, i);
+        Tcl_Obj *shared = teek_tclobj_ptr(arg);
+        const char *str;
+        Tcl_Size len;
+
+        if (shared) {
+            objv[i] = shared;
+            Tcl_IncrRefCount(objv[i]);
+            continue;
+        }
+        if (NIL_P(arg)) {
+            str = "";
+            len = 0;
         } else {
             StringValue(arg);
             str = RSTRING_PTR(arg);
@@ -616,7 +1426,28 @@ execute_queued_invoke(VALUE arg)
     if (result != TCL_OK) {
         rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
     }
-    return rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+    return teek_interp_result(tip, FIX2INT(args[2]));
+}
+
+/* Execute an Interp#command on behalf of a queued request */
+static VALUE
+execute_queued_command(VALUE arg)
+{
+    VALUE *args = (VALUE *)arg;
+    struct tcltk_interp *tip = (struct tcltk_interp *)args[0];
+    VALUE parts = args[1];
+
+    return run_command(tip, rb_ary_entry(parts, 0), rb_ary_entry(parts, 1),
+                       rb_ary_entry(parts, 2));
+}
+
+/* Call recv.mid(*args) on behalf of a queued request */
+static VALUE
+execute_queued_funcall(VALUE parts)
+{
+    VALUE args = rb_ary_entry(parts, 2);
+    return rb_funcallv(rb_ary_entry(parts, 0), SYM2ID(rb_ary_entry(parts, 1)),
+                       (int)RARRAY_LEN(args), RARRAY_CONST_PTR(args));
 }
 
 /* Execute a Ruby proc */
@@ -626,235 +1457,982 @@ execute_queued_proc(VALUE proc)
     return rb_proc_call(proc, rb_ary_new());
 }
 
-/* Tcl event callback - runs on main thread when event is processed */
-static int
-ruby_thread_event_handler(Tcl_Event *evPtr, int flags)
+/* Run one drained request, leaving its reply in the slot */
+static void
+run_request(struct tcltk_interp *tip, struct thread_request *req)
 {
-    struct ruby_thread_event *rte = (struct ruby_thread_event *)evPtr;
-    VALUE cmd, type, queue, result, exception;
-    int state;
-    VALUE exec_args[2];
+    VALUE type = req->type;
+    VALUE result = Qnil;
+    VALUE exec_args[3];
+    int state = 0;
 
-    /* Pop the command from the GC-protected queue */
-    cmd = rb_ary_shift(rte->tip->thread_queue);
-    if (NIL_P(cmd)) return 1;
-
-    type = rb_hash_aref(cmd, ID2SYM(sym_type));
-    queue = rb_hash_aref(cmd, ID2SYM(sym_queue));
-    result = Qnil;
-    exception = Qnil;
-
-    exec_args[0] = (VALUE)rte->tip;
+    exec_args[0] = (VALUE)tip;
+    exec_args[1] = req->payload;
+    exec_args[2] = INT2FIX(req->mode);
 
     if (type == sym_eval) {
-        exec_args[1] = rb_hash_aref(cmd, ID2SYM(sym_script));
         result = rb_protect(execute_queued_eval, (VALUE)exec_args, &state);
     } else if (type == sym_invoke) {
-        exec_args[1] = rb_hash_aref(cmd, ID2SYM(sym_args));
         result = rb_protect(execute_queued_invoke, (VALUE)exec_args, &state);
+    } else if (type == sym_command) {
+        result = rb_protect(execute_queued_command, (VALUE)exec_args, &state);
+    } else if (type == sym_batch) {
+        result = rb_protect(teek_batch_execute, req->payload, &state);
+    } else if (type == sym_funcall) {
+        result = rb_protect(execute_queued_funcall, req->payload, &state);
     } else if (type == sym_proc_val) {
-        VALUE proc = rb_hash_aref(cmd, ID2SYM(sym_proc));
-        result = rb_protect(execute_queued_proc, proc, &state);
-    } else {
-        state = 0;
+        result = rb_protect(execute_queued_proc, req->payload, &state);
     }
 
+    req->result = result;
+    req->exception = Qnil;
     if (state) {
-        exception = rb_errinfo();
+        req->exception = rb_errinfo();
         rb_set_errinfo(Qnil);
+    }
+}
+
+/* Return a slot to the ring */
+static void
+ring_release(struct thread_request *req)
+{
+    req->type = Qnil;
+    req->payload = Qnil;
+    req->waiter = Qnil;
+    req->result = Qnil;
+    req->exception = Qnil;
+    req->state = THREAD_REQ_FREE;
+}
+
+static int ruby_thread_event_handler(Tcl_Event *evPtr, int flags);
+
+/* Queue the drain event unless one is already pending */
+static void
+ring_schedule(struct tcltk_interp *tip)
+{
+    struct ruby_thread_event *rte;
+
+    if (tip->ring_event_pending) return;
+    tip->ring_event_pending = 1;
+
+    /* Allocate event - Tcl takes ownership and will free it */
+    rte = (struct ruby_thread_event *)ckalloc(sizeof(struct ruby_thread_event));
+    rte->event.proc = ruby_thread_event_handler;
+    rte->tip = tip;
+
+    /* Queue to main thread and wake it up */
+    Tcl_ThreadQueueEvent(tip->main_thread_id, (Tcl_Event *)rte, TCL_QUEUE_TAIL);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        Tcl_ThreadAlert(tip->main_thread_id);
+    }
+}
+
+/* Microseconds on a monotonic clock, for latencies, budgets and deadlines */
+Tcl_WideInt
+teek_now_us(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (Tcl_WideInt)(count.QuadPart / freq.QuadPart) * 1000000 +
+           (Tcl_WideInt)(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Tcl_WideInt)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static void ring_idle_drain(ClientData clientData);
+
+/* Run pending requests in order (main thread) until the ring is empty
+ * or the drain budget runs out. Returns when either happens; leftovers
+ * are picked up by an idle callback, so window events and redraws get
+ * to run between chunks of a long burst. */
+static void
+ring_drain(struct tcltk_interp *tip)
+{
+    struct thread_queue_stats *st = &tip->tq_stats;
+    Tcl_WideInt start, now, elapsed;
+    Tcl_WideInt budget_us = (Tcl_WideInt)tip->drain_budget_ms * 1000;
+
+    if (tip->ring_head == tip->ring_tail) return;
+
+    start = now = teek_now_us();
+    st->drains++;
+    tip->loop_stats.ring_drains++;
+
+    while (tip->ring_head != tip->ring_tail) {
+        struct thread_request *req = &tip->ring[tip->ring_head % THREAD_RING_SIZE];
+        VALUE exception;
+        Tcl_WideInt waited = now - req->queued_us;
+
+        st->wait_us_total += waited;
+        if (waited > st->wait_us_max) st->wait_us_max = waited;
+        st->requests++;
+        teek_hist_add(&tip->loop_stats.wait_hist, waited);
+
+        /* Advance first: a request may re-enter the event loop and drain */
+        tip->ring_head++;
+        req->state = THREAD_REQ_RUNNING;
+        run_request(tip, req);
+        exception = req->exception;
+
+        if (NIL_P(req->waiter)) {
+            /* Fire-and-forget, or the waiter is gone. Nobody will see an
+             * error, so report it (queue_for_main procs stay silent). */
+            if (!NIL_P(exception) && req->type != sym_proc_val) {
+                rb_warn("queued %"PRIsVALUE" request failed: %"PRIsVALUE,
+                        rb_sym2str(req->type), exception);
+            }
+            ring_release(req);
+        } else if (teek_future_p(req->waiter)) {
+            VALUE future = req->waiter;
+            VALUE result = req->result;
+
+            ring_release(req);
+            teek_future_resolve(future, result, exception);
+        } else {
+            req->state = THREAD_REQ_DONE;
+            rb_thread_wakeup_alive(req->waiter);
+        }
 
         /* Let SystemExit and Interrupt propagate immediately */
-        if (rb_obj_is_kind_of(exception, rb_eSystemExit) ||
-            rb_obj_is_kind_of(exception, rb_eInterrupt)) {
+        if (!NIL_P(exception) &&
+            (rb_obj_is_kind_of(exception, rb_eSystemExit) ||
+             rb_obj_is_kind_of(exception, rb_eInterrupt))) {
+            if (tip->ring_head != tip->ring_tail) ring_schedule(tip);
             rb_exc_raise(exception);
         }
-    }
 
-    /* Send result back through the queue if one was provided */
-    if (!NIL_P(queue)) {
-        VALUE response = rb_ary_new3(2, result, exception);
-        rb_funcall(queue, rb_intern("push"), 1, response);
+        now = teek_now_us();
+        if (budget_us > 0 && now - start >= budget_us &&
+            tip->ring_head != tip->ring_tail) {
+            st->budget_yields++;
+            if (!tip->ring_event_pending) {
+                tip->ring_event_pending = 1;
+                Tcl_DoWhenIdle(ring_idle_drain, (ClientData)tip);
+            }
+            break;
+        }
     }
 
+    elapsed = now - start;
+    st->drain_us_last = elapsed;
+    st->drain_us_total += elapsed;
+    if (elapsed > st->drain_us_max) st->drain_us_max = elapsed;
+}
+
+int
+teek_drain_requests(struct tcltk_interp *tip)
+{
+    if (tip->ring_head == tip->ring_tail) return 0;
+    ring_drain(tip);
+    return 1;
+}
+
+/* Idle continuation of a drain that ran out of budget */
+static void *
+ring_drain_pending(void *arg)
+{
+    struct tcltk_interp *tip = (struct tcltk_interp *)arg;
+
+    tip->ring_event_pending = 0;
+    ring_drain(tip);
+    return NULL;
+}
+
+static void
+ring_idle_drain(ClientData clientData)
+{
+    teek_call_with_gvl(ring_drain_pending, clientData);
+}
+
+/* Tcl event callback - runs on main thread when event is processed */
+static int
+ruby_thread_event_handler(Tcl_Event *evPtr, int flags)
+{
+    struct ruby_thread_event *rte = (struct ruby_thread_event *)evPtr;
+
+    /* The pending flag is cleared before draining so requests arriving
+     * meanwhile queue a new event */
+    teek_call_with_gvl(ring_drain_pending, rte->tip);
+
     return 1; /* Event handled, Tcl will free the event struct */
 }
 
-/* Internal: Queue a command and optionally wait for result */
-static VALUE
-queue_command_internal(struct tcltk_interp *tip, VALUE cmd_hash, int wait_for_result)
+/* Claim the slot at the ring's tail, waiting for room if it is full */
+static struct thread_request *
+ring_claim(struct tcltk_interp *tip)
 {
-    struct ruby_thread_event *rte;
-    Tcl_ThreadId current_thread;
-    VALUE result_queue = Qnil;
-    VALUE response, result, exception;
+    if (tip->ring == NULL) {
+        long i;
+        tip->ring = ZALLOC_N(struct thread_request, THREAD_RING_SIZE);
+        for (i = 0; i < THREAD_RING_SIZE; i++) {
+            ring_release(&tip->ring[i]);
+        }
+    }
+
+    for (;;) {
+        struct thread_request *req = &tip->ring[tip->ring_tail % THREAD_RING_SIZE];
+
+        if (tip->ring_tail - tip->ring_head < THREAD_RING_SIZE &&
+            req->state == THREAD_REQ_FREE) {
+            tip->ring_tail++;
+            return req;
+        }
 
-    if (wait_for_result) {
-        /* Create a Queue for receiving the result */
-        result_queue = rb_funcall(cQueue, rb_intern("new"), 0);
-        rb_hash_aset(cmd_hash, ID2SYM(sym_queue), result_queue);
+        /* Full. The main thread makes room itself; other threads back off
+         * until it has drained (or a waiter has collected its reply). */
+        if (Tcl_GetCurrentThread() == tip->main_thread_id &&
+            tip->ring_head != tip->ring_tail) {
+            ring_drain(tip);
+        } else {
+            rb_thread_wait_for(rb_time_interval(DBL2NUM(0.001)));
+        }
     }
+}
 
-    /* Store command in GC-protected queue */
-    rb_ary_push(tip->thread_queue, cmd_hash);
+struct ring_wait {
+    struct thread_request *req;
+    VALUE result;
+    VALUE exception;
+};
 
-    /* Allocate event - Tcl takes ownership and will free it */
-    rte = (struct ruby_thread_event *)ckalloc(sizeof(struct ruby_thread_event));
-    rte->event.proc = ruby_thread_event_handler;
-    rte->tip = tip;
+static VALUE
+ring_wait_body(VALUE arg)
+{
+    struct ring_wait *w = (struct ring_wait *)arg;
 
-    /* Queue to main thread and wake it up */
-    current_thread = Tcl_GetCurrentThread();
-    Tcl_ThreadQueueEvent(tip->main_thread_id, (Tcl_Event *)rte, TCL_QUEUE_TAIL);
+    while (w->req->state != THREAD_REQ_DONE) {
+        rb_thread_sleep_forever();
+    }
+    return Qnil;
+}
 
-    if (current_thread != tip->main_thread_id) {
-        Tcl_ThreadAlert(tip->main_thread_id);
+static VALUE
+ring_wait_ensure(VALUE arg)
+{
+    struct ring_wait *w = (struct ring_wait *)arg;
+    struct thread_request *req = w->req;
+
+    if (req->state == THREAD_REQ_DONE) {
+        w->result = req->result;
+        w->exception = req->exception;
+        ring_release(req);
+    } else {
+        /* Interrupted (Thread#kill, #raise): the request still runs and
+         * the main thread frees the slot once it has. */
+        req->waiter = Qnil;
+    }
+    return Qnil;
+}
+
+/* Queue a request for the main thread. waiter is the Thread that will
+ * sleep on the reply, a Teek::Future to settle, or Qnil for none. */
+static struct thread_request *
+ring_submit(struct tcltk_interp *tip, VALUE type, VALUE payload, int mode, VALUE waiter)
+{
+    struct thread_request *req = ring_claim(tip);
+
+    req->type = type;
+    req->payload = payload;
+    req->mode = mode;
+    req->waiter = waiter;
+    req->result = Qnil;
+    req->exception = Qnil;
+    req->queued_us = teek_now_us();
+    req->state = THREAD_REQ_PENDING;
+
+    if (tip->ring_tail - tip->ring_head > tip->tq_stats.high_water) {
+        tip->tq_stats.high_water = tip->ring_tail - tip->ring_head;
     }
+    ring_schedule(tip);
+    return req;
+}
+
+/* Internal: Queue a request and optionally wait for its result */
+static VALUE
+queue_command_internal(struct tcltk_interp *tip, VALUE type, VALUE payload,
+                       int mode, int wait_for_result)
+{
+    struct thread_request *req;
+    struct ring_wait w;
 
     if (!wait_for_result) {
+        ring_submit(tip, type, payload, mode, Qnil);
         return Qnil;
     }
-
-    /* Wait for result - this blocks until main thread processes the command */
-    response = rb_funcall(result_queue, rb_intern("pop"), 0);
-    result = rb_ary_entry(response, 0);
-    exception = rb_ary_entry(response, 1);
-
-    if (!NIL_P(exception)) {
-        rb_exc_raise(exception);
+    req = ring_submit(tip, type, payload, mode, rb_thread_current());
+
+    /* Sleep until the main thread has run the request and woken us */
+    w.req = req;
+    w.result = Qnil;
+    w.exception = Qnil;
+    rb_ensure(ring_wait_body, (VALUE)&w, ring_wait_ensure, (VALUE)&w);
+
+    if (!NIL_P(w.exception)) {
+        rb_exc_raise(w.exception);
+    }
+
+    return w.result;
+}
+
+/* Run a recorded Interp#batch on the main thread and wait for it */
+VALUE
+teek_queue_batch(struct tcltk_interp *tip, VALUE batch)
+{
+    return queue_command_internal(tip, sym_batch, batch, TEEK_RESULT_STRING, 1);
+}
+
+/* Call recv.mid(*args) on the main thread from a background thread
+ * and wait for the result (exceptions are re-raised in the caller) */
+VALUE
+teek_queue_funcall(struct tcltk_interp *tip, VALUE recv, ID mid, VALUE args)
+{
+    return queue_command_internal(tip, sym_funcall,
+                                  rb_ary_new3(3, recv, ID2SYM(mid), args),
+                                  TEEK_RESULT_STRING, 1);
+}
+
+/* Queue a proc to run on the main Tcl thread (fire-and-forget) */
+static VALUE
+interp_queue_for_main(VALUE self, VALUE proc)
+{
+    struct tcltk_interp *tip;
+
+    TypedData_Get_Struct(self, struct tcltk_interp, &interp_type, tip);
+
+    if (tip->deleted || tip->interp == NULL) {
+        rb_raise(eTclError, "interpreter has been deleted");
+    }
+
+    return queue_command_internal(tip, sym_proc_val, proc, TEEK_RESULT_STRING, 0);
+}
+
+/* Check if current thread is the main Tcl thread */
+static VALUE
+interp_on_main_thread_p(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    Tcl_ThreadId current = Tcl_GetCurrentThread();
+    return (current == tip->main_thread_id) ? Qtrue : Qfalse;
+}
+
+/* ---------------------------------------------------------
+ * Interp#thread_drain_budget_ms / #thread_drain_budget_ms= - Get/set
+ * the time one drain of queued background requests may take before
+ * the rest is deferred to an idle callback (0 = drain everything)
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_get_thread_drain_budget_ms(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    return INT2NUM(tip->drain_budget_ms);
+}
+
+static VALUE
+interp_set_thread_drain_budget_ms(VALUE self, VALUE val)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    int ms = NUM2INT(val);
+    if (ms < 0) {
+        rb_raise(rb_eArgError, "thread_drain_budget_ms must be >= 0 (got %d)", ms);
+    }
+    tip->drain_budget_ms = ms;
+    return val;
+}
+
+/* ---------------------------------------------------------
+ * Interp#thread_queue_stats -> Hash
+ *
+ * Counters for requests queued from background threads:
+ *   depth, high_water, capacity  - pending requests / deepest seen / ring size
+ *   requests, drains             - requests run / drain passes
+ *   budget_yields                - drains cut short by thread_drain_budget_ms
+ *   drain_us_last, drain_us_max, drain_us_total - time per drain pass
+ *   wait_us_max, wait_us_total   - queue-to-run latency per request
+ *
+ * Interp#reset_thread_queue_stats zeroes everything but depth.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_thread_queue_stats(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct thread_queue_stats *st = &tip->tq_stats;
+    VALUE h = rb_hash_new();
+
+#define SET_STAT(key, val) rb_hash_aset(h, ID2SYM(rb_intern(key)), val)
+    SET_STAT("depth", ULONG2NUM(tip->ring_tail - tip->ring_head));
+    SET_STAT("high_water", ULONG2NUM(st->high_water));
+    SET_STAT("capacity", INT2NUM(THREAD_RING_SIZE));
+    SET_STAT("requests", ULONG2NUM(st->requests));
+    SET_STAT("drains", ULONG2NUM(st->drains));
+    SET_STAT("budget_yields", ULONG2NUM(st->budget_yields));
+    SET_STAT("drain_us_last", LL2NUM(st->drain_us_last));
+    SET_STAT("drain_us_max", LL2NUM(st->drain_us_max));
+    SET_STAT("drain_us_total", LL2NUM(st->drain_us_total));
+    SET_STAT("wait_us_max", LL2NUM(st->wait_us_max));
+    SET_STAT("wait_us_total", LL2NUM(st->wait_us_total));
+#undef SET_STAT
+
+    return h;
+}
+
+static VALUE
+interp_reset_thread_queue_stats(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    memset(&tip->tq_stats, 0, sizeof(tip->tq_stats));
+    return Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Interp#tcl_eval(script, result: :string) - Evaluate Tcl script string
+ *
+ * Thread-safe: automatically routes through event queue if
+ * called from a background thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_tcl_eval(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    Tcl_ThreadId current = Tcl_GetCurrentThread();
+    VALUE script, opts;
+    const char *script_cstr;
+    int result, mode;
+
+    rb_scan_args(argc, argv, "1:", &script, &opts);
+    StringValue(script);
+    mode = result_mode_from_opts(opts);
+
+    /* If on background thread, queue to main thread and wait */
+    if (current != tip->main_thread_id) {
+        return queue_command_internal(tip, sym_eval, script, mode, 1);
+    }
+
+    /* On main thread - execute directly. Tcl_EvalEx rather than
+     * Tcl_Eval: 8.6's Tcl_Eval mirrors the result into the legacy
+     * string result, which throws away the object's internal rep. */
+    script_cstr = StringValueCStr(script);
+    result = Tcl_EvalEx(tip->interp, script_cstr, -1, 0);
+
+    if (result != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+
+    return teek_interp_result(tip, mode);
+}
+
+/* ---------------------------------------------------------
+ * Interp#tcl_invoke(*args, result: :string) - Invoke Tcl command with args
+ *
+ * This is the workhorse - creates widgets, configures them, etc.
+ * Thread-safe: automatically routes through event queue if
+ * called from a background thread.
+ * --------------------------------------------------------- */
+
+/* Strip tcl_invoke's trailing result: keyword from argv; returns the mode */
+static int
+invoke_args_mode(int *argc, VALUE *argv)
+{
+    VALUE opts = Qnil;
+
+    /* Trailing keywords (result:) are options, not command words */
+    if (*argc > 0 && rb_keyword_given_p() && RB_TYPE_P(argv[*argc - 1], T_HASH)) {
+        opts = argv[--*argc];
+    }
+    if (*argc == 0) {
+        rb_raise(rb_eArgError, "wrong number of arguments (given 0, expected 1+)");
+    }
+    return result_mode_from_opts(opts);
+}
+
+static VALUE
+interp_tcl_invoke(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    Tcl_ThreadId current = Tcl_GetCurrentThread();
+    Tcl_Obj **objv;
+    int i, result;
+    int mode = invoke_args_mode(&argc, argv);
+
+    /* If on background thread, queue to main thread and wait */
+    if (current != tip->main_thread_id) {
+        return queue_command_internal(tip, sym_invoke, rb_ary_new4(argc, argv), mode, 1);
+    }
+
+    /* On main thread - execute directly */
+    objv = ALLOCA_N(Tcl_Obj *, argc);
+    for (i = 0; i < argc; i++) {
+        VALUE arg = argv[i];
+        Tcl_Obj *shared = teek_tclobj_ptr(arg);
+        const char *str;
+        Tcl_Size len;
+
+        /* TclObj args are passed as-is, keeping their internal rep */
+        if (shared) {
+            objv[i] = shared;
+            Tcl_IncrRefCount(objv[i]);
+            continue;
+        }
+        if (NIL_P(arg)) {
+            str = "";
+            len = 0;
+        } else {
+            StringValue(arg);
+            str = RSTRING_PTR(arg);
+            len = RSTRING_LEN(arg);
+        }
+
+        objv[i] = Tcl_NewStringObj(str, len);
+        Tcl_IncrRefCount(objv[i]);
+    }
+
+    /* Invoke the command */
+    result = Tcl_EvalObjv(tip->interp, argc, objv, 0);
+
+    /* Clean up Tcl objects */
+    for (i = 0; i < argc; i++) {
+        Tcl_DecrRefCount(objv[i]);
+    }
+
+    if (result != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+
+    return teek_interp_result(tip, mode);
+}
+
+/* ---------------------------------------------------------
+ * Interp#tcl_eval_async(script, result: :string) -> Teek::Future
+ * Interp#tcl_invoke_async(*args, result: :string) -> Teek::Future
+ *
+ * Queue the call for the main thread without waiting; the returned
+ * future's #value blocks only when the result is actually needed. On
+ * the main thread the call runs right away and the future is already
+ * done (errors are kept in the future rather than raised).
+ *
+ * Interp#tcl_eval_nowait(script) -> nil
+ * Interp#tcl_invoke_nowait(*args) -> nil
+ *
+ * Fire-and-forget: no reply is kept. Off the main thread a failure is
+ * reported with warn; on the main thread the call runs (and raises)
+ * immediately.
+ * --------------------------------------------------------- */
+
+static VALUE
+submit_async(VALUE self, VALUE type, VALUE payload, int mode)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    VALUE future = teek_future_new(self);
+
+    if (Tcl_GetCurrentThread() == tip->main_thread_id) {
+        VALUE exec_args[3];
+        VALUE result;
+        int state = 0;
+
+        exec_args[0] = (VALUE)tip;
+        exec_args[1] = payload;
+        exec_args[2] = INT2FIX(mode);
+        result = rb_protect(type == sym_eval ? execute_queued_eval : execute_queued_invoke,
+                            (VALUE)exec_args, &state);
+        if (state) {
+            VALUE err = rb_errinfo();
+            rb_set_errinfo(Qnil);
+            teek_future_resolve(future, Qnil, err);
+        } else {
+            teek_future_resolve(future, result, Qnil);
+        }
+    } else {
+        ring_submit(tip, type, payload, mode, future);
+    }
+    return future;
+}
+
+static VALUE
+submit_nowait(VALUE self, VALUE type, VALUE payload)
+{
+    struct tcltk_interp *tip = get_interp(self);
+
+    if (Tcl_GetCurrentThread() == tip->main_thread_id) {
+        VALUE exec_args[3];
+
+        exec_args[0] = (VALUE)tip;
+        exec_args[1] = payload;
+        exec_args[2] = INT2FIX(TEEK_RESULT_STRING);
+        if (type == sym_eval) {
+            execute_queued_eval((VALUE)exec_args);
+        } else {
+            execute_queued_invoke((VALUE)exec_args);
+        }
+    } else {
+        ring_submit(tip, type, payload, TEEK_RESULT_STRING, Qnil);
+    }
+    return Qnil;
+}
+
+static VALUE
+interp_tcl_eval_async(int argc, VALUE *argv, VALUE self)
+{
+    VALUE script, opts;
+
+    rb_scan_args(argc, argv, "1:", &script, &opts);
+    StringValue(script);
+    return submit_async(self, sym_eval, script, result_mode_from_opts(opts));
+}
+
+static VALUE
+interp_tcl_invoke_async(int argc, VALUE *argv, VALUE self)
+{
+    int mode = invoke_args_mode(&argc, argv);
+    return submit_async(self, sym_invoke, rb_ary_new4(argc, argv), mode);
+}
+
+static VALUE
+interp_tcl_eval_nowait(VALUE self, VALUE script)
+{
+    StringValue(script);
+    return submit_nowait(self, sym_eval, script);
+}
+
+static VALUE
+interp_tcl_invoke_nowait(int argc, VALUE *argv, VALUE self)
+{
+    rb_check_arity(argc, 1, UNLIMITED_ARGUMENTS);
+    return submit_nowait(self, sym_invoke, rb_ary_new4(argc, argv));
+}
+
+/* ---------------------------------------------------------
+ * Interp#command(cmd, *args, **kwargs) - Invoke with native conversion
+ *
+ * Builds objv straight from Ruby values instead of quoting them into
+ * a script for Tcl to re-tokenize:
+ *
+ *   Integer -> wide int obj (Bignum passes as its decimal string)
+ *   Float   -> double obj
+ *   Array   -> list obj (elements converted recursively)
+ *   Symbol  -> bare string
+ *   Proc    -> {ruby_callback <id>} list; String args starting with
+ *              '%' that follow a positional Proc are appended to it
+ *              as bind substitutions. The same Proc keeps one id, and
+ *              it belongs to the widget the command names (see
+ *              tkcallbacks.c)
+ *   nil     -> empty string
+ *   TclObj  -> the wrapped Tcl_Obj itself (internal rep kept)
+ *   other   -> to_s
+ *
+ * Keyword args become "-key value" pairs after the positional args.
+ * Thread-safe: conversion happens on the main thread when called
+ * from a background thread.
+ * --------------------------------------------------------- */
+
+/* Append the Tcl conversion of val to listobj.
+ * Nested values are appended to their parent before being filled in,
+ * so a Ruby exception mid-conversion never leaks an unowned Tcl_Obj.
+ * tip may be NULL when there is no interp to register Procs with. */
+void
+teek_append_ruby_value(struct tcltk_interp *tip, Tcl_Obj *listobj, VALUE val)
+{
+    Tcl_Obj *obj;
+
+    switch (TYPE(val)) {
+      case T_STRING:
+        obj = Tcl_NewStringObj(RSTRING_PTR(val), RSTRING_LEN(val));
+        break;
+      case T_SYMBOL: {
+        VALUE str = rb_sym2str(val);
+        obj = Tcl_NewStringObj(RSTRING_PTR(str), RSTRING_LEN(str));
+        break;
+      }
+      case T_FIXNUM:
+        obj = Tcl_NewWideIntObj((Tcl_WideInt)FIX2LONG(val));
+        break;
+      case T_FLOAT:
+        obj = Tcl_NewDoubleObj(RFLOAT_VALUE(val));
+        break;
+      case T_NIL:
+        obj = Tcl_NewObj();
+        break;
+      case T_ARRAY: {
+        long i;
+        obj = Tcl_NewListObj(0, NULL);
+        Tcl_ListObjAppendElement(NULL, listobj, obj);
+        for (i = 0; i < RARRAY_LEN(val); i++) {
+            teek_append_ruby_value(tip, obj, RARRAY_AREF(val, i));
+        }
+        return;
+      }
+      default:
+        if ((obj = teek_tclobj_ptr(val)) != NULL) {
+            /* Shared as-is so its internal rep survives */
+            break;
+        }
+        if (rb_obj_is_proc(val)) {
+            struct teek_cb_collect *collect;
+            Tcl_WideInt id;
+            int fresh;
+
+            if (tip == NULL) {
+                rb_raise(rb_eArgError, "a Proc can only be converted for an interpreter");
+            }
+            id = proc_callback_id(tip, val, &fresh);
+
+            /* Interp#command hands it to a widget once the command has
+             * run; anywhere else it stays registered for good */
+            collect = tip->cb_collect;
+            if (collect && collect->n < TEEK_CB_COLLECT_MAX) {
+                collect->refs[collect->n].id = id;
+                collect->refs[collect->n].key = collect->key;
+                collect->refs[collect->n].fresh = fresh;
+                collect->n++;
+            } else {
+                callback_lookup(tip, id)->pinned = 1;
+            }
+            obj = Tcl_NewListObj(0, NULL);
+            Tcl_ListObjAppendElement(NULL, obj, Tcl_NewStringObj("ruby_callback", -1));
+            Tcl_ListObjAppendElement(NULL, obj, Tcl_NewWideIntObj(id));
+        } else {
+            VALUE str = rb_obj_as_string(val);
+            obj = Tcl_NewStringObj(RSTRING_PTR(str), RSTRING_LEN(str));
+        }
+        break;
+    }
+
+    Tcl_ListObjAppendElement(NULL, listobj, obj);
+}
+
+struct command_state {
+    struct tcltk_interp *tip;
+    Tcl_Obj *cmdlist;
+    VALUE cmd;
+    VALUE args;
+    VALUE kwargs;
+    struct teek_cb_collect collect;  /* run_command only */
+    struct teek_cb_collect *saved_collect;
+    int collecting;
+};
+
+static int
+append_kwarg_i(VALUE key, VALUE value, VALUE arg)
+{
+    struct command_state *st = (struct command_state *)arg;
+    VALUE key_str = rb_obj_as_string(key);
+    Tcl_Obj *opt = Tcl_NewStringObj("-", 1);
+
+    Tcl_AppendToObj(opt, RSTRING_PTR(key_str), RSTRING_LEN(key_str));
+    Tcl_ListObjAppendElement(NULL, st->cmdlist, opt);
+    if (st->tip && st->tip->cb_collect) st->tip->cb_collect->key = opt;
+    teek_append_ruby_value(st->tip, st->cmdlist, value);
+    if (st->tip && st->tip->cb_collect) st->tip->cb_collect->key = NULL;
+    return ST_CONTINUE;
+}
+
+/* Append cmd, args and kwargs to cmdlist using the Interp#command
+ * conversion rules. May raise; cmdlist must already be owned. */
+void
+teek_build_command(struct tcltk_interp *tip, Tcl_Obj *cmdlist,
+                   VALUE cmd, VALUE args, VALUE kwargs)
+{
+    struct command_state st;
+    long i, argc;
+
+    st.tip = tip;
+    st.cmdlist = cmdlist;
+
+    /* A TclObj command word keeps its resolved-command cache */
+    teek_append_ruby_value(tip, cmdlist,
+        (RB_TYPE_P(cmd, T_STRING) || teek_tclobj_ptr(cmd)) ? cmd : rb_obj_as_string(cmd));
+
+    argc = NIL_P(args) ? 0 : RARRAY_LEN(args);
+    for (i = 0; i < argc; i++) {
+        VALUE val = RARRAY_AREF(args, i);
+        int is_proc = RTEST(rb_obj_is_proc(val));
+
+        /* A positional Proc is held under the word before it
+         * ("-command", or the event of a bind) */
+        if (is_proc && tip && tip->cb_collect) {
+            Tcl_Size len;
+            Tcl_ListObjLength(NULL, cmdlist, &len);
+            Tcl_ListObjIndex(NULL, cmdlist, len - 1, &tip->cb_collect->key);
+        }
+        teek_append_ruby_value(tip, cmdlist, val);
+
+        /* Positional Proc: trailing "%x"-style args are bind substitutions */
+        if (is_proc) {
+            Tcl_Obj *cb;
+            Tcl_Size len;
+
+            if (tip && tip->cb_collect) tip->cb_collect->key = NULL;
+            Tcl_ListObjLength(NULL, cmdlist, &len);
+            Tcl_ListObjIndex(NULL, cmdlist, len - 1, &cb);
+            while (i + 1 < argc) {
+                VALUE sub = RARRAY_AREF(args, i + 1);
+                if (!RB_TYPE_P(sub, T_STRING) || RSTRING_LEN(sub) == 0 ||
+                    RSTRING_PTR(sub)[0] != '%') {
+                    break;
+                }
+                Tcl_ListObjAppendElement(NULL, cb,
+                    Tcl_NewStringObj(RSTRING_PTR(sub), RSTRING_LEN(sub)));
+                i++;
+            }
+        }
+    }
+
+    if (!NIL_P(kwargs)) {
+        rb_hash_foreach(kwargs, append_kwarg_i, (VALUE)&st);
+    }
+}
+
+/* Widget subcommands that set what an option or event of one item
+ * runs, replacing the Proc held for it before. The key is scoped by the
+ * nscope words after the widget: subcommand(s) and the tag or item. */
+static const struct {
+    const char *sub, *sub2;
+    int nscope;
+} replacing_subcommands[] = {
+    { "configure",      NULL,   0 },  /* .b configure -command */
+    { "bind",           NULL,   2 },  /* .c bind tag <1> */
+    { "itemconfigure",  NULL,   2 },  /* .c itemconfigure 5 -opt */
+    { "entryconfigure", NULL,   2 },  /* .m entryconfigure 2 -command */
+    { "tag",            "bind", 3 },  /* .t tag bind tag <1> */
+};
+
+/* The widget a command is about, for the Procs in it: the command
+ * word (".b configure ...") or the first argument ("button .b ...",
+ * "bind .b <Enter> ..."). Bind and the subcommands above replace what
+ * the widget held under the same option or event (scoped by the first
+ * *nscope words after the command word); anything else adds to it. */
+static const char *
+command_owner(Tcl_Size objc, Tcl_Obj **objv, int *replace, int *nscope)
+{
+    const char *word = Tcl_GetString(objv[0]);
+    size_t i;
+
+    *replace = 0;
+    *nscope = 0;
+    if (word[0] == '.') {
+        const char *sub = objc > 1 ? Tcl_GetString(objv[1]) : "";
+
+        for (i = 0; i < sizeof(replacing_subcommands) / sizeof(replacing_subcommands[0]); i++) {
+            int n = replacing_subcommands[i].nscope;
+
+            if (strcmp(sub, replacing_subcommands[i].sub) != 0) continue;
+            if (replacing_subcommands[i].sub2 &&
+                (objc < 3 || strcmp(Tcl_GetString(objv[2]), replacing_subcommands[i].sub2) != 0)) {
+                continue;
+            }
+            if (objc > n + 1) {
+                *replace = 1;
+                *nscope = n;
+            }
+            break;
+        }
+        return word;
+    }
+    if (objc > 1 && Tcl_GetString(objv[1])[0] == '.') {
+        *replace = strcmp(word, "bind") == 0;
+        return Tcl_GetString(objv[1]);
     }
-
-    return result;
+    return NULL;
 }
 
-/* Queue a proc to run on the main Tcl thread (fire-and-forget) */
 static VALUE
-interp_queue_for_main(VALUE self, VALUE proc)
+command_body(VALUE arg)
 {
-    struct tcltk_interp *tip;
-    VALUE cmd_hash;
+    struct command_state *st = (struct command_state *)arg;
+    struct tcltk_interp *tip = st->tip;
+    const char *owner;
+    Tcl_Size objc;
+    Tcl_Obj **objv;
+    VALUE ret;
+    int result, replace, nscope, i;
 
-    TypedData_Get_Struct(self, struct tcltk_interp, &interp_type, tip);
+    st->collect.n = 0;
+    st->collect.key = NULL;
+    st->saved_collect = tip->cb_collect;
+    tip->cb_collect = &st->collect;
+    st->collecting = 1;
+    teek_build_command(tip, st->cmdlist, st->cmd, st->args, st->kwargs);
+    tip->cb_collect = st->saved_collect;
+    st->collecting = 0;
 
-    if (tip->deleted || tip->interp == NULL) {
-        rb_raise(eTclError, "interpreter has been deleted");
-    }
+    Tcl_ListObjGetElements(NULL, st->cmdlist, &objc, &objv);
+    result = Tcl_EvalObjv(tip->interp, objc, objv, 0);
 
-    cmd_hash = rb_hash_new();
-    rb_hash_aset(cmd_hash, ID2SYM(sym_type), sym_proc_val);
-    rb_hash_aset(cmd_hash, ID2SYM(sym_proc), proc);
+    if (result != TCL_OK) {
+        ret = rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+        teek_callbacks_settle(tip, &st->collect, NULL, NULL, 0, 0);
+        rb_raise(eTclError, "%"PRIsVALUE, ret);
+    }
+    ret = rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+    if (st->collect.n > 0) {
+        Tcl_DString scope;
 
-    return queue_command_internal(tip, cmd_hash, 0);
+        owner = command_owner(objc, objv, &replace, &nscope);
+        Tcl_DStringInit(&scope);
+        for (i = 1; i <= nscope; i++) {
+            Tcl_DStringAppendElement(&scope, Tcl_GetString(objv[i]));
+        }
+        teek_callbacks_settle(tip, &st->collect, owner,
+                              nscope ? Tcl_DStringValue(&scope) : NULL, replace, 1);
+        Tcl_DStringFree(&scope);
+    }
+    return ret;
 }
 
-/* Check if current thread is the main Tcl thread */
 static VALUE
-interp_on_main_thread_p(VALUE self)
+command_cleanup(VALUE arg)
 {
-    struct tcltk_interp *tip = get_interp(self);
-    Tcl_ThreadId current = Tcl_GetCurrentThread();
-    return (current == tip->main_thread_id) ? Qtrue : Qfalse;
-}
+    struct command_state *st = (struct command_state *)arg;
 
-/* ---------------------------------------------------------
- * Interp#tcl_eval(script) - Evaluate Tcl script string
- *
- * Thread-safe: automatically routes through event queue if
- * called from a background thread.
- * --------------------------------------------------------- */
+    /* Conversion raised: nothing was run, drop what it registered */
+    if (st->collecting) {
+        st->tip->cb_collect = st->saved_collect;
+        teek_callbacks_settle(st->tip, &st->collect, NULL, NULL, 0, 0);
+    }
+    Tcl_DecrRefCount(st->cmdlist);
+    return Qnil;
+}
 
 static VALUE
-interp_tcl_eval(VALUE self, VALUE script)
+run_command(struct tcltk_interp *tip, VALUE cmd, VALUE args, VALUE kwargs)
 {
-    struct tcltk_interp *tip = get_interp(self);
-    Tcl_ThreadId current = Tcl_GetCurrentThread();
-    const char *script_cstr;
-    int result;
-
-    StringValue(script);
-
-    /* If on background thread, queue to main thread and wait */
-    if (current != tip->main_thread_id) {
-        VALUE cmd_hash = rb_hash_new();
-        rb_hash_aset(cmd_hash, ID2SYM(sym_type), sym_eval);
-        rb_hash_aset(cmd_hash, ID2SYM(sym_script), script);
-        return queue_command_internal(tip, cmd_hash, 1);
-    }
-
-    /* On main thread - execute directly */
-    script_cstr = StringValueCStr(script);
-    result = Tcl_Eval(tip->interp, script_cstr);
+    struct command_state st;
 
-    if (result != TCL_OK) {
-        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
-    }
+    st.tip = tip;
+    st.cmd = cmd;
+    st.args = args;
+    st.kwargs = kwargs;
+    st.collecting = 0;
+    st.cmdlist = Tcl_NewListObj(0, NULL);
+    Tcl_IncrRefCount(st.cmdlist);
 
-    return rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+    return rb_ensure(command_body, (VALUE)&st, command_cleanup, (VALUE)&st);
 }
 
-/* ---------------------------------------------------------
- * Interp#tcl_invoke(*args) - Invoke Tcl command with args
- *
- * This is the workhorse - creates widgets, configures them, etc.
- * Thread-safe: automatically routes through event queue if
- * called from a background thread.
- * --------------------------------------------------------- */
-
 static VALUE
-interp_tcl_invoke(int argc, VALUE *argv, VALUE self)
+interp_command(int argc, VALUE *argv, VALUE self)
 {
     struct tcltk_interp *tip = get_interp(self);
-    Tcl_ThreadId current = Tcl_GetCurrentThread();
-    Tcl_Obj **objv;
-    int i, result;
-    VALUE ret;
+    VALUE cmd, args, kwargs;
 
-    if (argc == 0) {
-        rb_raise(rb_eArgError, "wrong number of arguments (given 0, expected 1+)");
-    }
+    rb_scan_args(argc, argv, "1*:", &cmd, &args, &kwargs);
 
     /* If on background thread, queue to main thread and wait */
-    if (current != tip->main_thread_id) {
-        VALUE cmd_hash = rb_hash_new();
-        VALUE args_ary = rb_ary_new4(argc, argv);
-        rb_hash_aset(cmd_hash, ID2SYM(sym_type), sym_invoke);
-        rb_hash_aset(cmd_hash, ID2SYM(sym_args), args_ary);
-        return queue_command_internal(tip, cmd_hash, 1);
-    }
-
-    /* On main thread - execute directly */
-    objv = ALLOCA_N(Tcl_Obj *, argc);
-    for (i = 0; i < argc; i++) {
-        VALUE arg = argv[i];
-        const char *str;
-        Tcl_Size len;
-
-        if (NIL_P(arg)) {
-            str = "";
-            len = 0;
-        } else {
-            StringValue(arg);
-            str = RSTRING_PTR(arg);
-            len = RSTRING_LEN(arg);
-        }
-
-        objv[i] = Tcl_NewStringObj(str, len);
-        Tcl_IncrRefCount(objv[i]);
-    }
-
-    /* Invoke the command */
-    result = Tcl_EvalObjv(tip->interp, argc, objv, 0);
-
-    /* Clean up Tcl objects */
-    for (i = 0; i < argc; i++) {
-        Tcl_DecrRefCount(objv[i]);
-    }
-
-    if (result != TCL_OK) {
-        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return queue_command_internal(tip, sym_command, rb_ary_new3(3, cmd, args, kwargs),
+                                      TEEK_RESULT_STRING, 1);
     }
 
-    ret = rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
-    return ret;
+    return run_command(tip, cmd, args, kwargs);
 }
 
 /* ---------------------------------------------------------
@@ -909,26 +2487,53 @@ interp_tcl_set_var(VALUE self, VALUE name, VALUE value)
     return value;
 }
 
+/* One Tcl_DoOneEvent pass, for running without the GVL */
+struct one_event {
+    struct tcltk_interp *tip;
+    int flags;
+    int result;
+};
+
+static void *do_one_event_nogvl(void *arg);
+static void mainloop_ubf(void *arg);
+
 /* ---------------------------------------------------------
  * Interp#do_one_event(flags = ALL_EVENTS) - Process single event
  *
  * Returns true if event was processed, false if nothing to do.
+ * With mainloop_mode :event, a wait (no DONT_WAIT) happens without the
+ * GVL, as in #mainloop.
  * --------------------------------------------------------- */
 
 static VALUE
 interp_do_one_event(int argc, VALUE *argv, VALUE self)
 {
-    int flags = TCL_ALL_EVENTS;
-    int result;
+    struct tcltk_interp *tip;
+    struct one_event ev;
+
+    TypedData_Get_Struct(self, struct tcltk_interp, &interp_type, tip);
+
+    ev.tip = tip;
+    ev.flags = TCL_ALL_EVENTS;
+    ev.result = 0;
 
     /* Optional flags argument */
     if (argc > 0) {
-        flags = NUM2INT(argv[0]);
+        ev.flags = NUM2INT(argv[0]);
     }
 
-    result = Tcl_DoOneEvent(flags);
+    /* The event loop outlives the interp; just don't count for it then */
+    if (tip->deleted || tip->interp == NULL) {
+        ev.result = Tcl_DoOneEvent(ev.flags);
+    } else if (tip->mainloop_event_driven && !(ev.flags & TCL_DONT_WAIT)) {
+        rb_thread_call_without_gvl(do_one_event_nogvl, &ev, mainloop_ubf, tip);
+        raise_deferred_exception();
+        rb_thread_check_ints();
+    } else {
+        ev.result = teek_do_one_event(tip, ev.flags);
+    }
 
-    return result ? Qtrue : Qfalse;
+    return ev.result ? Qtrue : Qfalse;
 }
 
 /* ---------------------------------------------------------
@@ -1031,11 +2636,58 @@ keepalive_timer_proc(ClientData clientData)
     }
 }
 
+/* Event-driven mode: Tcl_DoOneEvent with the GVL released */
+static void *
+do_one_event_nogvl(void *arg)
+{
+    struct one_event *ev = (struct one_event *)arg;
+    struct gvl_state *gs = gvl_state();
+
+    gs->released = 1;
+    ev->result = teek_do_one_event(ev->tip, ev->flags);
+    gs->released = 0;
+    return NULL;
+}
+
+static int
+wake_event_proc(Tcl_Event *evPtr, int flags)
+{
+    return 1;  /* Only here to make Tcl_DoOneEvent return */
+}
+
+/* Unblocking function: Ruby calls this (from another thread) to get the
+ * main thread out of its wait for interrupts, Thread#raise, etc. */
+static void
+mainloop_ubf(void *arg)
+{
+    struct tcltk_interp *tip = (struct tcltk_interp *)arg;
+    Tcl_Event *ev = (Tcl_Event *)ckalloc(sizeof(Tcl_Event));
+
+    ev->proc = wake_event_proc;
+    Tcl_ThreadQueueEvent(tip->main_thread_id, ev, TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(tip->main_thread_id);
+}
+
 static VALUE
 interp_mainloop(VALUE self)
 {
     struct tcltk_interp *tip = get_interp(self);
 
+    if (tip->mainloop_event_driven) {
+        /* Sleep in the notifier without the GVL: background threads run
+         * freely, and queued requests wake us through Tcl_ThreadAlert */
+        struct one_event ev;
+
+        ev.tip = tip;
+        ev.flags = TCL_ALL_EVENTS;
+        while (Tk_GetNumMainWindows() > 0) {
+            rb_thread_call_without_gvl(do_one_event_nogvl, &ev, mainloop_ubf, tip);
+            raise_deferred_exception();
+            rb_thread_check_ints();
+        }
+        return Qnil;
+    }
+
     /* Start recurring timer if interval > 0 */
     if (tip->timer_interval_ms > 0) {
         Tcl_CreateTimerHandler(tip->timer_interval_ms, keepalive_timer_proc, (ClientData)tip);
@@ -1043,7 +2695,7 @@ interp_mainloop(VALUE self)
 
     while (Tk_GetNumMainWindows() > 0) {
         /* Process one event (timer ensures this returns periodically) */
-        Tcl_DoOneEvent(TCL_ALL_EVENTS);
+        teek_do_one_event(tip, TCL_ALL_EVENTS);
 
         /* Yield to other Ruby threads by releasing and reacquiring GVL */
         if (tip->timer_interval_ms > 0) {
@@ -1092,6 +2744,101 @@ interp_set_thread_timer_ms(VALUE self, VALUE val)
     return val;
 }
 
+/* ---------------------------------------------------------
+ * Interp#mainloop_mode / #mainloop_mode= - :timer or :event
+ *
+ * :timer (default) - Tcl_DoOneEvent holds the GVL; a keepalive timer
+ *                    every thread_timer_ms makes it return so other
+ *                    Ruby threads get a turn.
+ * :event           - Tcl_DoOneEvent runs without the GVL. Background
+ *                    threads run unhindered, cross-thread requests wake
+ *                    the loop immediately, and an idle app uses no CPU.
+ *                    Tcl handlers retake the GVL to run Ruby code.
+ * --------------------------------------------------------- */
+
+static int
+mainloop_mode_from_sym(VALUE mode)
+{
+    ID id;
+
+    if (SYMBOL_P(mode)) {
+        id = SYM2ID(mode);
+        if (id == rb_intern("timer")) return 0;
+        if (id == rb_intern("event")) return 1;
+    }
+    rb_raise(rb_eArgError, "mainloop_mode must be :timer or :event (got %"PRIsVALUE")",
+             rb_inspect(mode));
+    return 0;
+}
+
+static VALUE
+interp_get_mainloop_mode(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    return ID2SYM(rb_intern(tip->mainloop_event_driven ? "event" : "timer"));
+}
+
+static VALUE
+interp_set_mainloop_mode(VALUE self, VALUE mode)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    tip->mainloop_event_driven = mainloop_mode_from_sym(mode);
+    return mode;
+}
+
+/* ---------------------------------------------------------
+ * Conversion errors for the module functions
+ *
+ * make_list, split_list, split_dict and tcl_to_bool run on any thread
+ * and in any Ractor, so they never share an interp on the success path:
+ * Tcl's list/dict/boolean parsers accept a NULL interp. Only bad input
+ * needs one, to get Tcl's wording of the error. The loading thread
+ * reuses utility_interp; any other thread parses again in a throwaway
+ * interp, which keeps errors rare-path only and leaves nothing behind
+ * when the thread exits.
+ * --------------------------------------------------------- */
+
+static int
+parse_list(Tcl_Interp *interp, Tcl_Obj *obj)
+{
+    Tcl_Size len;
+    return Tcl_ListObjLength(interp, obj, &len);
+}
+
+static int
+parse_dict(Tcl_Interp *interp, Tcl_Obj *obj)
+{
+    Tcl_Size size;
+    return Tcl_DictObjSize(interp, obj, &size);
+}
+
+static int
+parse_boolean(Tcl_Interp *interp, Tcl_Obj *obj)
+{
+    int bval;
+    return Tcl_GetBooleanFromObj(interp, obj, &bval);
+}
+
+/* TclError for obj failing parse, "prefix: <Tcl message>" */
+static VALUE
+conversion_error(const char *prefix, int (*parse)(Tcl_Interp *, Tcl_Obj *), Tcl_Obj *obj)
+{
+    Tcl_Interp *interp = utility_interp;
+    VALUE msg;
+
+    if (interp == NULL || Tcl_GetCurrentThread() != utility_interp_thread) {
+        interp = Tcl_CreateInterp();
+    }
+    Tcl_ResetResult(interp);
+    parse(interp, obj);
+    msg = prefix ? rb_sprintf("%s: %s", prefix, Tcl_GetStringResult(interp))
+                 : rb_str_new_cstr(Tcl_GetStringResult(interp));
+    if (interp != utility_interp) {
+        Tcl_DeleteInterp(interp);
+    }
+    return rb_exc_new_str(eTclError, msg);
+}
+
 /* ---------------------------------------------------------
  * Teek.tcl_to_bool(str) - Convert Tcl boolean string to Ruby true/false
  *
@@ -1110,10 +2857,10 @@ teek_tcl_to_bool(VALUE self, VALUE str)
     obj = Tcl_NewStringObj(RSTRING_PTR(str), RSTRING_LEN(str));
     Tcl_IncrRefCount(obj);
 
-    if (Tcl_GetBooleanFromObj(utility_interp, obj, &bval) != TCL_OK) {
-        const char *msg = Tcl_GetStringResult(utility_interp);
+    if (Tcl_GetBooleanFromObj(NULL, obj, &bval) != TCL_OK) {
+        VALUE exc = conversion_error(NULL, parse_boolean, obj);
         Tcl_DecrRefCount(obj);
-        rb_raise(eTclError, "%s", msg);
+        rb_exc_raise(exc);
     }
 
     Tcl_DecrRefCount(obj);
@@ -1121,10 +2868,14 @@ teek_tcl_to_bool(VALUE self, VALUE str)
 }
 
 /* ---------------------------------------------------------
- * Teek.make_list(*args) - Merge strings into Tcl list
+ * Teek.make_list(*args, result: :string) - Build a Tcl list
  *
- * Uses Tcl's quoting rules for proper escaping.
- * Module function — uses utility_interp (no user interp needed).
+ * Elements convert like Interp#command arguments: Strings and Symbols
+ * as text, Integers and Floats as numeric Tcl objects, nil as "",
+ * Arrays as nested lists, TclObjs as-is, anything else via to_s. Uses
+ * Tcl's quoting rules for proper escaping. result: :obj returns the
+ * list as a reusable Teek::TclObj instead of a String.
+ * Module function — no interp needed (Procs are rejected).
  * --------------------------------------------------------- */
 
 /* rb_ensure cleanup: release Tcl list object on exception */
@@ -1132,6 +2883,7 @@ struct make_list_state {
     Tcl_Obj *listobj;
     int argc;
     VALUE *argv;
+    int as_obj;
 };
 
 static VALUE
@@ -1143,11 +2895,12 @@ make_list_body(VALUE arg)
     int i;
 
     for (i = 0; i < st->argc; i++) {
-        VALUE s = StringValue(st->argv[i]);
-        Tcl_Obj *elem = Tcl_NewStringObj(RSTRING_PTR(s), RSTRING_LEN(s));
-        Tcl_ListObjAppendElement(NULL, st->listobj, elem);
+        teek_append_ruby_value(NULL, st->listobj, st->argv[i]);
     }
 
+    if (st->as_obj) {
+        return teek_tclobj_new(st->listobj);
+    }
     result = Tcl_GetStringFromObj(st->listobj, &len);
     return rb_utf8_str_new(result, len);
 }
@@ -1164,67 +2917,206 @@ static VALUE
 teek_make_list(int argc, VALUE *argv, VALUE self)
 {
     struct make_list_state st;
+    VALUE args, opts, result;
+    int mode;
 
-    if (argc == 0) return rb_utf8_str_new_cstr("");
+    rb_scan_args(argc, argv, "*:", &args, &opts);
+    mode = result_mode_from_opts(opts);
+    if (mode != TEEK_RESULT_STRING && mode != TEEK_RESULT_OBJ) {
+        rb_raise(rb_eArgError, "make_list result: must be :string or :obj");
+    }
+
+    if (RARRAY_LEN(args) == 0 && mode == TEEK_RESULT_STRING) {
+        return rb_utf8_str_new_cstr("");
+    }
 
     st.listobj = Tcl_NewListObj(0, NULL);
     Tcl_IncrRefCount(st.listobj);
-    st.argc = argc;
-    st.argv = argv;
+    st.argc = (int)RARRAY_LEN(args);
+    st.argv = (VALUE *)RARRAY_CONST_PTR(args);
+    st.as_obj = mode == TEEK_RESULT_OBJ;
 
-    return rb_ensure(make_list_body, (VALUE)&st,
-                     make_list_cleanup, (VALUE)&st);
+    result = rb_ensure(make_list_body, (VALUE)&st,
+                       make_list_cleanup, (VALUE)&st);
+    RB_GC_GUARD(args);
+    return result;
 }
 
 /* ---------------------------------------------------------
- * Teek.split_list(str) - Parse Tcl list into Ruby array
+ * Teek.split_list(str, deep: false) - Parse Tcl list into Ruby array
+ * Teek.split_dict(str, deep: false) - Parse Tcl dict into Ruby Hash
  *
- * Module function — uses utility_interp for error reporting.
- * Single C call instead of N+1 eval round-trips.
- * Returns array of strings (does not recursively parse nested lists).
+ * Module functions — safe on any thread or Ractor (see
+ * conversion_error). Single C pass instead of N+1 eval round-trips.
+ *
+ * str may also be a Teek::TclObj; elements that already hold an
+ * integer or double internal rep then come back as Integer/Float.
+ *
+ * deep: decodes elements that are themselves lists into nested Arrays,
+ * in the same pass: true for any depth, or an Integer level count
+ * (split_dict applies it to the values). An element counts as a leaf
+ * when it is empty or parses to exactly itself, so "foo" stays "foo"
+ * while "{a b}" becomes ["a", "b"]. Strings with spaces are lists to
+ * Tcl too, so only use deep: on data known to be nested lists.
  * --------------------------------------------------------- */
 
+static ID id_deep_kw;
+
+static VALUE split_elem(Tcl_Obj *obj, int depth);
+
+/* objv as a Ruby Array, decoding elements depth levels deep */
 static VALUE
-teek_split_list(VALUE self, VALUE list_str)
+split_objv(Tcl_Size objc, Tcl_Obj **objv, int depth)
 {
-    Tcl_Obj *listobj;
-    Tcl_Size objc;
-    Tcl_Obj **objv;
-    VALUE ary;
+    VALUE ary = rb_ary_new_capa(objc);
     Tcl_Size i;
-    int result;
 
-    if (NIL_P(list_str)) {
-        return rb_ary_new();
+    for (i = 0; i < objc; i++) {
+        rb_ary_push(ary, split_elem(objv[i], depth));
     }
+    return ary;
+}
 
-    StringValue(list_str);
-    if (RSTRING_LEN(list_str) == 0) {
-        return rb_ary_new();
+static VALUE
+split_elem(Tcl_Obj *obj, int depth)
+{
+    const Tcl_ObjType *type = obj->typePtr;
+    Tcl_Size objc, len;
+    Tcl_Obj **objv;
+    const char *str;
+
+    if (type != NULL && (type == tcl_int_type || type == tcl_double_type ||
+                         (tcl_wide_type && type == tcl_wide_type) ||
+                         (tcl_bignum_type && type == tcl_bignum_type))) {
+        return tcl_obj_to_auto(obj);
+    }
+    if (depth == 0) {
+        return tcl_obj_to_str(obj);
     }
 
-    /* Create Tcl object from Ruby string */
-    listobj = Tcl_NewStringObj(RSTRING_PTR(list_str), RSTRING_LEN(list_str));
-    Tcl_IncrRefCount(listobj);
+    str = Tcl_GetStringFromObj(obj, &len);
+    if (len == 0 || Tcl_ListObjGetElements(NULL, obj, &objc, &objv) != TCL_OK) {
+        return rb_utf8_str_new(str, len);
+    }
+    if (objc == 0) {
+        return rb_utf8_str_new(str, len);  /* Just whitespace */
+    }
+    if (objc == 1) {
+        Tcl_Size elen;
+        const char *estr = Tcl_GetStringFromObj(objv[0], &elen);
+        if (elen == len && memcmp(estr, str, (size_t)len) == 0) {
+            return rb_utf8_str_new(str, len);
+        }
+    }
+    return split_objv(objc, objv, depth - 1);
+}
 
-    /* Use utility_interp for error reporting */
-    result = Tcl_ListObjGetElements(utility_interp, listobj, &objc, &objv);
-    if (result != TCL_OK) {
-        const char *msg = Tcl_GetStringResult(utility_interp);
-        Tcl_DecrRefCount(listobj);
-        rb_raise(eTclError, "invalid Tcl list: %s", msg);
+/* deep: false/nil -> 0, true -> unlimited (-1), Integer -> that many levels */
+static int
+split_depth(VALUE opts)
+{
+    VALUE deep = Qundef;
+    int depth;
+
+    if (NIL_P(opts)) return 0;
+    rb_get_kwargs(opts, &id_deep_kw, 0, 1, &deep);
+    if (deep == Qundef || !RTEST(deep)) return 0;
+    if (deep == Qtrue) return -1;
+    depth = NUM2INT(deep);
+    if (depth < 0) {
+        rb_raise(rb_eArgError, "deep: must be true, false or a non-negative Integer (got %d)", depth);
     }
+    return depth;
+}
 
-    /* Convert to Ruby array of strings */
-    ary = rb_ary_new2(objc);
-    for (i = 0; i < objc; i++) {
-        Tcl_Size len;
-        const char *str = Tcl_GetStringFromObj(objv[i], &len);
-        rb_ary_push(ary, rb_utf8_str_new(str, len));
+struct split_state {
+    Tcl_Obj *obj;
+    int depth;
+};
+
+/* Tcl_Obj for a split_* argument (with a reference the caller drops),
+ * or NULL for nil/"" */
+static Tcl_Obj *
+split_source(VALUE src)
+{
+    Tcl_Obj *obj;
+
+    if (NIL_P(src)) return NULL;
+    if ((obj = teek_tclobj_ptr(src)) == NULL) {
+        StringValue(src);
+        if (RSTRING_LEN(src) == 0) return NULL;
+        obj = Tcl_NewStringObj(RSTRING_PTR(src), RSTRING_LEN(src));
     }
+    Tcl_IncrRefCount(obj);
+    return obj;
+}
 
-    Tcl_DecrRefCount(listobj);
-    return ary;
+static VALUE
+split_list_body(VALUE arg)
+{
+    struct split_state *st = (struct split_state *)arg;
+    Tcl_Size objc;
+    Tcl_Obj **objv;
+
+    if (Tcl_ListObjGetElements(NULL, st->obj, &objc, &objv) != TCL_OK) {
+        rb_exc_raise(conversion_error("invalid Tcl list", parse_list, st->obj));
+    }
+    return split_objv(objc, objv, st->depth);
+}
+
+static VALUE
+split_dict_body(VALUE arg)
+{
+    struct split_state *st = (struct split_state *)arg;
+    Tcl_DictSearch search;
+    Tcl_Obj *key, *value;
+    int done;
+    VALUE hash;
+
+    if (Tcl_DictObjFirst(NULL, st->obj, &search, &key, &value, &done) != TCL_OK) {
+        rb_exc_raise(conversion_error("invalid Tcl dict", parse_dict, st->obj));
+    }
+    hash = rb_hash_new();
+    for (; !done; Tcl_DictObjNext(&search, &key, &value, &done)) {
+        rb_hash_aset(hash, tcl_obj_to_str(key), split_elem(value, st->depth));
+    }
+    Tcl_DictObjDone(&search);
+    return hash;
+}
+
+static VALUE
+split_cleanup(VALUE arg)
+{
+    Tcl_DecrRefCount(((struct split_state *)arg)->obj);
+    return Qnil;
+}
+
+static VALUE
+teek_split_list(int argc, VALUE *argv, VALUE self)
+{
+    struct split_state st;
+    VALUE src, opts;
+
+    rb_scan_args(argc, argv, "1:", &src, &opts);
+    st.depth = split_depth(opts);
+    if ((st.obj = split_source(src)) == NULL) {
+        return rb_ary_new();
+    }
+    return rb_ensure(split_list_body, (VALUE)&st, split_cleanup, (VALUE)&st);
+}
+
+static VALUE
+teek_split_dict(int argc, VALUE *argv, VALUE self)
+{
+    struct split_state st;
+    VALUE src, opts;
+
+    rb_scan_args(argc, argv, "1:", &src, &opts);
+    st.depth = split_depth(opts);
+    if ((st.obj = split_source(src)) == NULL) {
+        return rb_hash_new();
+    }
+    return rb_ensure(split_dict_body, (VALUE)&st, split_cleanup, (VALUE)&st);
 }
 
 /* ---------------------------------------------------------
@@ -1258,10 +3150,31 @@ interp_create_slave(int argc, VALUE *argv, VALUE self)
                                    &interp_type, slave);
     slave->interp = slave_interp;
     slave->deleted = 0;
-    slave->callbacks = rb_hash_new();
-    slave->thread_queue = rb_ary_new();
-    slave->next_id = 1;
+    slave->cb_slots = NULL;
+    slave->cb_capa = 0;
+    slave->cb_used = 0;
+    slave->cb_free = -1;
+    slave->cb_by_proc = NULL;
+    slave->cb_retired = NULL;
+    memset(&slave->cb_counts, 0, sizeof(slave->cb_counts));
+    slave->cb_collect = NULL;
+    slave->cb_owners = NULL;
+    slave->ring = NULL;
+    slave->ring_head = 0;
+    slave->ring_tail = 0;
+    slave->ring_event_pending = 0;
+    slave->drain_budget_ms = DEFAULT_DRAIN_BUDGET_MS;
+    memset(&slave->tq_stats, 0, sizeof(slave->tq_stats));
+    memset(&slave->loop_stats, 0, sizeof(slave->loop_stats));
     slave->timer_interval_ms = DEFAULT_TIMER_INTERVAL_MS;
+    slave->mainloop_event_driven = 0;
+    slave->frame_loop_active = 0;
+    slave->frame_cb_us = 0;
+    slave->var_traces = NULL;
+    slave->widgets = NULL;
+    slave->timers = NULL;
+    slave->coalesce = NULL;
+    slave->io_watches = NULL;
     slave->main_thread_id = Tcl_GetCurrentThread();
 
     /* Register Ruby integration commands in the slave */
@@ -1271,6 +3184,7 @@ interp_create_slave(int argc, VALUE *argv, VALUE self)
                          ruby_eval_proc, (ClientData)slave, NULL);
     Tcl_CreateObjCommand(slave->interp, "ruby_eval",
                          ruby_eval_proc, (ClientData)slave, NULL);
+    teek_coalesce_install(slave);
 
     /* Register callback for when Tcl deletes this interpreter */
     Tcl_CallWhenDeleted(slave->interp, interp_deleted_callback, (ClientData)slave);
@@ -1388,21 +3302,25 @@ Init_tcltklib(void)
     /* Initialize live instances tracking array (must be before any interp creation) */
     live_instances = rb_ary_new();
     rb_gc_register_address(&live_instances);
-
-    /* Initialize symbols for thread queue command hashes */
-    sym_type = rb_intern("type");
-    sym_proc = rb_intern("proc");
-    sym_script = rb_intern("script");
-    sym_args = rb_intern("args");
-    sym_queue = rb_intern("queue");
+    rb_gc_register_address(&deferred_exception);
+
+    /* Initialize result: mode and thread request symbols */
+    id_result_kw = rb_intern("result");
+    id_result_string = rb_intern("string");
+    id_result_list = rb_intern("list");
+    id_result_int = rb_intern("int");
+    id_result_double = rb_intern("double");
+    id_result_bool = rb_intern("bool");
+    id_result_dict = rb_intern("dict");
+    id_result_auto = rb_intern("auto");
+    id_result_obj = rb_intern("obj");
     sym_eval = ID2SYM(rb_intern("eval"));
     sym_invoke = ID2SYM(rb_intern("invoke"));
+    sym_command = ID2SYM(rb_intern("command"));
+    sym_batch = ID2SYM(rb_intern("batch"));
+    sym_funcall = ID2SYM(rb_intern("funcall"));
     sym_proc_val = ID2SYM(rb_intern("proc"));
 
-    /* Get Thread::Queue for cross-thread synchronization */
-    cQueue = rb_path2class("Thread::Queue");
-    rb_gc_register_address(&cQueue);
-
     /* Bootstrap Tcl stubs via a lightweight utility interpreter.
      * This makes Teek.make_list / Teek.split_list work immediately
      * after require, without needing a Teek::Interp first.
@@ -1411,7 +3329,9 @@ Init_tcltklib(void)
     utility_interp = create_interp_bootstrap();
     if (utility_interp) {
         if (Tcl_InitStubs(utility_interp, TCL_VERSION, 0)) {
+            init_tcl_obj_types();
             tcl_stubs_initialized = 1;
+            utility_interp_thread = Tcl_GetCurrentThread();
         }
     }
 
@@ -1434,10 +3354,16 @@ Init_tcltklib(void)
     rb_define_const(mTeek, "CALLBACK_CONTINUE", ID2SYM(rb_intern("teek_continue")));
     rb_define_const(mTeek, "CALLBACK_RETURN", ID2SYM(rb_intern("teek_return")));
 
-    /* Module functions for Tcl value conversion (no interpreter needed) */
+    /* Module functions for Tcl value conversion (no interpreter needed).
+     * These touch no shared state, so they may run in any Ractor; every
+     * other method stays main-Ractor only (Ractor::UnsafeError). */
+    rb_ext_ractor_safe(true);
     rb_define_module_function(mTeek, "make_list", teek_make_list, -1);
-    rb_define_module_function(mTeek, "split_list", teek_split_list, 1);
+    rb_define_module_function(mTeek, "split_list", teek_split_list, -1);
+    rb_define_module_function(mTeek, "split_dict", teek_split_dict, -1);
+    id_deep_kw = rb_intern("deep");
     rb_define_module_function(mTeek, "tcl_to_bool", teek_tcl_to_bool, 1);
+    rb_ext_ractor_safe(false);
 
     /* Callback depth detection for unsafe operation warnings */
     rb_define_module_function(mTeek, "in_callback?", lib_in_callback_p, 0);
@@ -1458,8 +3384,13 @@ Init_tcltklib(void)
     rb_define_alloc_func(cInterp, interp_alloc);
 
     rb_define_method(cInterp, "initialize", interp_initialize, -1);
-    rb_define_method(cInterp, "tcl_eval", interp_tcl_eval, 1);
+    rb_define_method(cInterp, "tcl_eval", interp_tcl_eval, -1);
     rb_define_method(cInterp, "tcl_invoke", interp_tcl_invoke, -1);
+    rb_define_method(cInterp, "command", interp_command, -1);
+    rb_define_method(cInterp, "tcl_eval_async", interp_tcl_eval_async, -1);
+    rb_define_method(cInterp, "tcl_invoke_async", interp_tcl_invoke_async, -1);
+    rb_define_method(cInterp, "tcl_eval_nowait", interp_tcl_eval_nowait, 1);
+    rb_define_method(cInterp, "tcl_invoke_nowait", interp_tcl_invoke_nowait, -1);
     rb_define_method(cInterp, "tcl_get_var", interp_tcl_get_var, 1);
     rb_define_method(cInterp, "tcl_set_var", interp_tcl_set_var, 2);
     rb_define_method(cInterp, "do_one_event", interp_do_one_event, -1);
@@ -1469,11 +3400,17 @@ Init_tcltklib(void)
     rb_define_method(cInterp, "tcl_version", interp_tcl_version, 0);
     rb_define_method(cInterp, "tk_version", interp_tk_version, 0);
     rb_define_method(cInterp, "mainloop", interp_mainloop, 0);
-    rb_define_method(cInterp, "register_callback", interp_register_callback, 1);
+    rb_define_method(cInterp, "register_callback", interp_register_callback, -1);
     rb_define_method(cInterp, "unregister_callback", interp_unregister_callback, 1);
     rb_define_method(cInterp, "create_slave", interp_create_slave, -1);
     rb_define_method(cInterp, "thread_timer_ms", interp_get_thread_timer_ms, 0);
     rb_define_method(cInterp, "thread_timer_ms=", interp_set_thread_timer_ms, 1);
+    rb_define_method(cInterp, "mainloop_mode", interp_get_mainloop_mode, 0);
+    rb_define_method(cInterp, "mainloop_mode=", interp_set_mainloop_mode, 1);
+    rb_define_method(cInterp, "thread_drain_budget_ms", interp_get_thread_drain_budget_ms, 0);
+    rb_define_method(cInterp, "thread_drain_budget_ms=", interp_set_thread_drain_budget_ms, 1);
+    rb_define_method(cInterp, "thread_queue_stats", interp_thread_queue_stats, 0);
+    rb_define_method(cInterp, "reset_thread_queue_stats", interp_reset_thread_queue_stats, 0);
     rb_define_method(cInterp, "queue_for_main", interp_queue_for_main, 1);
     rb_define_method(cInterp, "on_main_thread?", interp_on_main_thread_p, 0);
     rb_define_method(cInterp, "create_console", interp_create_console, 0);
@@ -1490,6 +3427,23 @@ Init_tcltklib(void)
     /* External event source integration (tkeventsource.c) */
     Init_tkeventsource(mTeek);
 
+    /* Batched command execution (tkbatch.c) */
+    Init_tkbatch(cInterp);
+
+    /* Persistent Tcl_Obj handles (tclobj.c) */
+    Init_tclobj(mTeek);
+
+    /* Compiled script handles (tclscript.c) */
+    Init_tclscript(cInterp);
+    Init_tclfuture(mTeek);
+    Init_tkframes(cInterp);
+    Init_tkstats(cInterp);
+    Init_tkvars(cInterp);
+    Init_tkwidgets(cInterp);
+    Init_tktimer(cInterp);
+    Init_tkiowatch(cInterp);
+    Init_tkcallbacks(cInterp);
+
     /* Class methods for instance tracking */
     rb_define_singleton_method(cInterp, "instance_count", tcltkip_instance_count, 0);
     rb_define_singleton_method(cInterp, "instances", tcltkip_instances, 0);
@@ -12,14 +12,177 @@
 #include <tk.h>
 #include "tcl9compat.h"
 
+/* Callback table entry. A callback id packs the slot index (plus one)
+ * in the low 32 bits and the slot's generation above it, so an id
+ * that outlives its unregister never reaches the slot's next owner. */
+struct callback_slot {
+    VALUE proc;              /* Qnil while the slot is free (GC-marked) */
+    unsigned int generation; /* Bumped each time the slot is released */
+    long next_free;          /* Free-list link while unused, -1 at end */
+    unsigned char *types;    /* Per-argument CALLBACK_ARG_* conversions, or NULL */
+    int ntypes;              /* Entries in types; later args are strings */
+    unsigned long calls;     /* Invocations since registered (Interp#stats) */
+    Tcl_WideInt total_us;    /* Time spent in the proc */
+    Tcl_WideInt max_us;
+    unsigned long errors;    /* Invocations that raised */
+    VALUE site;              /* "file:line" that registered it, or Qnil (GC-marked) */
+    int owners;              /* Widgets holding it; freed when the last is destroyed */
+    unsigned char pinned;    /* Also used outside any widget: never freed automatically */
+    unsigned char shared;    /* In cb_by_proc (registered by conversion, reusable) */
+};
+
+#define CALLBACK_ID(idx, gen) \
+    ((((Tcl_WideInt)(gen)) << 32) | (Tcl_WideInt)((idx) + 1))
+#define CALLBACK_IDX(id)      ((long)((id) & 0xffffffff) - 1)
+#define CALLBACK_GEN(id)      ((unsigned int)((id) >> 32))
+#define CALLBACK_GEN_MASK     0x7fffffffu
+
+/* Callback argument conversions (register_callback types:) */
+enum {
+    CALLBACK_ARG_STR = 0,
+    CALLBACK_ARG_INT,
+    CALLBACK_ARG_FLOAT,
+    CALLBACK_ARG_BOOL
+};
+
+/* Cross-thread request slot. Requests from background threads are
+ * claimed from a fixed ring on the interp and drained on the main
+ * thread; every field is only touched while holding the GVL. */
+struct thread_request {
+    int state;           /* THREAD_REQ_* */
+    int mode;            /* TEEK_RESULT_* for eval/invoke */
+    VALUE type;          /* Request kind Symbol (GC-marked) */
+    VALUE payload;       /* Script, argument Array, Batch, Proc... (GC-marked) */
+    VALUE waiter;        /* Thread sleeping on the reply, or Qnil (GC-marked) */
+    VALUE result;        /* Reply value (GC-marked) */
+    VALUE exception;     /* Exception raised by the request, or Qnil (GC-marked) */
+    Tcl_WideInt queued_us; /* When the request was queued (teek_now_us) */
+};
+
+enum {
+    THREAD_REQ_FREE = 0, /* Claimable */
+    THREAD_REQ_PENDING,  /* Queued, not yet drained */
+    THREAD_REQ_RUNNING,  /* Executing on the main thread */
+    THREAD_REQ_DONE      /* Reply ready for the waiter to collect */
+};
+
+/* Slots in the cross-thread request ring */
+#define THREAD_RING_SIZE 1024
+
+/* Cross-thread queue counters (Interp#thread_queue_stats) */
+struct thread_queue_stats {
+    unsigned long high_water;    /* Deepest the queue has been */
+    unsigned long requests;      /* Requests run */
+    unsigned long drains;        /* Drain passes */
+    unsigned long budget_yields; /* Drains cut short by the time budget */
+    Tcl_WideInt drain_us_total;  /* Time spent draining */
+    Tcl_WideInt drain_us_max;
+    Tcl_WideInt drain_us_last;
+    Tcl_WideInt wait_us_total;   /* Queue-to-run latency, summed over requests */
+    Tcl_WideInt wait_us_max;
+};
+
+/* log2 latency histogram: bucket i counts durations in [2^i, 2^(i+1))
+ * microseconds; bucket 0 also takes 0us, the last one everything longer */
+#define TEEK_HIST_BUCKETS 24
+
+struct teek_histogram {
+    unsigned long count[TEEK_HIST_BUCKETS];
+};
+
+/* Kinds of event loop iteration (Interp#stats). Tcl's notifier does not
+ * say whether a timer or a file handler produced an event, so those
+ * share a bucket. */
+enum {
+    TEEK_EV_WINDOW = 0,     /* Tk window (X) events */
+    TEEK_EV_TIMER_FILE,     /* Timer handlers, file/channel handlers */
+    TEEK_EV_IDLE,           /* Idle handlers (redraws, geometry) */
+    TEEK_EV_CROSS_THREAD,   /* Requests queued from background threads */
+    TEEK_EV_KINDS
+};
+
+/* Event loop counters (Interp#stats) */
+struct teek_loop_stats {
+    unsigned long iterations;             /* teek_do_one_event calls */
+    unsigned long events[TEEK_EV_KINDS];  /* Iterations that handled something, by kind */
+    Tcl_WideInt event_us[TEEK_EV_KINDS];  /* Time spent handling them */
+    unsigned long ring_drains;            /* Drain passes, to spot cross-thread work */
+    unsigned long callbacks;              /* ruby_callback invocations */
+    Tcl_WideInt callback_us;              /* Time in (outermost) callbacks */
+    unsigned long coalesced;              /* ruby_coalesce events received */
+    unsigned long coalesce_deliveries;    /* Calls they were merged into */
+    struct teek_histogram event_hist;     /* Per-iteration handling time */
+    struct teek_histogram callback_hist;  /* Per-callback run time */
+    struct teek_histogram wait_hist;      /* Cross-thread queue-to-run latency */
+};
+
+/* Callback table counters (Interp#callback_counts) */
+struct teek_callback_counts {
+    unsigned long registered;  /* Ids handed out */
+    unsigned long released;    /* Ids unregistered, explicitly or by a widget's destroy */
+    unsigned long reused;      /* Proc conversions that found the Proc already registered */
+    long owned;                /* Live ids held by at least one widget */
+};
+
+/* Stats of released callbacks, summed per registration site, so
+ * one-shot callbacks (after, after_idle) still show in callback_top */
+struct teek_retired_stats {
+    unsigned long calls;
+    Tcl_WideInt total_us;
+    Tcl_WideInt max_us;
+    unsigned long errors;
+};
+
+/* Callbacks registered while converting one command's arguments, so
+ * they can be handed to the widget the command is about once it has
+ * run (tkcallbacks.c). Procs past TEEK_CB_COLLECT_MAX are pinned. */
+#define TEEK_CB_COLLECT_MAX 16
+struct teek_cb_collect {
+    int n;
+    Tcl_Obj *key;              /* Option the next Procs are the value of, or NULL */
+    struct {
+        Tcl_WideInt id;
+        Tcl_Obj *key;          /* Borrowed from the command list */
+        int fresh;             /* Registered by this conversion (not reused) */
+    } refs[TEEK_CB_COLLECT_MAX];
+};
+
+struct var_trace;  /* tkvars.c */
+struct callback_owners;  /* tkcallbacks.c */
+struct widget_tracker;  /* tkwidgets.c */
+struct teek_timer;  /* tktimer.c */
+struct event_coalescer;  /* tkcoalesce.c */
+struct io_watches;  /* tkiowatch.c */
+
 /* Interp struct stored in Ruby object */
 struct tcltk_interp {
     Tcl_Interp *interp;
     int deleted;
-    VALUE callbacks;      /* Hash: id_string => proc (GC-marked) */
-    VALUE thread_queue;   /* Array: pending procs from other threads (GC-marked) */
-    unsigned long next_id; /* Next callback ID */
+    struct callback_slot *cb_slots; /* Callback table, indexed by slot */
+    long cb_capa;         /* Allocated slots */
+    long cb_used;         /* Slots ever handed out (high-water mark) */
+    long cb_free;         /* Head of the free-slot list, -1 if empty */
+    Tcl_HashTable *cb_by_proc;  /* Proc -> id for converted Procs (lazy) */
+    struct teek_callback_counts cb_counts;
+    Tcl_HashTable *cb_retired;  /* Site ("" if none) -> struct teek_retired_stats (lazy) */
+    struct teek_cb_collect *cb_collect;   /* Conversion in progress, or NULL */
+    struct callback_owners *cb_owners;    /* Widget -> callbacks it holds (lazy) */
+    struct thread_request *ring; /* Cross-thread requests, THREAD_RING_SIZE slots (lazy) */
+    unsigned long ring_head;     /* Next request to drain */
+    unsigned long ring_tail;     /* Next slot to claim */
+    int ring_event_pending;      /* A drain Tcl_Event (or idle continuation) is queued */
+    int drain_budget_ms;         /* Max time per drain pass, 0 = unlimited */
+    struct thread_queue_stats tq_stats;
+    struct teek_loop_stats loop_stats;
     int timer_interval_ms; /* Mainloop timer interval for thread yielding */
+    int mainloop_event_driven; /* mainloop_mode :event - wait without the GVL */
+    int frame_loop_active;   /* Inside run_frames: time ruby_callback */
+    Tcl_WideInt frame_cb_us; /* Callback time accumulated for the current frame */
+    struct var_trace *var_traces; /* Interp#trace_vars registrations */
+    struct widget_tracker *widgets; /* Interp#track_widgets state, or NULL */
+    struct teek_timer *timers;   /* Pending Interp#after timers */
+    struct event_coalescer *coalesce; /* ruby_coalesce state (lazy) */
+    struct io_watches *io_watches; /* Interp#watch_io state (lazy) */
     Tcl_ThreadId main_thread_id; /* Thread that created the interp */
 };
 
@@ -30,6 +193,136 @@ extern const rb_data_type_t interp_type;
 /* Get interpreter from Ruby object, raising if deleted */
 struct tcltk_interp *get_interp(VALUE self);
 
+/* Result conversion modes for result: keyword (tcl_eval, tcl_invoke, ...) */
+enum {
+    TEEK_RESULT_STRING = 0,
+    TEEK_RESULT_LIST,
+    TEEK_RESULT_INT,
+    TEEK_RESULT_DOUBLE,
+    TEEK_RESULT_BOOL,
+    TEEK_RESULT_DICT,
+    TEEK_RESULT_AUTO,
+    TEEK_RESULT_OBJ
+};
+
+/* Map a result: Symbol (or nil) to a TEEK_RESULT_* mode - defined in tcltkbridge.c */
+int teek_result_mode(VALUE mode);
+
+/* Convert a Tcl_Obj to Ruby per TEEK_RESULT_* mode without touching any
+ * interp result. Raises TclError if obj doesn't parse - defined in tcltkbridge.c */
+VALUE teek_tcl_to_ruby(Tcl_Obj *obj, int mode);
+
+/* Convert the interp's current result per TEEK_RESULT_* mode - defined in tcltkbridge.c */
+VALUE teek_interp_result(struct tcltk_interp *tip, int mode);
+
+/* Run recv.mid(*args) on the main thread and wait - defined in tcltkbridge.c */
+VALUE teek_queue_funcall(struct tcltk_interp *tip, VALUE recv, ID mid, VALUE args);
+
+/* Append the Interp#command conversion of val to listobj. tip may be
+ * NULL (Procs then raise) - defined in tcltkbridge.c */
+void teek_append_ruby_value(struct tcltk_interp *tip, Tcl_Obj *listobj, VALUE val);
+
+/* Append cmd/args/kwargs to cmdlist using Interp#command conversion
+ * rules - defined in tcltkbridge.c. May raise. */
+void teek_build_command(struct tcltk_interp *tip, Tcl_Obj *cmdlist,
+                        VALUE cmd, VALUE args, VALUE kwargs);
+
+/* Run a batch on the main thread from a background thread - defined in tcltkbridge.c */
+VALUE teek_queue_batch(struct tcltk_interp *tip, VALUE batch);
+
+/* Run queued cross-thread requests now (main thread). Returns 0 if there
+ * were none - defined in tcltkbridge.c */
+int teek_drain_requests(struct tcltk_interp *tip);
+
+/* Register proc in the callback table with a "file:line" site (or Qnil)
+ * and return its id; unregister it again - defined in tcltkbridge.c */
+Tcl_WideInt teek_register_callback(struct tcltk_interp *tip, VALUE proc, VALUE site);
+void teek_unregister_callback(struct tcltk_interp *tip, Tcl_WideInt id);
+/* Drop the per-site stats of released callbacks (reset_stats, interp free) */
+void teek_retired_stats_clear(struct tcltk_interp *tip);
+
+/* Proc arguments for objv per the slot's types (GVL held) - defined in tcltkbridge.c */
+VALUE teek_callback_args(struct callback_slot *slot, Tcl_Size objc, Tcl_Obj *const objv[]);
+
+/* The live slot for id, or NULL - defined in tcltkbridge.c */
+struct callback_slot *teek_callback_slot(struct tcltk_interp *tip, Tcl_WideInt id);
+
+/* Call callback id with args (GVL held), charging its stats like
+ * ruby_callback. Returns TCL_OK, or TCL_ERROR with the message as the
+ * interp result. SystemExit and Interrupt propagate - defined in tcltkbridge.c */
+int teek_run_callback(struct tcltk_interp *tip, Tcl_WideInt id, VALUE args);
+
+/* Call func(arg) holding the GVL. Tcl handlers that enter Ruby must go
+ * through this: the event-driven mainloop runs Tcl_DoOneEvent without
+ * the GVL - defined in tcltkbridge.c */
+void *teek_call_with_gvl(void *(*func)(void *), void *arg);
+
+/* Microseconds on a monotonic clock - defined in tcltkbridge.c */
+Tcl_WideInt teek_now_us(void);
+
+/* Event loop instrumentation - defined in tkstats.c */
+void Init_tkstats(VALUE cInterp);
+
+/* Install the per-thread hooks teek_do_one_event uses to classify
+ * events (main thread, after Tk_InitStubs). Safe to call repeatedly. */
+void teek_stats_install(void);
+
+/* Tcl_DoOneEvent(flags) that keeps interp's loop stats. Safe to call
+ * without the GVL: touches no Ruby state. */
+int teek_do_one_event(struct tcltk_interp *tip, int flags);
+
+/* Count a duration in a histogram */
+void teek_hist_add(struct teek_histogram *hist, Tcl_WideInt us);
+
+/* Bulk variable access and change notifications (Interp#get_vars,
+ * #trace_vars, ...) - defined in tkvars.c */
+void Init_tkvars(VALUE cInterp);
+void teek_var_traces_mark(struct tcltk_interp *tip);
+/* Drop every trace_vars registration (after the interp is deleted) */
+void teek_var_traces_free(struct tcltk_interp *tip);
+
+/* C-side widget tree tracking (Interp#track_widgets) - defined in tkwidgets.c */
+void Init_tkwidgets(VALUE cInterp);
+void teek_widgets_mark(struct tcltk_interp *tip);
+/* Unhook windows still tracked and free the table (after the interp is deleted) */
+void teek_widgets_free(struct tcltk_interp *tip);
+
+/* Widget-owned callbacks (Interp#callback_counts, #attach_callback)
+ * - defined in tkcallbacks.c */
+void Init_tkcallbacks(VALUE cInterp);
+/* After a command ran: give the Procs collected while converting it to
+ * the widget at path (replacing the ones held under the same key when
+ * replace is set), pin them if there is no such widget, or free the
+ * fresh ones if the command failed. scope, if not NULL, prefixes each
+ * key (".c bind tag <1>" holds under "bind tag <1>"). path may be NULL. */
+void teek_callbacks_settle(struct tcltk_interp *tip, struct teek_cb_collect *collect,
+                           const char *path, const char *scope, int replace, int ok);
+/* Drop a widget's hold on id; frees it when nothing else holds it */
+void teek_callback_release(struct tcltk_interp *tip, Tcl_WideInt id);
+/* Unhook owning windows and free the owner table (after the interp is deleted) */
+void teek_callbacks_free(struct tcltk_interp *tip);
+
+/* Event coalescing (the ruby_coalesce command) - defined in tkcoalesce.c */
+void teek_coalesce_install(struct tcltk_interp *tip);
+/* Deliver what is waiting for the next frame (run_frames, GVL held) */
+void teek_coalesce_flush_frame(struct tcltk_interp *tip);
+/* run_frames ended: go back to timer-paced frame deliveries */
+void teek_coalesce_frames_ended(struct tcltk_interp *tip);
+/* Drop pending deliveries (after the interp is deleted) */
+void teek_coalesce_free(struct tcltk_interp *tip);
+
+/* Native timers (Interp#after, Teek::Timer) - defined in tktimer.c */
+void Init_tktimer(VALUE cInterp);
+void teek_timers_mark(struct tcltk_interp *tip);
+/* Cancel every pending timer (after the interp is deleted) */
+void teek_timers_free(struct tcltk_interp *tip);
+
+/* IO readiness watches (Interp#watch_io, Teek::IOWatch) - defined in tkiowatch.c */
+void Init_tkiowatch(VALUE cInterp);
+void teek_io_watches_mark(struct tcltk_interp *tip);
+/* Drop every file handler (after the interp is deleted) */
+void teek_io_watches_free(struct tcltk_interp *tip);
+
 /* Photo image functions - defined in tkphoto.c */
 void Init_tkphoto(VALUE cInterp);
 
@@ -42,4 +335,31 @@ void Init_tkwin(VALUE cInterp);
 /* External event source integration - defined in tkeventsource.c */
 void Init_tkeventsource(VALUE mTeek);
 
+/* Batched command execution - defined in tkbatch.c */
+void Init_tkbatch(VALUE cInterp);
+VALUE teek_batch_execute(VALUE batch);
+
+/* Persistent Tcl_Obj handles - defined in tclobj.c */
+void Init_tclobj(VALUE mTeek);
+/* Wrapped Tcl_Obj if val is a Teek::TclObj, else NULL. Raises if the
+ * handle belongs to another thread. */
+Tcl_Obj *teek_tclobj_ptr(VALUE val);
+/* Wrap obj in a new Teek::TclObj (takes a reference) */
+VALUE teek_tclobj_new(Tcl_Obj *obj);
+/* Drop a reference to obj on its owning thread (safe from dfree) */
+void teek_release_tcl_obj(Tcl_Obj *obj, Tcl_ThreadId owner);
+
+/* Frame-paced loop driver (Interp#run_frames) - defined in tkframes.c */
+void Init_tkframes(VALUE cInterp);
+
+/* Compiled script handles - defined in tclscript.c */
+void Init_tclscript(VALUE cInterp);
+
+/* Futures for asynchronous requests - defined in tclfuture.c */
+void Init_tclfuture(VALUE mTeek);
+VALUE teek_future_new(VALUE interp);
+int teek_future_p(VALUE val);
+/* Settle the future and wake its waiters; runs #then blocks (main thread) */
+void teek_future_resolve(VALUE future, VALUE value, VALUE exception);
+
 #endif /* TCLTKBRIDGE_H */
@@ -0,0 +1,386 @@
+/*
+ * tkbatch.c - Batched command execution
+ *
+ * Interp#batch records many Tcl invocations into a C-side buffer of
+ * command lists and then runs them back to back with Tcl_EvalObjv.
+ * Recording does the argument conversion once; execution is a tight C
+ * loop with no Ruby method dispatch per command, and result strings are
+ * only built when the caller asks for them.
+ *
+ * Tcl_Obj allocation is per-thread, so commands recorded on a background
+ * thread are kept as Ruby arrays and converted on the main thread, where
+ * the whole batch runs inside a single queued event.
+ */
+
+#include "tcltkbridge.h"
+
+#define BATCH_DEFAULT_CAPA 16
+
+static VALUE cBatch;
+static VALUE eBatchError;
+static VALUE sym_invoke, sym_command;
+static ID id_results_kw, id_capacity_kw;
+
+struct tcltk_batch {
+    VALUE interp;       /* Owning Teek::Interp (GC-marked) */
+    Tcl_Obj **cmds;     /* Recorded command lists, one reference each */
+    long count;
+    long capa;
+    VALUE pending;      /* Array of [kind, cmd, args, kwargs] recorded off
+                         * the main thread (GC-marked) */
+    int want_results;
+    int closed;         /* Set once the block returns; no more recording */
+};
+
+/* ---------------------------------------------------------
+ * TypedData functions
+ * --------------------------------------------------------- */
+
+static void
+batch_release(struct tcltk_batch *b)
+{
+    long i;
+
+    for (i = 0; i < b->count; i++) {
+        Tcl_DecrRefCount(b->cmds[i]);
+    }
+    b->count = 0;
+}
+
+static void
+batch_mark(void *ptr)
+{
+    struct tcltk_batch *b = ptr;
+    rb_gc_mark(b->interp);
+    rb_gc_mark(b->pending);
+}
+
+static void
+batch_free(void *ptr)
+{
+    struct tcltk_batch *b = ptr;
+    batch_release(b);
+    xfree(b->cmds);
+    xfree(b);
+}
+
+static size_t
+batch_memsize(const void *ptr)
+{
+    const struct tcltk_batch *b = ptr;
+    return sizeof(struct tcltk_batch) + (size_t)b->capa * sizeof(Tcl_Obj *);
+}
+
+static const rb_data_type_t batch_type = {
+    .wrap_struct_name = "Teek::Batch",
+    .function = {
+        .dmark = batch_mark,
+        .dfree = batch_free,
+        .dsize = batch_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static struct tcltk_batch *
+get_batch(VALUE self)
+{
+    struct tcltk_batch *b;
+    TypedData_Get_Struct(self, struct tcltk_batch, &batch_type, b);
+    return b;
+}
+
+/* ---------------------------------------------------------
+ * Recording
+ * --------------------------------------------------------- */
+
+struct record_args {
+    struct tcltk_interp *tip;
+    Tcl_Obj *list;
+    VALUE kind;
+    VALUE cmd;
+    VALUE args;
+    VALUE kwargs;
+};
+
+static VALUE
+record_body(VALUE arg)
+{
+    struct record_args *ra = (struct record_args *)arg;
+
+    if (ra->kind == sym_invoke) {
+        long i;
+        for (i = 0; i < RARRAY_LEN(ra->args); i++) {
+            VALUE val = RARRAY_AREF(ra->args, i);
+            Tcl_Obj *obj = teek_tclobj_ptr(val);
+
+            if (obj) {
+                /* shared TclObj, appended as-is */
+            } else if (NIL_P(val)) {
+                obj = Tcl_NewObj();
+            } else {
+                StringValue(val);
+                obj = Tcl_NewStringObj(RSTRING_PTR(val), RSTRING_LEN(val));
+            }
+            Tcl_ListObjAppendElement(NULL, ra->list, obj);
+        }
+    } else {
+        teek_build_command(ra->tip, ra->list, ra->cmd, ra->args, ra->kwargs);
+    }
+    return Qnil;
+}
+
+/* Convert one command into a list obj appended to the buffer (main thread) */
+static void
+record_native(struct tcltk_batch *b, VALUE kind, VALUE cmd, VALUE args, VALUE kwargs)
+{
+    struct record_args ra;
+    int state = 0;
+
+    if (b->count == b->capa) {
+        b->capa = b->capa ? b->capa * 2 : BATCH_DEFAULT_CAPA;
+        REALLOC_N(b->cmds, Tcl_Obj *, b->capa);
+    }
+
+    ra.tip = get_interp(b->interp);
+    ra.list = Tcl_NewListObj(0, NULL);
+    ra.kind = kind;
+    ra.cmd = cmd;
+    ra.args = args;
+    ra.kwargs = kwargs;
+
+    /* Owned by the buffer before conversion so a raise can't leak it */
+    Tcl_IncrRefCount(ra.list);
+    b->cmds[b->count++] = ra.list;
+
+    rb_protect(record_body, (VALUE)&ra, &state);
+    if (state) {
+        b->count--;
+        Tcl_DecrRefCount(ra.list);
+        rb_jump_tag(state);
+    }
+}
+
+static void
+record(VALUE self, VALUE kind, VALUE cmd, VALUE args, VALUE kwargs)
+{
+    struct tcltk_batch *b = get_batch(self);
+    struct tcltk_interp *tip = get_interp(b->interp);
+
+    if (b->closed) {
+        rb_raise(eTclError, "batch has already been executed");
+    }
+
+    /* Keep order: once anything is pending, everything after is too */
+    if (Tcl_GetCurrentThread() == tip->main_thread_id &&
+        RARRAY_LEN(b->pending) == 0) {
+        record_native(b, kind, cmd, args, kwargs);
+    } else {
+        rb_ary_push(b->pending, rb_ary_new3(4, kind, cmd, args, kwargs));
+    }
+}
+
+/*
+ * Batch#invoke(*args) -> self
+ *
+ * Record a command with String arguments, like Interp#tcl_invoke.
+ */
+static VALUE
+batch_invoke(int argc, VALUE *argv, VALUE self)
+{
+    if (argc < 1) {
+        rb_raise(rb_eArgError, "wrong number of arguments (given 0, expected 1+)");
+    }
+    record(self, sym_invoke, Qnil, rb_ary_new_from_values(argc, argv), Qnil);
+    return self;
+}
+
+/*
+ * Batch#command(cmd, *args, **kwargs) -> self
+ *
+ * Record a command using Interp#command's native value conversion.
+ */
+static VALUE
+batch_command(int argc, VALUE *argv, VALUE self)
+{
+    VALUE cmd, args, kwargs;
+
+    rb_scan_args(argc, argv, "1*:", &cmd, &args, &kwargs);
+    record(self, sym_command, cmd, args, kwargs);
+    return self;
+}
+
+/*
+ * Batch#size -> Integer
+ */
+static VALUE
+batch_size(VALUE self)
+{
+    struct tcltk_batch *b = get_batch(self);
+    return LONG2NUM(b->count + RARRAY_LEN(b->pending));
+}
+
+/* ---------------------------------------------------------
+ * Execution (main thread only)
+ * --------------------------------------------------------- */
+
+static VALUE
+batch_execute_body(VALUE self)
+{
+    struct tcltk_batch *b = get_batch(self);
+    struct tcltk_interp *tip = get_interp(b->interp);
+    VALUE results = Qnil;
+    long i;
+
+    /* Convert anything recorded on a background thread */
+    for (i = 0; i < RARRAY_LEN(b->pending); i++) {
+        VALUE entry = RARRAY_AREF(b->pending, i);
+        record_native(b, RARRAY_AREF(entry, 0), RARRAY_AREF(entry, 1),
+                      RARRAY_AREF(entry, 2), RARRAY_AREF(entry, 3));
+    }
+    rb_ary_clear(b->pending);
+
+    if (b->want_results) {
+        results = rb_ary_new_capa(b->count);
+    }
+
+    for (i = 0; i < b->count; i++) {
+        Tcl_Size objc;
+        Tcl_Obj **objv;
+
+        Tcl_ListObjGetElements(NULL, b->cmds[i], &objc, &objv);
+        if (Tcl_EvalObjv(tip->interp, objc, objv, 0) != TCL_OK) {
+            VALUE msg = rb_sprintf("batch command %ld failed: %s", i,
+                                   Tcl_GetStringResult(tip->interp));
+            VALUE exc = rb_exc_new_str(eBatchError, msg);
+            rb_ivar_set(exc, rb_intern("@index"), LONG2NUM(i));
+            rb_ivar_set(exc, rb_intern("@results"),
+                        NIL_P(results) ? rb_ary_new() : results);
+            rb_exc_raise(exc);
+        }
+        if (b->want_results) {
+            rb_ary_push(results, rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp)));
+        }
+    }
+
+    return b->want_results ? results : LONG2NUM(b->count);
+}
+
+static VALUE
+batch_execute_cleanup(VALUE self)
+{
+    batch_release(get_batch(self));
+    return Qnil;
+}
+
+/* Run every recorded command. Called directly on the main thread, or
+ * from the thread-queue handler for batches built on a background thread. */
+VALUE
+teek_batch_execute(VALUE self)
+{
+    return rb_ensure(batch_execute_body, self, batch_execute_cleanup, self);
+}
+
+/* ---------------------------------------------------------
+ * Interp#batch(results: true, capacity: 16) { |b| ... }
+ *
+ * Yields a Teek::Batch for recording, then runs every recorded command
+ * in one pass. Returns an Array of result strings, or the number of
+ * commands run when results: false. Stops at the first failing command
+ * and raises Teek::BatchError, whose #index is the failing command's
+ * position and #results holds the results of the ones before it.
+ *
+ * Thread-safe: from a background thread the whole batch crosses to the
+ * main thread once.
+ * --------------------------------------------------------- */
+
+static VALUE
+batch_run(VALUE self)
+{
+    struct tcltk_batch *b = get_batch(self);
+    struct tcltk_interp *tip;
+
+    rb_yield(self);
+    b->closed = 1;
+
+    if (b->count == 0 && RARRAY_LEN(b->pending) == 0) {
+        return b->want_results ? rb_ary_new() : INT2FIX(0);
+    }
+
+    tip = get_interp(b->interp);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_batch(tip, self);
+    }
+    return teek_batch_execute(self);
+}
+
+static VALUE
+batch_close(VALUE self)
+{
+    struct tcltk_batch *b = get_batch(self);
+
+    b->closed = 1;
+    batch_release(b);
+    rb_ary_clear(b->pending);
+    return Qnil;
+}
+
+static VALUE
+interp_batch(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_batch *b;
+    VALUE opts, batch;
+    ID kw_ids[2];
+    VALUE kw_vals[2];
+    long capa = BATCH_DEFAULT_CAPA;
+
+    rb_scan_args(argc, argv, "0:", &opts);
+    rb_need_block();
+    get_interp(self);
+
+    kw_ids[0] = id_results_kw;
+    kw_ids[1] = id_capacity_kw;
+    kw_vals[0] = kw_vals[1] = Qundef;
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, kw_ids, 0, 2, kw_vals);
+    }
+    if (kw_vals[1] != Qundef) {
+        capa = NUM2LONG(kw_vals[1]);
+        if (capa < 1) capa = 1;
+    }
+
+    batch = TypedData_Make_Struct(cBatch, struct tcltk_batch, &batch_type, b);
+    b->interp = self;
+    b->pending = rb_ary_new();
+    b->want_results = (kw_vals[0] == Qundef) ? 1 : RTEST(kw_vals[0]);
+    b->cmds = ALLOC_N(Tcl_Obj *, capa);
+    b->capa = capa;
+
+    return rb_ensure(batch_run, batch, batch_close, batch);
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkbatch(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    sym_invoke = ID2SYM(rb_intern("invoke"));
+    sym_command = ID2SYM(rb_intern("command"));
+    id_results_kw = rb_intern("results");
+    id_capacity_kw = rb_intern("capacity");
+
+    cBatch = rb_define_class_under(mTeek, "Batch", rb_cObject);
+    rb_undef_alloc_func(cBatch);  /* Only created by Interp#batch */
+    rb_define_method(cBatch, "invoke", batch_invoke, -1);
+    rb_define_method(cBatch, "command", batch_command, -1);
+    rb_define_method(cBatch, "size", batch_size, 0);
+
+    eBatchError = rb_define_class_under(mTeek, "BatchError", eTclError);
+    rb_define_attr(eBatchError, "index", 1, 0);
+    rb_define_attr(eBatchError, "results", 1, 0);
+
+    rb_define_method(cInterp, "batch", interp_batch, -1);
+}
@@ -0,0 +1,440 @@
+/*
+ * tkcallbacks.c - Widget-owned callbacks
+ *
+ * A Proc passed to Interp#command ("-command", a bind script, ...)
+ * used to get a callback slot that lived as long as the interp. Now
+ * the Procs converted for a command belong to the widget the command
+ * names: a StructureNotify handler on the window releases them after
+ * DestroyNotify, and configure/bind replace the one held under the
+ * same option or event as soon as the new one is in place. Item-level
+ * forms (".c bind tag <1>", ".t tag bind", ".m entryconfigure",
+ * ".c itemconfigure") do the same, keyed by tag or item too. A Proc
+ * also used outside any widget (or given to a command that names
+ * none) is pinned and kept, as before.
+ *
+ * Widgets don't hold callbacks exclusively: the same Proc keeps one
+ * id (tcltkbridge.c dedupes converted Procs by identity), so each
+ * slot counts its owners and is freed when the last one lets go.
+ */
+
+#include "tcltkbridge.h"
+
+/* One callback a widget holds */
+struct owned_callback {
+    Tcl_WideInt id;
+    char *key;                  /* Option or event it was given for, or NULL */
+};
+
+/* A window holding callbacks; its event handler's clientData */
+struct owned_widget {
+    struct callback_owners *co;
+    Tcl_HashEntry *entry;       /* In co->widgets, NULL once destroyed */
+    Tk_Window tkwin;
+    struct owned_callback *cbs;
+    int ncbs;
+    int capa;
+    struct owned_widget *next_dead;
+};
+
+/* Per-interp owner table, created on first use */
+struct callback_owners {
+    struct tcltk_interp *tip;
+    Tcl_HashTable widgets;      /* path -> struct owned_widget */
+    struct owned_widget *dead;  /* Destroyed, waiting for the idle release */
+    int release_pending;
+};
+
+static void release_dead_idle(ClientData);
+
+static struct callback_owners *
+get_owners(struct tcltk_interp *tip)
+{
+    struct callback_owners *co = tip->cb_owners;
+
+    if (!co) {
+        co = (struct callback_owners *)ckalloc(sizeof(*co));
+        co->tip = tip;
+        co->dead = NULL;
+        co->release_pending = 0;
+        Tcl_InitHashTable(&co->widgets, TCL_STRING_KEYS);
+        tip->cb_owners = co;
+    }
+    return co;
+}
+
+static void
+free_owned_widget(struct owned_widget *ow)
+{
+    int i;
+
+    for (i = 0; i < ow->ncbs; i++) {
+        if (ow->cbs[i].key) ckfree(ow->cbs[i].key);
+    }
+    if (ow->cbs) ckfree((char *)ow->cbs);
+    ckfree((char *)ow);
+}
+
+/* ---------------------------------------------------------
+ * Reference counting
+ * --------------------------------------------------------- */
+
+void
+teek_callback_release(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    struct callback_slot *slot = teek_callback_slot(tip, id);
+
+    if (!slot) return;  /* Unregistered explicitly meanwhile */
+    if (slot->owners > 0 && --slot->owners == 0) {
+        tip->cb_counts.owned--;
+    }
+    if (slot->owners == 0 && !slot->pinned) {
+        teek_unregister_callback(tip, id);
+    }
+}
+
+static void
+callback_retain(struct tcltk_interp *tip, Tcl_WideInt id)
+{
+    struct callback_slot *slot = teek_callback_slot(tip, id);
+
+    if (slot && slot->owners++ == 0) {
+        tip->cb_counts.owned++;
+    }
+}
+
+/* ---------------------------------------------------------
+ * Destroy handling
+ *
+ * Tk runs a window's <Destroy> bindings after its event handlers, and
+ * those may be callbacks it holds, so the release waits for idle.
+ * --------------------------------------------------------- */
+
+static void *
+release_dead(void *arg)
+{
+    struct callback_owners *co = (struct callback_owners *)arg;
+    struct owned_widget *ow;
+    int i;
+
+    while ((ow = co->dead) != NULL) {
+        co->dead = ow->next_dead;
+        for (i = 0; i < ow->ncbs; i++) {
+            teek_callback_release(co->tip, ow->cbs[i].id);
+        }
+        free_owned_widget(ow);
+    }
+    return NULL;
+}
+
+static void
+release_dead_idle(ClientData cd)
+{
+    struct callback_owners *co = (struct callback_owners *)cd;
+
+    co->release_pending = 0;
+    teek_call_with_gvl(release_dead, co);
+}
+
+static void
+owned_widget_event_proc(ClientData cd, XEvent *eventPtr)
+{
+    struct owned_widget *ow = (struct owned_widget *)cd;
+    struct callback_owners *co = ow->co;
+
+    if (eventPtr->type != DestroyNotify || ow->entry == NULL) return;
+
+    /* Tk drops the window's handlers itself after DestroyNotify. A
+     * widget created later under the same path gets a fresh entry. */
+    Tcl_DeleteHashEntry(ow->entry);
+    ow->entry = NULL;
+    ow->next_dead = co->dead;
+    co->dead = ow;
+    if (!co->release_pending) {
+        co->release_pending = 1;
+        Tcl_DoWhenIdle(release_dead_idle, (ClientData)co);
+    }
+}
+
+/* ---------------------------------------------------------
+ * Ownership
+ * --------------------------------------------------------- */
+
+/* The owner record for the live window at path, created on first use,
+ * or NULL if there is no such window */
+static struct owned_widget *
+owned_widget_for(struct tcltk_interp *tip, const char *path)
+{
+    struct callback_owners *co = get_owners(tip);
+    struct owned_widget *ow;
+    Tcl_HashEntry *entry;
+    Tcl_InterpState saved;
+    Tk_Window mainwin, tkwin = NULL;
+    int is_new;
+
+    entry = Tcl_FindHashEntry(&co->widgets, path);
+    if (entry) return (struct owned_widget *)Tcl_GetHashValue(entry);
+
+    /* Both lookups leave an error in the interp result on failure */
+    saved = Tcl_SaveInterpState(tip->interp, TCL_OK);
+    if ((mainwin = Tk_MainWindow(tip->interp)) != NULL) {
+        tkwin = Tk_NameToWindow(tip->interp, path, mainwin);
+    }
+    Tcl_RestoreInterpState(tip->interp, saved);
+    if (tkwin == NULL) return NULL;
+
+    ow = (struct owned_widget *)ckalloc(sizeof(*ow));
+    ow->co = co;
+    ow->entry = Tcl_CreateHashEntry(&co->widgets, path, &is_new);
+    ow->tkwin = tkwin;
+    ow->cbs = NULL;
+    ow->ncbs = 0;
+    ow->capa = 0;
+    ow->next_dead = NULL;
+    Tcl_SetHashValue(ow->entry, ow);
+    Tk_CreateEventHandler(tkwin, StructureNotifyMask, owned_widget_event_proc, (ClientData)ow);
+    return ow;
+}
+
+static int
+key_matches(const char *a, const char *b)
+{
+    return a && b && strcmp(a, b) == 0;
+}
+
+/* Give ow a hold on id under key. With replace, whatever it held under
+ * the same key is released (the option or binding now runs id). */
+static void
+owned_widget_add(struct owned_widget *ow, Tcl_WideInt id, const char *key, int replace)
+{
+    struct tcltk_interp *tip = ow->co->tip;
+    struct owned_callback *cb;
+    int i;
+
+    for (i = 0; i < ow->ncbs; i++) {
+        cb = &ow->cbs[i];
+        if (replace && key_matches(cb->key, key)) {
+            if (cb->id != id) {
+                Tcl_WideInt old = cb->id;
+                callback_retain(tip, id);
+                cb->id = id;
+                teek_callback_release(tip, old);
+            }
+            return;
+        }
+        if (cb->id == id && !replace) return;
+    }
+
+    if (ow->ncbs == ow->capa) {
+        size_t size;
+        ow->capa = ow->capa ? ow->capa * 2 : 4;
+        size = ow->capa * sizeof(*ow->cbs);
+        ow->cbs = (struct owned_callback *)(ow->cbs ? ckrealloc((char *)ow->cbs, size)
+                                                    : ckalloc(size));
+    }
+    cb = &ow->cbs[ow->ncbs++];
+    cb->id = id;
+    cb->key = NULL;
+    if (key) {
+        cb->key = ckalloc(strlen(key) + 1);
+        strcpy(cb->key, key);
+    }
+    callback_retain(tip, id);
+}
+
+/* Release what ow holds under key (everything if key is NULL) */
+static int
+owned_widget_drop(struct owned_widget *ow, const char *key)
+{
+    struct tcltk_interp *tip = ow->co->tip;
+    int i, kept = 0, dropped = 0;
+
+    for (i = 0; i < ow->ncbs; i++) {
+        struct owned_callback cb = ow->cbs[i];
+        if (key == NULL || key_matches(cb.key, key)) {
+            if (cb.key) ckfree(cb.key);
+            teek_callback_release(tip, cb.id);
+            dropped++;
+        } else {
+            ow->cbs[kept++] = cb;
+        }
+    }
+    ow->ncbs = kept;
+    return dropped;
+}
+
+void
+teek_callbacks_settle(struct tcltk_interp *tip, struct teek_cb_collect *collect,
+                      const char *path, const char *scope, int replace, int ok)
+{
+    struct owned_widget *ow = NULL;
+    int i;
+
+    if (!ok) {
+        /* Nothing else can be using a Proc the failed command introduced */
+        for (i = 0; i < collect->n; i++) {
+            struct callback_slot *slot;
+            if (!collect->refs[i].fresh) continue;
+            slot = teek_callback_slot(tip, collect->refs[i].id);
+            if (slot && slot->owners == 0 && !slot->pinned) {
+                teek_unregister_callback(tip, collect->refs[i].id);
+            }
+        }
+        collect->n = 0;
+        return;
+    }
+
+    if (path && !tip->deleted) ow = owned_widget_for(tip, path);
+    for (i = 0; i < collect->n; i++) {
+        Tcl_WideInt id = collect->refs[i].id;
+        Tcl_Obj *key = collect->refs[i].key;
+
+        if (ow && key && scope) {
+            Tcl_DString scoped;
+
+            Tcl_DStringInit(&scoped);
+            Tcl_DStringAppend(&scoped, scope, -1);
+            Tcl_DStringAppendElement(&scoped, Tcl_GetString(key));
+            owned_widget_add(ow, id, Tcl_DStringValue(&scoped), replace);
+            Tcl_DStringFree(&scoped);
+        } else if (ow) {
+            owned_widget_add(ow, id, key ? Tcl_GetString(key) : NULL, replace && key);
+        } else {
+            struct callback_slot *slot = teek_callback_slot(tip, id);
+            if (slot) slot->pinned = 1;
+        }
+    }
+    collect->n = 0;
+}
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+void
+teek_callbacks_free(struct tcltk_interp *tip)
+{
+    struct callback_owners *co = tip->cb_owners;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *e;
+    struct owned_widget *ow;
+
+    if (!co) return;
+
+    /* Windows still alive: unhook them. The slots go with the interp. */
+    for (e = Tcl_FirstHashEntry(&co->widgets, &search); e; e = Tcl_NextHashEntry(&search)) {
+        ow = (struct owned_widget *)Tcl_GetHashValue(e);
+        Tk_DeleteEventHandler(ow->tkwin, StructureNotifyMask, owned_widget_event_proc, (ClientData)ow);
+        free_owned_widget(ow);
+    }
+    Tcl_DeleteHashTable(&co->widgets);
+    if (co->release_pending) {
+        Tcl_CancelIdleCall(release_dead_idle, (ClientData)co);
+    }
+    while ((ow = co->dead) != NULL) {
+        co->dead = ow->next_dead;
+        free_owned_widget(ow);
+    }
+    ckfree((char *)co);
+    tip->cb_owners = NULL;
+}
+
+/* ---------------------------------------------------------
+ * Interp#callback_counts -> Hash
+ *
+ *   live:       callbacks registered now
+ *   registered: ids handed out since the interp was created
+ *   released:   ids unregistered, explicitly or when their widget died
+ *   reused:     Procs converted again that kept their existing id
+ *   owned:      live callbacks held by at least one widget
+ *   widgets:    widgets holding callbacks
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_callback_counts(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct teek_callback_counts *c = &tip->cb_counts;
+    VALUE h = rb_hash_new();
+
+    rb_hash_aset(h, ID2SYM(rb_intern("live")), ULONG2NUM(c->registered - c->released));
+    rb_hash_aset(h, ID2SYM(rb_intern("registered")), ULONG2NUM(c->registered));
+    rb_hash_aset(h, ID2SYM(rb_intern("released")), ULONG2NUM(c->released));
+    rb_hash_aset(h, ID2SYM(rb_intern("reused")), ULONG2NUM(c->reused));
+    rb_hash_aset(h, ID2SYM(rb_intern("owned")), LONG2NUM(c->owned));
+    rb_hash_aset(h, ID2SYM(rb_intern("widgets")),
+                 LONG2NUM(tip->cb_owners ? (long)tip->cb_owners->widgets.numEntries : 0));
+    return h;
+}
+
+/* ---------------------------------------------------------
+ * Interp#attach_callback(id, path, key = nil) -> true/false
+ *
+ * Hands callback id (from register_callback) to the widget at path, so
+ * it is unregistered when the widget is destroyed. With key (an event
+ * or option name) it replaces, and releases, whatever the widget held
+ * under that key. False if there is no such window; id is left alone.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_attach_callback(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct owned_widget *ow;
+    VALUE id, path, key;
+
+    rb_scan_args(argc, argv, "21", &id, &path, &key);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("attach_callback"), rb_ary_new_from_values(argc, argv));
+    }
+    path = rb_String(path);
+    if (!NIL_P(key)) key = rb_String(key);
+
+    if (!teek_callback_slot(tip, NUM2LL(id))) {
+        rb_raise(rb_eArgError, "unknown callback id: %"PRIsVALUE, id);
+    }
+    ow = owned_widget_for(tip, StringValueCStr(path));
+    if (!ow) return Qfalse;
+    owned_widget_add(ow, NUM2LL(id), NIL_P(key) ? NULL : StringValueCStr(key), !NIL_P(key));
+    return Qtrue;
+}
+
+/* ---------------------------------------------------------
+ * Interp#detach_callbacks(path, key = nil) -> Integer
+ *
+ * Releases what the widget at path holds under key (e.g. after its
+ * binding is removed), or everything with no key. Callbacks nothing
+ * else holds are unregistered. Returns how many it let go.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_detach_callbacks(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    Tcl_HashEntry *entry;
+    VALUE path, key;
+
+    rb_scan_args(argc, argv, "11", &path, &key);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("detach_callbacks"), rb_ary_new_from_values(argc, argv));
+    }
+    path = rb_String(path);
+    if (!NIL_P(key)) key = rb_String(key);
+
+    if (!tip->cb_owners) return INT2FIX(0);
+    entry = Tcl_FindHashEntry(&tip->cb_owners->widgets, StringValueCStr(path));
+    if (!entry) return INT2FIX(0);
+    return INT2NUM(owned_widget_drop((struct owned_widget *)Tcl_GetHashValue(entry),
+                                     NIL_P(key) ? NULL : StringValueCStr(key)));
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkcallbacks(VALUE cInterp)
+{
+    rb_define_method(cInterp, "callback_counts", interp_callback_counts, 0);
+    rb_define_method(cInterp, "attach_callback", interp_attach_callback, -1);
+    rb_define_method(cInterp, "detach_callbacks", interp_detach_callbacks, -1);
+}
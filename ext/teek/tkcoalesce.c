@@ -0,0 +1,319 @@
+/*
+ * tkcoalesce.c - Event coalescing for high-rate bindings
+ *
+ * A binding whose script is
+ *
+ *     ruby_coalesce latest|frame <callback id> ?%x %y ...?
+ *
+ * doesn't call into Ruby per event. The C command keeps only the most
+ * recent substitution values for that callback and a count of events
+ * merged into them, then calls the callback once with those values and
+ * the count appended: at the next idle point (latest), or at the next
+ * frame (frame) - each run_frames frame, before its block, or a 60 Hz
+ * timer outside run_frames. Motion, B1-Motion and Configure storms
+ * cost one Ruby call per delivery instead of one per event.
+ *
+ * Recording an event touches no Ruby state, so it runs without the GVL
+ * in the event-driven mainloop. Deliveries can't return break/continue
+ * to Tk: by then the event has been handled.
+ */
+
+#include "tcltkbridge.h"
+
+#define COALESCE_CMD "ruby_coalesce"
+
+/* Frame pacing for mode "frame" outside run_frames */
+#define COALESCE_FRAME_US 16667
+
+/* Latest values for one callback, waiting for delivery */
+struct coalesced {
+    Tcl_HashEntry *entry;       /* In ec->pending, keyed by the id word */
+    Tcl_WideInt id;
+    Tcl_Obj *args;              /* Substitution values of the newest event */
+    unsigned long merged;       /* Events since the last delivery */
+    struct coalesced *next;
+};
+
+/* FIFO of entries due at the same point */
+struct coalesce_queue {
+    struct coalesced *head;
+    struct coalesced *tail;
+};
+
+struct event_coalescer {
+    struct tcltk_interp *tip;
+    Tcl_HashTable pending;      /* id word -> struct coalesced */
+    struct coalesce_queue idle; /* mode latest */
+    struct coalesce_queue frame;/* mode frame */
+    int idle_pending;
+    Tcl_TimerToken frame_token;
+    Tcl_WideInt last_frame_us;  /* Last frame delivery (timer pacing) */
+};
+
+static void coalesce_idle_proc(ClientData);
+static void coalesce_frame_proc(ClientData);
+
+static void
+queue_push(struct coalesce_queue *q, struct coalesced *c)
+{
+    c->next = NULL;
+    if (q->tail) {
+        q->tail->next = c;
+    } else {
+        q->head = c;
+    }
+    q->tail = c;
+}
+
+static struct coalesced *
+queue_pop(struct coalesce_queue *q)
+{
+    struct coalesced *c = q->head;
+
+    if (c) {
+        q->head = c->next;
+        if (q->head == NULL) q->tail = NULL;
+    }
+    return c;
+}
+
+static void
+free_coalesced(struct coalesced *c)
+{
+    if (c->entry) Tcl_DeleteHashEntry(c->entry);
+    Tcl_DecrRefCount(c->args);
+    ckfree((char *)c);
+}
+
+static void
+schedule_frame(struct event_coalescer *ec)
+{
+    Tcl_WideInt wait;
+
+    /* run_frames delivers these itself, once per frame */
+    if (ec->frame_token || ec->frame.head == NULL || ec->tip->frame_loop_active) return;
+
+    wait = ec->last_frame_us + COALESCE_FRAME_US - teek_now_us();
+    if (wait < 0) wait = 0;
+    ec->frame_token = Tcl_CreateTimerHandler((int)((wait + 999) / 1000),
+                                             coalesce_frame_proc, (ClientData)ec);
+}
+
+/* ---------------------------------------------------------
+ * Delivery (GVL held)
+ * --------------------------------------------------------- */
+
+struct delivery {
+    struct tcltk_interp *tip;
+    struct coalesced *c;
+};
+
+static VALUE
+deliver_call(VALUE arg)
+{
+    struct delivery *d = (struct delivery *)arg;
+    struct callback_slot *slot = teek_callback_slot(d->tip, d->c->id);
+    Tcl_Size objc;
+    Tcl_Obj **objv;
+    VALUE args;
+
+    /* Its widget went away (or it was unregistered) meanwhile */
+    if (slot == NULL) return INT2FIX(TCL_OK);
+
+    Tcl_ListObjGetElements(NULL, d->c->args, &objc, &objv);
+    args = teek_callback_args(slot, objc, objv);
+    rb_ary_push(args, ULONG2NUM(d->c->merged));
+    d->tip->loop_stats.coalesce_deliveries++;
+    return INT2FIX(teek_run_callback(d->tip, d->c->id, args));
+}
+
+/* Deliver everything in q. Entries recorded while this runs were given
+ * a fresh entry and wait for the next round. */
+static void
+deliver_queue(struct event_coalescer *ec, struct coalesce_queue *q)
+{
+    struct coalesce_queue batch = *q;
+    struct tcltk_interp *tip = ec->tip;
+    struct delivery d;
+    int state = 0;
+
+    q->head = q->tail = NULL;
+    d.tip = tip;
+    while ((d.c = queue_pop(&batch)) != NULL) {
+        VALUE code;
+
+        /* Out of the table first: a new event starts a new entry */
+        Tcl_DeleteHashEntry(d.c->entry);
+        d.c->entry = NULL;
+        if (tip->deleted) {
+            free_coalesced(d.c);
+            continue;
+        }
+
+        code = rb_protect(deliver_call, (VALUE)&d, &state);
+        free_coalesced(d.c);
+        if (state) break;
+        if (code == INT2FIX(TCL_ERROR) && !tip->deleted) {
+            Tcl_BackgroundException(tip->interp, TCL_ERROR);
+        }
+    }
+
+    if (state) {
+        /* SystemExit/Interrupt: the rest go out next time round */
+        while ((d.c = queue_pop(&batch)) != NULL) {
+            queue_push(q, d.c);
+        }
+        if (q == &ec->idle && q->head && !ec->idle_pending) {
+            ec->idle_pending = 1;
+            Tcl_DoWhenIdle(coalesce_idle_proc, (ClientData)ec);
+        }
+        if (q == &ec->frame) schedule_frame(ec);
+        rb_jump_tag(state);
+    }
+}
+
+static void *
+deliver_idle(void *arg)
+{
+    struct event_coalescer *ec = (struct event_coalescer *)arg;
+    deliver_queue(ec, &ec->idle);
+    return NULL;
+}
+
+static void *
+deliver_frame(void *arg)
+{
+    struct event_coalescer *ec = (struct event_coalescer *)arg;
+
+    ec->last_frame_us = teek_now_us();
+    deliver_queue(ec, &ec->frame);
+    schedule_frame(ec);
+    return NULL;
+}
+
+static void
+coalesce_idle_proc(ClientData cd)
+{
+    struct event_coalescer *ec = (struct event_coalescer *)cd;
+
+    ec->idle_pending = 0;
+    teek_call_with_gvl(deliver_idle, ec);
+}
+
+static void
+coalesce_frame_proc(ClientData cd)
+{
+    struct event_coalescer *ec = (struct event_coalescer *)cd;
+
+    ec->frame_token = NULL;
+    teek_call_with_gvl(deliver_frame, ec);
+}
+
+void
+teek_coalesce_flush_frame(struct tcltk_interp *tip)
+{
+    struct event_coalescer *ec = tip->coalesce;
+
+    if (ec && ec->frame.head) deliver_frame(ec);
+}
+
+void
+teek_coalesce_frames_ended(struct tcltk_interp *tip)
+{
+    if (tip->coalesce) schedule_frame(tip->coalesce);
+}
+
+/* ---------------------------------------------------------
+ * ruby_coalesce latest|frame id ?args...? (no Ruby, safe without the GVL)
+ * --------------------------------------------------------- */
+
+static int
+ruby_coalesce_cmd(ClientData cd, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    static const char *const modes[] = { "latest", "frame", NULL };
+    struct tcltk_interp *tip = (struct tcltk_interp *)cd;
+    struct event_coalescer *ec = tip->coalesce;
+    struct coalesced *c;
+    Tcl_HashEntry *entry;
+    Tcl_WideInt id;
+    int mode, is_new;
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "latest|frame id ?arg ...?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], modes, "mode", 0, &mode) != TCL_OK) {
+        return TCL_ERROR;
+    }
+    if (Tcl_GetWideIntFromObj(NULL, objv[2], &id) != TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("unknown callback id: %s",
+                         Tcl_GetString(objv[2])));
+        return TCL_ERROR;
+    }
+
+    if (!ec) {
+        ec = (struct event_coalescer *)ckalloc(sizeof(*ec));
+        memset(ec, 0, sizeof(*ec));
+        ec->tip = tip;
+        Tcl_InitHashTable(&ec->pending, TCL_STRING_KEYS);
+        tip->coalesce = ec;
+    }
+    tip->loop_stats.coalesced++;
+
+    entry = Tcl_CreateHashEntry(&ec->pending, Tcl_GetString(objv[2]), &is_new);
+    if (!is_new) {
+        /* Already waiting: just take the newer values */
+        c = (struct coalesced *)Tcl_GetHashValue(entry);
+        Tcl_DecrRefCount(c->args);
+        c->args = Tcl_NewListObj(objc - 3, objv + 3);
+        Tcl_IncrRefCount(c->args);
+        c->merged++;
+        return TCL_OK;
+    }
+
+    c = (struct coalesced *)ckalloc(sizeof(*c));
+    c->entry = entry;
+    c->id = id;
+    c->args = Tcl_NewListObj(objc - 3, objv + 3);
+    Tcl_IncrRefCount(c->args);
+    c->merged = 1;
+    Tcl_SetHashValue(entry, c);
+
+    if (mode == 0) {
+        queue_push(&ec->idle, c);
+        if (!ec->idle_pending) {
+            ec->idle_pending = 1;
+            Tcl_DoWhenIdle(coalesce_idle_proc, (ClientData)ec);
+        }
+    } else {
+        queue_push(&ec->frame, c);
+        schedule_frame(ec);
+    }
+    return TCL_OK;
+}
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+void
+teek_coalesce_install(struct tcltk_interp *tip)
+{
+    Tcl_CreateObjCommand(tip->interp, COALESCE_CMD, ruby_coalesce_cmd, (ClientData)tip, NULL);
+}
+
+void
+teek_coalesce_free(struct tcltk_interp *tip)
+{
+    struct event_coalescer *ec = tip->coalesce;
+    struct coalesced *c;
+
+    if (!ec) return;
+    if (ec->idle_pending) Tcl_CancelIdleCall(coalesce_idle_proc, (ClientData)ec);
+    if (ec->frame_token) Tcl_DeleteTimerHandler(ec->frame_token);
+    while ((c = queue_pop(&ec->idle)) != NULL) free_coalesced(c);
+    while ((c = queue_pop(&ec->frame)) != NULL) free_coalesced(c);
+    Tcl_DeleteHashTable(&ec->pending);
+    ckfree((char *)ec);
+    tip->coalesce = NULL;
+}
@@ -7,6 +7,9 @@
  * The consumer passes a C function pointer via a Ruby method call at
  * registration time. The Tcl event source setup/check procs call that
  * pointer directly — no rb_funcall, no method dispatch.
+ *
+ * With Interp#mainloop_mode = :event the check function runs without
+ * the GVL, so it must not call into Ruby.
  */
 
 #include "tcltkbridge.h"
@@ -0,0 +1,253 @@
+/*
+ * tkframes.c - Frame-paced loop driver
+ *
+ * Interp#run_frames(fps:) drives a game-style loop from C. Each frame
+ * it processes pending Tk events (up to an event budget) with
+ * Tcl_DoOneEvent(TCL_DONT_WAIT), yields to the per-frame Ruby block,
+ * then sleeps without the GVL until the next frame is due. The sleep
+ * stops a little early and spins for the last stretch, so frames start
+ * within tens of microseconds of their deadline instead of overshooting
+ * by a scheduler tick the way a Ruby `sleep` loop does.
+ */
+
+#include "tcltkbridge.h"
+#include "ruby/thread.h"
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* Wake this long before the deadline and spin the rest */
+#define FRAME_SPIN_US 300
+
+static VALUE cFrameTiming;
+static ID id_fps_kw, id_frames_kw, id_event_budget_ms_kw;
+
+/* ---------------------------------------------------------
+ * Precise sleep (runs without the GVL)
+ * --------------------------------------------------------- */
+
+struct frame_sleep {
+    Tcl_WideInt deadline;       /* teek_now_us() to wake at */
+    volatile int interrupted;   /* Set by the unblocking function */
+};
+
+static void
+sleep_us(Tcl_WideInt us)
+{
+#ifdef _WIN32
+    Sleep((DWORD)(us / 1000));
+#else
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(us / 1000000);
+    ts.tv_nsec = (long)(us % 1000000) * 1000;
+    nanosleep(&ts, NULL);  /* EINTR just ends this round early */
+#endif
+}
+
+static void *
+frame_sleep_nogvl(void *arg)
+{
+    struct frame_sleep *fs = (struct frame_sleep *)arg;
+    Tcl_WideInt left;
+
+    while (!fs->interrupted && (left = fs->deadline - teek_now_us()) > 0) {
+        if (left > FRAME_SPIN_US) {
+            sleep_us(left - FRAME_SPIN_US);
+        }
+        /* else spin: the last few hundred microseconds */
+    }
+    return NULL;
+}
+
+static void
+frame_sleep_ubf(void *arg)
+{
+    ((struct frame_sleep *)arg)->interrupted = 1;
+}
+
+/* ---------------------------------------------------------
+ * Interp#run_frames(fps: 60, frames: nil, event_budget_ms: nil) { |timing| ... }
+ *
+ * Runs the block once per frame at the target rate until the block
+ * breaks, `frames` frames have run, or every Tk main window is gone.
+ * Returns the number of frames run.
+ *
+ * Each frame:
+ *   1. Tk events are processed (DONT_WAIT) until none are pending or
+ *      event_budget_ms (default: half the frame) is used up; at least
+ *      one is, whatever the budget, so Tk keeps redrawing
+ *   2. the block is called with a Teek::FrameTiming
+ *   3. the rest of the frame is slept away without the GVL, so other
+ *      Ruby threads run
+ *
+ * FrameTiming#frame and #dt (seconds since the previous frame started)
+ * describe the current frame. The timing fields describe the previous
+ * one (zero on the first): event_ms, callback_ms (the part of event_ms
+ * spent in Ruby callbacks), render_ms (the block), slack_ms (time left
+ * to sleep; negative when the frame overran) and late (overran).
+ * A frame that overruns by more than a whole period resets the schedule
+ * instead of trying to catch up.
+ * --------------------------------------------------------- */
+
+struct frame_loop {
+    struct tcltk_interp *tip;
+    Tcl_WideInt period_us;
+    Tcl_WideInt event_budget_us;
+    long max_frames;            /* -1 for no limit */
+    long count;
+};
+
+static VALUE
+frame_loop_body(VALUE arg)
+{
+    struct frame_loop *fl = (struct frame_loop *)arg;
+    struct tcltk_interp *tip = fl->tip;
+    Tcl_WideInt frame_start = teek_now_us();
+    Tcl_WideInt prev_start = frame_start;
+    double event_ms = 0, callback_ms = 0, render_ms = 0, slack_ms = 0;
+    int late = 0;
+
+    while (fl->max_frames < 0 || fl->count < fl->max_frames) {
+        Tcl_WideInt t_events, t_render, t_done, deadline;
+        struct frame_sleep fs;
+        VALUE timing;
+
+        if (tip->deleted || Tk_GetNumMainWindows() == 0) break;
+
+        /* 1. Tk events, up to the budget (but always one) */
+        t_events = teek_now_us();
+        tip->frame_cb_us = 0;
+        do {
+            if (!teek_do_one_event(tip, TCL_ALL_EVENTS | TCL_DONT_WAIT)) break;
+        } while (teek_now_us() - t_events < fl->event_budget_us);
+        /* Bindings coalesced per frame get this frame's latest values */
+        if (!tip->deleted) teek_coalesce_flush_frame(tip);
+        if (tip->deleted || Tk_GetNumMainWindows() == 0) break;
+
+        /* 2. The frame callback */
+        t_render = teek_now_us();
+        timing = rb_struct_new(cFrameTiming,
+                               LONG2NUM(fl->count),
+                               DBL2NUM((double)(frame_start - prev_start) / 1e6),
+                               DBL2NUM(event_ms), DBL2NUM(callback_ms),
+                               DBL2NUM(render_ms), DBL2NUM(slack_ms),
+                               late ? Qtrue : Qfalse);
+        event_ms = (double)(t_render - t_events) / 1000.0;
+        callback_ms = (double)tip->frame_cb_us / 1000.0;
+        rb_yield(timing);
+        fl->count++;
+
+        /* 3. Sleep out the rest of the frame */
+        t_done = teek_now_us();
+        render_ms = (double)(t_done - t_render) / 1000.0;
+        deadline = frame_start + fl->period_us;
+        slack_ms = (double)(deadline - t_done) / 1000.0;
+        late = deadline < t_done;
+
+        if (!late) {
+            fs.deadline = deadline;
+            fs.interrupted = 0;
+            rb_thread_call_without_gvl(frame_sleep_nogvl, &fs, frame_sleep_ubf, &fs);
+            rb_thread_check_ints();
+        }
+
+        prev_start = frame_start;
+        if (t_done - deadline > fl->period_us) {
+            frame_start = teek_now_us();   /* Too far behind: start over */
+        } else {
+            frame_start = deadline;
+        }
+    }
+    return Qnil;
+}
+
+static VALUE
+frame_loop_ensure(VALUE arg)
+{
+    struct frame_loop *fl = (struct frame_loop *)arg;
+    fl->tip->frame_loop_active = 0;
+    if (!fl->tip->deleted) teek_coalesce_frames_ended(fl->tip);
+    return Qnil;
+}
+
+static VALUE
+interp_run_frames(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct frame_loop fl;
+    VALUE opts;
+    ID kw_ids[3];
+    VALUE kw_vals[3];
+    double fps = 60.0;
+
+    rb_scan_args(argc, argv, "0:", &opts);
+    rb_need_block();
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        rb_raise(eTclError, "run_frames must be called from the main thread");
+    }
+    if (tip->frame_loop_active) {
+        rb_raise(eTclError, "run_frames is already running");
+    }
+
+    kw_ids[0] = id_fps_kw;
+    kw_ids[1] = id_frames_kw;
+    kw_ids[2] = id_event_budget_ms_kw;
+    kw_vals[0] = kw_vals[1] = kw_vals[2] = Qundef;
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, kw_ids, 0, 3, kw_vals);
+    }
+
+    if (kw_vals[0] != Qundef) {
+        fps = NUM2DBL(kw_vals[0]);
+        if (!(fps > 0 && fps <= 1000)) {
+            rb_raise(rb_eArgError, "fps must be between 0 and 1000 (got %g)", fps);
+        }
+    }
+
+    fl.tip = tip;
+    fl.period_us = (Tcl_WideInt)(1e6 / fps);
+    fl.event_budget_us = fl.period_us / 2;
+    fl.max_frames = -1;
+    fl.count = 0;
+
+    if (kw_vals[1] != Qundef && !NIL_P(kw_vals[1])) {
+        fl.max_frames = NUM2LONG(kw_vals[1]);
+        if (fl.max_frames < 0) fl.max_frames = 0;
+    }
+    if (kw_vals[2] != Qundef && !NIL_P(kw_vals[2])) {
+        double ms = NUM2DBL(kw_vals[2]);
+        if (ms < 0) {
+            rb_raise(rb_eArgError, "event_budget_ms must be >= 0 (got %g)", ms);
+        }
+        fl.event_budget_us = (Tcl_WideInt)(ms * 1000.0);
+    }
+
+    tip->frame_loop_active = 1;
+    rb_ensure(frame_loop_body, (VALUE)&fl, frame_loop_ensure, (VALUE)&fl);
+    return LONG2NUM(fl.count);
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkframes(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    id_fps_kw = rb_intern("fps");
+    id_frames_kw = rb_intern("frames");
+    id_event_budget_ms_kw = rb_intern("event_budget_ms");
+
+    /* Teek::FrameTiming - yielded by Interp#run_frames */
+    cFrameTiming = rb_struct_define_under(mTeek, "FrameTiming",
+                                          "frame", "dt", "event_ms", "callback_ms",
+                                          "render_ms", "slack_ms", "late", NULL);
+
+    rb_define_method(cInterp, "run_frames", interp_run_frames, -1);
+}
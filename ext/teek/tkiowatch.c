@@ -0,0 +1,658 @@
+/*
+ * tkiowatch.c - IO readiness in the event loop (Teek::IOWatch)
+ *
+ * Interp#watch_io registers the IO's file descriptor with Tcl's notifier
+ * through Tcl_CreateFileHandler, so the loop wakes when the descriptor
+ * is readable or writable and calls the block - no helper thread per
+ * stream and no polling interval. In mainloop_mode :event the wait
+ * happens without the GVL, like any other Tcl event.
+ *
+ * Tcl keeps one handler per descriptor per thread, so watches on the
+ * same descriptor share one entry here: the handler is registered for
+ * the union of their events and each watch is called for the events it
+ * asked for. The block sits in a callback slot like a timer's, so it
+ * shows up in Interp#stats and #callback_top.
+ *
+ * Watching is level-triggered: a block that doesn't consume the data
+ * is called again on the next pass. Not available on Windows, where
+ * Tcl has no file handlers.
+ *
+ * Tcl's notifier must never wait on a closed descriptor (select fails
+ * with EBADF and the notifier thread spins), so an event source checks
+ * before every wait for watched descriptors closed on the Ruby side and
+ * takes them out of the notifier; the watches are released at the next
+ * idle point. A descriptor number reused by a newer file is caught when
+ * its watch next fires and finds its IO closed.
+ */
+
+#include "tcltkbridge.h"
+#include <ruby/io.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#endif
+
+static VALUE cIOWatch;
+static ID id_site_kw, id_start_io_watch, id_fileno, id_closed_p;
+static ID id_read, id_write, id_priority;
+
+/* Per-interp state, created with the first watch */
+struct io_watches {
+    Tcl_HashTable fds;          /* fd -> struct io_fd */
+    int sweep_pending;          /* io_sweep_proc queued */
+};
+
+/* Watches on one descriptor, sharing its Tcl file handler */
+struct io_fd {
+    struct tcltk_interp *tip;
+    Tcl_HashEntry *entry;       /* In tip->io_watches->fds, keyed by fd */
+    int fd;
+    int mask;                   /* TCL_READABLE|... currently registered */
+    int dispatching;            /* Nesting depth of io_fd_dispatch */
+    struct io_watch *watches;
+};
+
+struct io_watch {
+    struct tcltk_interp *tip;   /* NULL once the interp is freed */
+    VALUE self;                 /* The Teek::IOWatch (pinned while linked) */
+    VALUE interp;               /* Teek::Interp (GC-marked) */
+    VALUE io;
+    int fd;
+    int mask;                   /* Tcl event mask asked for */
+    Tcl_WideInt cb_id;          /* Callback slot holding the block, 0 once released */
+    unsigned long calls;
+    int cancelled;
+    int firing;                 /* Inside the block; not dispatched again */
+    struct io_fd *ifd;          /* Linked on ifd->watches, or NULL */
+    struct io_watch *prev, *next;
+};
+
+/* Ruby's IO::READABLE/PRIORITY/WRITABLE <-> Tcl's file event mask */
+static int
+tcl_mask_from_ruby(int events)
+{
+    int mask = 0;
+    if (events & RUBY_IO_READABLE) mask |= TCL_READABLE;
+    if (events & RUBY_IO_WRITABLE) mask |= TCL_WRITABLE;
+    if (events & RUBY_IO_PRIORITY) mask |= TCL_EXCEPTION;
+    return mask;
+}
+
+static int
+ruby_events_from_tcl(int mask)
+{
+    int events = 0;
+    if (mask & TCL_READABLE) events |= RUBY_IO_READABLE;
+    if (mask & TCL_WRITABLE) events |= RUBY_IO_WRITABLE;
+    if (mask & TCL_EXCEPTION) events |= RUBY_IO_PRIORITY;
+    return events;
+}
+
+#ifndef _WIN32
+
+/* The descriptor was closed under the watch (no Ruby, safe without the GVL) */
+static int
+fd_closed(int fd)
+{
+    return fcntl(fd, F_GETFD) == -1 && errno == EBADF;
+}
+
+static void io_fd_proc(ClientData, int);
+static void io_setup_proc(ClientData, int);
+static void io_check_proc(ClientData, int);
+static void io_sweep_proc(ClientData);
+
+/* ---------------------------------------------------------
+ * Descriptor table (main thread, GVL held)
+ * --------------------------------------------------------- */
+
+/* Re-register the Tcl handler for the events still wanted, and drop
+ * the entry once nothing watches the descriptor. A watch whose block
+ * is running wants nothing: if the block calls update before reading,
+ * the still-ready descriptor must not keep queueing events for it. */
+static void
+io_fd_update(struct io_fd *ifd)
+{
+    struct io_watch *w;
+    int mask = 0;
+
+    for (w = ifd->watches; w; w = w->next) {
+        if (!w->cancelled && !w->firing) mask |= w->mask;
+    }
+    if (mask != ifd->mask) {
+        if (mask) {
+            Tcl_CreateFileHandler(ifd->fd, mask, io_fd_proc, (ClientData)ifd);
+        } else {
+            Tcl_DeleteFileHandler(ifd->fd);
+        }
+        ifd->mask = mask;
+    }
+    if (ifd->watches == NULL && !ifd->dispatching) {
+        Tcl_DeleteHashEntry(ifd->entry);
+        ckfree((char *)ifd);
+    }
+}
+
+static void
+watch_link(struct tcltk_interp *tip, struct io_watch *w)
+{
+    struct io_fd *ifd;
+    Tcl_HashEntry *entry;
+    int is_new;
+
+    if (!tip->io_watches) {
+        tip->io_watches = (struct io_watches *)ckalloc(sizeof(struct io_watches));
+        Tcl_InitHashTable(&tip->io_watches->fds, TCL_ONE_WORD_KEYS);
+        tip->io_watches->sweep_pending = 0;
+        Tcl_CreateEventSource(io_setup_proc, io_check_proc, (ClientData)tip);
+    }
+    entry = Tcl_CreateHashEntry(&tip->io_watches->fds, (char *)(intptr_t)w->fd, &is_new);
+    if (is_new) {
+        ifd = (struct io_fd *)ckalloc(sizeof(*ifd));
+        memset(ifd, 0, sizeof(*ifd));
+        ifd->tip = tip;
+        ifd->entry = entry;
+        ifd->fd = w->fd;
+        Tcl_SetHashValue(entry, ifd);
+    } else {
+        ifd = (struct io_fd *)Tcl_GetHashValue(entry);
+    }
+
+    w->prev = NULL;
+    w->next = ifd->watches;
+    if (ifd->watches) ifd->watches->prev = w;
+    ifd->watches = w;
+    w->ifd = ifd;
+    io_fd_update(ifd);
+}
+
+/* Off the descriptor's list; the caller updates the handler */
+static void
+watch_unlink(struct io_watch *w)
+{
+    struct io_fd *ifd = w->ifd;
+
+    if (!ifd) return;
+    if (w->prev) {
+        w->prev->next = w->next;
+    } else {
+        ifd->watches = w->next;
+    }
+    if (w->next) w->next->prev = w->prev;
+    w->prev = w->next = NULL;
+    w->ifd = NULL;
+}
+
+/* Done for good: drop the callback slot, the pin and, if it was the
+ * last watch, the Tcl handler. While its descriptor is dispatching the
+ * watch stays listed (cancelled) and is swept when dispatch ends; a
+ * watch cancelled from its own block keeps its slot until it returns. */
+static void
+watch_release(struct io_watch *w)
+{
+    struct io_fd *ifd = w->ifd;
+
+    w->cancelled = 1;
+    if (!w->firing) {
+        if (w->tip && w->cb_id) teek_unregister_callback(w->tip, w->cb_id);
+        w->cb_id = 0;
+    }
+    if (!ifd) return;
+    if (!ifd->dispatching) watch_unlink(w);
+    io_fd_update(ifd);
+}
+
+/* Release and unlink the cancelled watches left listed while the
+ * descriptor was dispatching (or by io_setup_proc). Frees ifd if no
+ * watch is left. */
+static void
+io_fd_sweep(struct io_fd *ifd)
+{
+    struct io_watch *w, *next;
+
+    ifd->dispatching++;
+    for (w = ifd->watches; w; w = next) {
+        next = w->next;
+        if (w->cancelled) {
+            watch_release(w);
+            watch_unlink(w);
+        }
+    }
+    ifd->dispatching--;
+    io_fd_update(ifd);
+}
+
+/* ---------------------------------------------------------
+ * Dispatch
+ * --------------------------------------------------------- */
+
+struct io_dispatch {
+    struct io_fd *ifd;
+    struct io_watch *w;
+    int ready;                  /* Tcl mask reported by the notifier */
+};
+
+static VALUE
+watch_call(VALUE arg)
+{
+    struct io_dispatch *d = (struct io_dispatch *)arg;
+    struct io_watch *w = d->w;
+    VALUE args;
+
+    if (RTEST(rb_funcall(w->io, id_closed_p, 0))) return Qnil;
+    args = rb_ary_new_from_args(2, w->io,
+                                INT2FIX(ruby_events_from_tcl(d->ready & w->mask)));
+    return INT2FIX(teek_run_callback(w->tip, w->cb_id, args));
+}
+
+static void *
+io_fd_dispatch(void *arg)
+{
+    struct io_dispatch *d = (struct io_dispatch *)arg;
+    struct io_fd *ifd = d->ifd;
+    struct tcltk_interp *tip = ifd->tip;
+    struct io_watch *w, *next;
+    int state = 0;
+
+    ifd->dispatching++;
+    for (w = ifd->watches; w && !state; w = next) {
+        VALUE code;
+
+        next = w->next;
+        if (w->cancelled || w->firing || !(w->mask & d->ready)) continue;
+        if (tip->deleted) {
+            watch_release(w);
+            continue;
+        }
+
+        d->w = w;
+        w->calls++;
+        w->firing = 1;
+        io_fd_update(ifd);
+        code = rb_protect(watch_call, (VALUE)d, &state);
+        w->firing = 0;
+
+        if (state || NIL_P(code) || w->cancelled || fd_closed(w->fd)) {
+            /* Interrupted, cancelled or IO closed, before or by the block */
+            watch_release(w);
+        } else if (code == INT2FIX(TCL_ERROR)) {
+            /* Still ready, so it would fail again on every pass */
+            watch_release(w);
+            if (!tip->deleted) Tcl_BackgroundException(tip->interp, TCL_ERROR);
+        } else {
+            io_fd_update(ifd);
+        }
+    }
+    ifd->dispatching--;
+
+    /* Watches cancelled while their neighbours ran */
+    if (!ifd->dispatching) io_fd_sweep(ifd);
+
+    if (state) rb_jump_tag(state);
+    return NULL;
+}
+
+/* Release the watches io_setup_proc found closed */
+static void *
+io_sweep(void *arg)
+{
+    struct tcltk_interp *tip = (struct tcltk_interp *)arg;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *entry;
+
+    if (!tip->io_watches) return NULL;
+    tip->io_watches->sweep_pending = 0;
+    for (entry = Tcl_FirstHashEntry(&tip->io_watches->fds, &search); entry;
+         entry = Tcl_NextHashEntry(&search)) {
+        struct io_fd *ifd = (struct io_fd *)Tcl_GetHashValue(entry);
+
+        /* Deleting the entry just returned is allowed mid-search */
+        if (!ifd->dispatching) io_fd_sweep(ifd);
+    }
+    return NULL;
+}
+
+static void
+io_sweep_proc(ClientData cd)
+{
+    teek_call_with_gvl(io_sweep, cd);
+}
+
+/* Event source setup, before each wait (no Ruby, safe without the GVL) */
+static void
+io_setup_proc(ClientData cd, int flags)
+{
+    struct tcltk_interp *tip = (struct tcltk_interp *)cd;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *entry;
+    int found = 0;
+
+    if (!(flags & TCL_FILE_EVENTS)) return;
+    for (entry = Tcl_FirstHashEntry(&tip->io_watches->fds, &search); entry;
+         entry = Tcl_NextHashEntry(&search)) {
+        struct io_fd *ifd = (struct io_fd *)Tcl_GetHashValue(entry);
+        struct io_watch *w;
+        int gone = 0;
+
+        for (w = ifd->watches; w; w = w->next) {
+            if (!w->cancelled && fd_closed(w->fd)) {
+                w->cancelled = 1;
+                gone = 1;
+            }
+        }
+        if (gone) {
+            io_fd_update(ifd);   /* Watches stay listed: never frees ifd */
+            found = 1;
+        }
+    }
+    if (found && !tip->io_watches->sweep_pending) {
+        tip->io_watches->sweep_pending = 1;
+        Tcl_DoWhenIdle(io_sweep_proc, (ClientData)tip);
+    }
+}
+
+static void
+io_check_proc(ClientData cd, int flags)
+{
+}
+
+static void
+io_fd_proc(ClientData cd, int mask)
+{
+    struct io_dispatch d;
+
+    d.ifd = (struct io_fd *)cd;
+    d.w = NULL;
+    d.ready = mask;
+    teek_call_with_gvl(io_fd_dispatch, &d);
+}
+
+#endif /* !_WIN32 */
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+static void
+watch_mark(void *ptr)
+{
+    struct io_watch *w = ptr;
+    rb_gc_mark(w->interp);
+    rb_gc_mark(w->io);
+}
+
+static void
+watch_free(void *ptr)
+{
+    struct io_watch *w = ptr;
+
+#ifndef _WIN32
+    /* Only reached unlinked, or together with an unreachable interp */
+    if (w->ifd) {
+        struct io_fd *ifd = w->ifd;
+        watch_unlink(w);
+        io_fd_update(ifd);
+    }
+#endif
+    xfree(w);
+}
+
+static size_t
+watch_memsize(const void *ptr)
+{
+    return sizeof(struct io_watch);
+}
+
+static const rb_data_type_t watch_type = {
+    .wrap_struct_name = "Teek::IOWatch",
+    .function = {
+        .dmark = watch_mark,
+        .dfree = watch_free,
+        .dsize = watch_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+void
+teek_io_watches_mark(struct tcltk_interp *tip)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *entry;
+
+    if (!tip->io_watches) return;
+    for (entry = Tcl_FirstHashEntry(&tip->io_watches->fds, &search); entry;
+         entry = Tcl_NextHashEntry(&search)) {
+        struct io_fd *ifd = (struct io_fd *)Tcl_GetHashValue(entry);
+        struct io_watch *w;
+        for (w = ifd->watches; w; w = w->next) {
+            rb_gc_mark(w->self);
+        }
+    }
+}
+
+void
+teek_io_watches_free(struct tcltk_interp *tip)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *entry;
+
+    if (!tip->io_watches) return;
+#ifndef _WIN32
+    Tcl_DeleteEventSource(io_setup_proc, io_check_proc, (ClientData)tip);
+    if (tip->io_watches->sweep_pending) Tcl_CancelIdleCall(io_sweep_proc, (ClientData)tip);
+#endif
+    for (entry = Tcl_FirstHashEntry(&tip->io_watches->fds, &search); entry;
+         entry = Tcl_NextHashEntry(&search)) {
+        struct io_fd *ifd = (struct io_fd *)Tcl_GetHashValue(entry);
+        struct io_watch *w, *next;
+
+#ifndef _WIN32
+        if (ifd->mask) Tcl_DeleteFileHandler(ifd->fd);
+#endif
+        for (w = ifd->watches; w; w = next) {
+            next = w->next;
+            w->prev = w->next = NULL;
+            w->ifd = NULL;
+            w->tip = NULL;
+            w->cb_id = 0;
+        }
+        ckfree((char *)ifd);
+    }
+    Tcl_DeleteHashTable(&tip->io_watches->fds);
+    ckfree((char *)tip->io_watches);
+    tip->io_watches = NULL;
+}
+
+static struct io_watch *
+get_watch(VALUE self)
+{
+    struct io_watch *w;
+    TypedData_Get_Struct(self, struct io_watch, &watch_type, w);
+    return w;
+}
+
+/* :read / :write / :priority, an Array of them, or IO::READABLE|... */
+static int
+events_from_value(VALUE events)
+{
+    int mask = 0;
+
+    if (RB_INTEGER_TYPE_P(events)) {
+        mask = tcl_mask_from_ruby(NUM2INT(events));
+    } else if (RB_TYPE_P(events, T_ARRAY)) {
+        long i;
+        for (i = 0; i < RARRAY_LEN(events); i++) {
+            mask |= events_from_value(RARRAY_AREF(events, i));
+        }
+    } else if (SYMBOL_P(events)) {
+        ID id = SYM2ID(events);
+        if (id == id_read) mask = TCL_READABLE;
+        else if (id == id_write) mask = TCL_WRITABLE;
+        else if (id == id_priority) mask = TCL_EXCEPTION;
+    }
+    if (mask == 0) {
+        rb_raise(rb_eArgError,
+                 "events must be :read, :write, :priority, an Array of them "
+                 "or IO::READABLE/WRITABLE/PRIORITY bits (got %"PRIsVALUE")",
+                 rb_inspect(events));
+    }
+    return mask;
+}
+
+/* ---------------------------------------------------------
+ * Interp#watch_io(io, events = :read, site: nil) { |io, ready| } -> Teek::IOWatch
+ *
+ * Calls the block from the event loop whenever io's descriptor is ready
+ * for events (:read, :write, :priority, an Array of them, or
+ * IO::READABLE/WRITABLE/PRIORITY bits), until IOWatch#cancel. ready is
+ * the IO::READABLE/WRITABLE/PRIORITY bits that are set. Read with
+ * read_nonblock/readpartial: data already in io's Ruby buffer doesn't
+ * wake the loop. An exception from the block, or io found closed, ends
+ * the watch; the exception goes to the Tcl background error handler.
+ * Called from another thread, the watch is created on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+start_io_watch(VALUE self, VALUE io, VALUE events, VALUE site, VALUE proc)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct io_watch *w;
+    VALUE watch;
+    int mask, fd;
+
+#ifdef _WIN32
+    rb_raise(rb_eNotImpError, "watch_io is not supported on Windows");
+#endif
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, id_start_io_watch,
+                                  rb_ary_new_from_args(4, io, events, site, proc));
+    }
+    if (tip->deleted) rb_raise(eTclError, "interpreter has been deleted");
+
+    mask = events_from_value(events);
+    io = rb_convert_type(io, T_FILE, "IO", "to_io");
+    fd = NUM2INT(rb_funcall(io, id_fileno, 0));   /* IOError if closed */
+    if (!NIL_P(site)) site = rb_str_new_frozen(rb_String(site));
+
+    watch = TypedData_Make_Struct(cIOWatch, struct io_watch, &watch_type, w);
+    w->tip = tip;
+    w->self = watch;
+    w->interp = self;
+    w->io = io;
+    w->fd = fd;
+    w->mask = mask;
+    w->cb_id = teek_register_callback(tip, proc, site);
+#ifndef _WIN32
+    watch_link(tip, w);
+#endif
+    return watch;
+}
+
+static VALUE
+interp_watch_io(int argc, VALUE *argv, VALUE self)
+{
+    VALUE io, events, opts, site = Qundef;
+
+    rb_scan_args(argc, argv, "11:", &io, &events, &opts);
+    rb_need_block();
+    if (NIL_P(events)) events = ID2SYM(id_read);
+    if (!NIL_P(opts)) rb_get_kwargs(opts, &id_site_kw, 0, 1, &site);
+    return start_io_watch(self, io, events, site == Qundef ? Qnil : site,
+                          rb_block_proc());
+}
+
+/* ---------------------------------------------------------
+ * Teek::IOWatch
+ * --------------------------------------------------------- */
+
+/* IOWatch#cancel -> nil. Safe to call repeatedly, or from the block.
+ * Cancel before closing the IO. */
+static VALUE
+watch_cancel(VALUE self)
+{
+    struct io_watch *w = get_watch(self);
+
+    if (w->cancelled) return Qnil;
+    if (w->tip && !w->tip->deleted && Tcl_GetCurrentThread() != w->tip->main_thread_id) {
+        return teek_queue_funcall(w->tip, self, rb_intern("cancel"), rb_ary_new());
+    }
+#ifndef _WIN32
+    watch_release(w);
+#endif
+    w->cancelled = 1;
+    return Qnil;
+}
+
+/* IOWatch#active? - still watching and not cancelled */
+static VALUE
+watch_active_p(VALUE self)
+{
+    struct io_watch *w = get_watch(self);
+    return (w->ifd && !w->cancelled) ? Qtrue : Qfalse;
+}
+
+static VALUE
+watch_cancelled_p(VALUE self)
+{
+    return get_watch(self)->cancelled ? Qtrue : Qfalse;
+}
+
+static VALUE
+watch_io(VALUE self)
+{
+    return get_watch(self)->io;
+}
+
+/* IOWatch#events -> Integer IO::READABLE/WRITABLE/PRIORITY bits watched */
+static VALUE
+watch_events(VALUE self)
+{
+    return INT2FIX(ruby_events_from_tcl(get_watch(self)->mask));
+}
+
+/* IOWatch#calls -> Integer times the block has run */
+static VALUE
+watch_calls(VALUE self)
+{
+    return ULONG2NUM(get_watch(self)->calls);
+}
+
+/* IOWatch#callback_id -> Integer (the #callback_top row), nil once finished */
+static VALUE
+watch_callback_id(VALUE self)
+{
+    struct io_watch *w = get_watch(self);
+    return w->cb_id ? LL2NUM(w->cb_id) : Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkiowatch(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    id_site_kw = rb_intern("site");
+    id_start_io_watch = rb_intern("start_io_watch");
+    id_fileno = rb_intern("fileno");
+    id_closed_p = rb_intern("closed?");
+    id_read = rb_intern("read");
+    id_write = rb_intern("write");
+    id_priority = rb_intern("priority");
+
+    cIOWatch = rb_define_class_under(mTeek, "IOWatch", rb_cObject);
+    rb_undef_alloc_func(cIOWatch);
+    rb_define_method(cIOWatch, "cancel", watch_cancel, 0);
+    rb_define_method(cIOWatch, "active?", watch_active_p, 0);
+    rb_define_method(cIOWatch, "cancelled?", watch_cancelled_p, 0);
+    rb_define_method(cIOWatch, "io", watch_io, 0);
+    rb_define_method(cIOWatch, "events", watch_events, 0);
+    rb_define_method(cIOWatch, "calls", watch_calls, 0);
+    rb_define_method(cIOWatch, "callback_id", watch_callback_id, 0);
+
+    rb_define_method(cInterp, "watch_io", interp_watch_io, -1);
+    /* Positional form for requests queued from other threads */
+    rb_define_private_method(cInterp, "start_io_watch", start_io_watch, 4);
+}
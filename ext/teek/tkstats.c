@@ -0,0 +1,482 @@
+/*
+ * tkstats.c - Event loop instrumentation
+ *
+ * Every event loop Teek drives (Interp#mainloop in both modes,
+ * run_frames, do_one_event) goes through teek_do_one_event, which
+ * counts iterations, classifies what each one handled and times it.
+ * ruby_callback times each proc into its callback slot, and the
+ * cross-thread ring records queue-to-run latency. All of it is plain
+ * counters and log2 histograms on the interp, cheap enough to leave on;
+ * Interp#stats copies them into a Hash.
+ *
+ * Classifying an iteration uses two per-thread hooks: a Tk generic
+ * handler that sees every window event, and an event source whose check
+ * proc runs right after the notifier stops waiting, so time spent
+ * blocked isn't charged to the event that ended the wait.
+ */
+
+#include "tcltkbridge.h"
+
+static VALUE mStats;
+
+/* Per-thread hook state: Tk and the notifier keep their handlers per
+ * thread, so each thread driving an interp installs its own. */
+struct stats_hooks {
+    int installed;
+    unsigned long window_events;  /* Bumped by the generic handler */
+    int wake_armed;               /* Record the next end of a wait */
+    Tcl_WideInt wake_us;          /* When that wait ended */
+};
+
+static Tcl_ThreadDataKey stats_hooks_key;
+
+static struct stats_hooks *
+stats_hooks(void)
+{
+    return (struct stats_hooks *)Tcl_GetThreadData(&stats_hooks_key, sizeof(struct stats_hooks));
+}
+
+/* ---------------------------------------------------------
+ * Hooks
+ * --------------------------------------------------------- */
+
+static int
+stats_generic_handler(ClientData clientData, XEvent *eventPtr)
+{
+    ((struct stats_hooks *)clientData)->window_events++;
+    return 0;  /* Let Tk process the event normally */
+}
+
+static void
+stats_setup_proc(ClientData clientData, int flags)
+{
+    /* Nothing to wait for; only the check proc matters */
+}
+
+static void
+stats_check_proc(ClientData clientData, int flags)
+{
+    struct stats_hooks *h = (struct stats_hooks *)clientData;
+
+    if (h->wake_armed) {
+        h->wake_us = teek_now_us();
+        h->wake_armed = 0;
+    }
+}
+
+void
+teek_stats_install(void)
+{
+    struct stats_hooks *h = stats_hooks();
+
+    if (h->installed) return;
+    h->installed = 1;
+    Tk_CreateGenericHandler(stats_generic_handler, (ClientData)h);
+    Tcl_CreateEventSource(stats_setup_proc, stats_check_proc, (ClientData)h);
+}
+
+void
+teek_hist_add(struct teek_histogram *hist, Tcl_WideInt us)
+{
+    int bucket = 0;
+
+    while (us > 1 && bucket < TEEK_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    hist->count[bucket]++;
+}
+
+/* ---------------------------------------------------------
+ * teek_do_one_event - Tcl_DoOneEvent with accounting
+ *
+ * Runs the same steps as a plain Tcl_DoOneEvent(flags) - ready events,
+ * then idle handlers, then wait - but as separate calls, so an idle
+ * pass can be told apart from an event. The only extra cost is one
+ * non-blocking poll before each wait.
+ * --------------------------------------------------------- */
+
+int
+teek_do_one_event(struct tcltk_interp *tip, int flags)
+{
+    struct teek_loop_stats *st = &tip->loop_stats;
+    struct stats_hooks *h = stats_hooks();
+    unsigned long windows_before = h->window_events;
+    unsigned long drains_before = st->ring_drains;
+    Tcl_WideInt start, elapsed;
+    int kind = -1, handled = 0;
+
+    if ((flags & TCL_ALL_EVENTS) == 0) flags |= TCL_ALL_EVENTS;
+    st->iterations++;
+    start = teek_now_us();
+
+    if (flags & TCL_ALL_EVENTS & ~TCL_IDLE_EVENTS) {
+        handled = Tcl_DoOneEvent((flags & ~TCL_IDLE_EVENTS) | TCL_DONT_WAIT);
+    }
+    if (!handled && (flags & TCL_IDLE_EVENTS) &&
+        Tcl_DoOneEvent(TCL_IDLE_EVENTS | TCL_DONT_WAIT)) {
+        handled = 1;
+        kind = TEEK_EV_IDLE;
+    }
+    if (!handled && !(flags & TCL_DONT_WAIT)) {
+        h->wake_us = 0;
+        h->wake_armed = 1;
+        handled = Tcl_DoOneEvent(flags);
+        h->wake_armed = 0;
+        /* Without the event source hook (no Tk) the wait can't be split off */
+        start = h->wake_us;
+    }
+    if (!handled) return 0;
+
+    if (kind < 0) {
+        if (st->ring_drains != drains_before) {
+            kind = TEEK_EV_CROSS_THREAD;
+        } else if (h->window_events != windows_before) {
+            kind = TEEK_EV_WINDOW;
+        } else {
+            kind = TEEK_EV_TIMER_FILE;
+        }
+    }
+
+    st->events[kind]++;
+    if (start > 0) {
+        elapsed = teek_now_us() - start;
+        st->event_us[kind] += elapsed;
+        teek_hist_add(&st->event_hist, elapsed);
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------
+ * Interp#stats -> Hash
+ *
+ * Snapshot of the event loop counters:
+ *   iterations         - teek_do_one_event calls (mainloop, run_frames,
+ *                        do_one_event)
+ *   events             - iterations that handled something, by kind:
+ *                        {window:, timer_file:, idle:, cross_thread:}
+ *   event_us           - time spent handling each kind
+ *   callback_calls     - ruby_callback invocations
+ *   callback_us        - time inside (outermost) callbacks
+ *   callbacks          - {id => {calls:, total_us:, max_us:, errors:,
+ *                        site:}} for live callbacks that have run
+ *   retired_callbacks  - {site => {calls:, total_us:, max_us:, errors:,
+ *                        site:}}, the same summed over released
+ *                        callbacks (one-shot timers, destroyed widgets'
+ *                        commands) by registration site, nil if none
+ *   queue_depth, queue_high_water - cross-thread requests pending now /
+ *                        deepest seen
+ *   histograms         - {event:, callback:, queue_wait:}, each an Array
+ *                        of Teek::Stats::HISTOGRAM_BUCKETS counts where
+ *                        bucket i holds durations of 2**i...2**(i+1) us
+ *
+ * Interp#reset_stats zeroes all of it except the queue figures, which
+ * belong to Interp#thread_queue_stats.
+ * --------------------------------------------------------- */
+
+static VALUE
+hist_to_ary(const struct teek_histogram *hist)
+{
+    VALUE ary = rb_ary_new_capa(TEEK_HIST_BUCKETS);
+    int i;
+
+    for (i = 0; i < TEEK_HIST_BUCKETS; i++) {
+        rb_ary_push(ary, ULONG2NUM(hist->count[i]));
+    }
+    return ary;
+}
+
+/* {calls:, total_us:, max_us:, errors:, site:} for one slot, led by
+ * id: unless id is nil */
+static VALUE
+callback_entry(const struct callback_slot *slot, VALUE id)
+{
+    VALUE h = rb_hash_new();
+
+#define SET_STAT(key, val) rb_hash_aset(h, ID2SYM(rb_intern(key)), val)
+    if (!NIL_P(id)) SET_STAT("id", id);
+    SET_STAT("calls", ULONG2NUM(slot->calls));
+    SET_STAT("total_us", LL2NUM(slot->total_us));
+    SET_STAT("max_us", LL2NUM(slot->max_us));
+    SET_STAT("errors", ULONG2NUM(slot->errors));
+    SET_STAT("site", slot->site);
+#undef SET_STAT
+
+    return h;
+}
+
+/* The same for a site's retired total, added to h (a new Hash, or one
+ * callback_top has led with id: nil) */
+static VALUE
+retired_entry(VALUE h, const struct teek_retired_stats *rs, VALUE site)
+{
+#define SET_STAT(k, val) rb_hash_aset(h, ID2SYM(rb_intern(k)), val)
+    SET_STAT("calls", ULONG2NUM(rs->calls));
+    SET_STAT("total_us", LL2NUM(rs->total_us));
+    SET_STAT("max_us", LL2NUM(rs->max_us));
+    SET_STAT("errors", ULONG2NUM(rs->errors));
+    SET_STAT("site", site);
+#undef SET_STAT
+
+    return h;
+}
+
+static VALUE
+retired_site(const char *key)
+{
+    return *key ? rb_str_new_frozen(rb_str_new_cstr(key)) : Qnil;
+}
+
+static const char *const kind_names[TEEK_EV_KINDS] = {
+    "window", "timer_file", "idle", "cross_thread"
+};
+
+static VALUE
+interp_stats(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct teek_loop_stats *st = &tip->loop_stats;
+    VALUE h = rb_hash_new();
+    VALUE events = rb_hash_new();
+    VALUE event_us = rb_hash_new();
+    VALUE callbacks = rb_hash_new();
+    VALUE retired = rb_hash_new();
+    VALUE hists = rb_hash_new();
+    long i;
+
+    for (i = 0; i < TEEK_EV_KINDS; i++) {
+        VALUE kind = ID2SYM(rb_intern(kind_names[i]));
+        rb_hash_aset(events, kind, ULONG2NUM(st->events[i]));
+        rb_hash_aset(event_us, kind, LL2NUM(st->event_us[i]));
+    }
+
+#define SET_STAT(hash, key, val) rb_hash_aset(hash, ID2SYM(rb_intern(key)), val)
+    for (i = 0; i < tip->cb_used; i++) {
+        struct callback_slot *slot = &tip->cb_slots[i];
+
+        if (NIL_P(slot->proc) || slot->calls == 0) continue;
+        rb_hash_aset(callbacks, LL2NUM(CALLBACK_ID(i, slot->generation)),
+                     callback_entry(slot, Qnil));
+    }
+    if (tip->cb_retired) {
+        Tcl_HashSearch search;
+        Tcl_HashEntry *entry;
+
+        for (entry = Tcl_FirstHashEntry(tip->cb_retired, &search); entry;
+             entry = Tcl_NextHashEntry(&search)) {
+            const char *key = Tcl_GetHashKey(tip->cb_retired, entry);
+            VALUE site = retired_site(key);
+            rb_hash_aset(retired, site,
+                         retired_entry(rb_hash_new(), Tcl_GetHashValue(entry), site));
+        }
+    }
+
+    SET_STAT(hists, "event", hist_to_ary(&st->event_hist));
+    SET_STAT(hists, "callback", hist_to_ary(&st->callback_hist));
+    SET_STAT(hists, "queue_wait", hist_to_ary(&st->wait_hist));
+
+    SET_STAT(h, "iterations", ULONG2NUM(st->iterations));
+    SET_STAT(h, "events", events);
+    SET_STAT(h, "event_us", event_us);
+    SET_STAT(h, "callback_calls", ULONG2NUM(st->callbacks));
+    SET_STAT(h, "callback_us", LL2NUM(st->callback_us));
+    SET_STAT(h, "callbacks", callbacks);
+    SET_STAT(h, "retired_callbacks", retired);
+    SET_STAT(h, "coalesced_events", ULONG2NUM(st->coalesced));
+    SET_STAT(h, "coalesced_calls", ULONG2NUM(st->coalesce_deliveries));
+    SET_STAT(h, "queue_depth", ULONG2NUM(tip->ring_tail - tip->ring_head));
+    SET_STAT(h, "queue_high_water", ULONG2NUM(tip->tq_stats.high_water));
+    SET_STAT(h, "histograms", hists);
+#undef SET_STAT
+
+    return h;
+}
+
+static VALUE
+interp_reset_stats(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    unsigned long drains = tip->loop_stats.ring_drains;
+    long i;
+
+    memset(&tip->loop_stats, 0, sizeof(tip->loop_stats));
+    /* Kept: a reset from inside a drain must not look like a new one */
+    tip->loop_stats.ring_drains = drains;
+
+    for (i = 0; i < tip->cb_used; i++) {
+        tip->cb_slots[i].calls = 0;
+        tip->cb_slots[i].total_us = 0;
+        tip->cb_slots[i].max_us = 0;
+        tip->cb_slots[i].errors = 0;
+    }
+    teek_retired_stats_clear(tip);
+    return Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Interp#callback_top(n = 10, by: :total_us) -> Array of Hashes
+ *
+ * The n callbacks with the highest total_us, max_us, calls or errors,
+ * each as {id:, calls:, total_us:, max_us:, errors:, site:}. Released
+ * callbacks take part as one row per site with id: nil, so one-shot
+ * timers still rank under the line that created them. Callbacks that
+ * never ran are left out. Sorting happens in C, so this stays cheap
+ * with thousands of registered callbacks.
+ * --------------------------------------------------------- */
+
+enum { TOP_BY_TOTAL, TOP_BY_MAX, TOP_BY_CALLS, TOP_BY_ERRORS };
+
+struct top_entry {
+    long idx;                   /* Slot index, or -1 for a retired site */
+    Tcl_HashEntry *retired;
+    Tcl_WideInt key;
+};
+
+static int
+top_entry_cmp(const void *a, const void *b)
+{
+    const struct top_entry *x = a, *y = b;
+
+    if (x->key != y->key) return x->key < y->key ? 1 : -1;  /* Descending */
+    if (x->idx != y->idx) return x->idx < y->idx ? -1 : 1;
+    return x->retired < y->retired ? -1 : (x->retired > y->retired);
+}
+
+static VALUE
+interp_callback_top(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    VALUE n_val, opts, by = Qundef, rows, buf;
+    ID by_kw = rb_intern("by");
+    struct top_entry *entries;
+    long n = 10, count = 0, i, nretired = 0;
+    int order = TOP_BY_TOTAL;
+
+    rb_scan_args(argc, argv, "01:", &n_val, &opts);
+    if (!NIL_P(n_val)) {
+        n = NUM2LONG(n_val);
+        if (n < 0) rb_raise(rb_eArgError, "n must be >= 0 (got %ld)", n);
+    }
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, &by_kw, 0, 1, &by);
+    }
+    if (by != Qundef && !NIL_P(by)) {
+        ID id = SYMBOL_P(by) ? SYM2ID(by) : 0;
+        if (id == rb_intern("total_us")) order = TOP_BY_TOTAL;
+        else if (id == rb_intern("max_us")) order = TOP_BY_MAX;
+        else if (id == rb_intern("calls")) order = TOP_BY_CALLS;
+        else if (id == rb_intern("errors")) order = TOP_BY_ERRORS;
+        else rb_raise(rb_eArgError, "by: must be :total_us, :max_us, :calls or :errors (got %"PRIsVALUE")",
+                      rb_inspect(by));
+    }
+
+    if (tip->cb_retired) nretired = tip->cb_retired->numEntries;
+    entries = ALLOCV_N(struct top_entry, buf, tip->cb_used + nretired + 1);
+    for (i = 0; i < tip->cb_used; i++) {
+        struct callback_slot *slot = &tip->cb_slots[i];
+
+        if (NIL_P(slot->proc) || slot->calls == 0) continue;
+        entries[count].idx = i;
+        entries[count].retired = NULL;
+        switch (order) {
+        case TOP_BY_MAX:    entries[count].key = slot->max_us; break;
+        case TOP_BY_CALLS:  entries[count].key = (Tcl_WideInt)slot->calls; break;
+        case TOP_BY_ERRORS: entries[count].key = (Tcl_WideInt)slot->errors; break;
+        default:            entries[count].key = slot->total_us; break;
+        }
+        count++;
+    }
+    if (nretired) {
+        Tcl_HashSearch search;
+        Tcl_HashEntry *entry;
+
+        for (entry = Tcl_FirstHashEntry(tip->cb_retired, &search); entry;
+             entry = Tcl_NextHashEntry(&search)) {
+            struct teek_retired_stats *rs = Tcl_GetHashValue(entry);
+
+            entries[count].idx = -1;
+            entries[count].retired = entry;
+            switch (order) {
+            case TOP_BY_MAX:    entries[count].key = rs->max_us; break;
+            case TOP_BY_CALLS:  entries[count].key = (Tcl_WideInt)rs->calls; break;
+            case TOP_BY_ERRORS: entries[count].key = (Tcl_WideInt)rs->errors; break;
+            default:            entries[count].key = rs->total_us; break;
+            }
+            count++;
+        }
+    }
+    qsort(entries, (size_t)count, sizeof(*entries), top_entry_cmp);
+
+    if (n > count) n = count;
+    rows = rb_ary_new_capa(n);
+    for (i = 0; i < n; i++) {
+        if (entries[i].retired) {
+            const char *key = Tcl_GetHashKey(tip->cb_retired, entries[i].retired);
+            VALUE row = rb_hash_new();
+
+            rb_hash_aset(row, ID2SYM(rb_intern("id")), Qnil);
+            rb_ary_push(rows, retired_entry(row, Tcl_GetHashValue(entries[i].retired),
+                                            retired_site(key)));
+        } else {
+            struct callback_slot *slot = &tip->cb_slots[entries[i].idx];
+            rb_ary_push(rows, callback_entry(slot,
+                LL2NUM(CALLBACK_ID(entries[i].idx, slot->generation))));
+        }
+    }
+    ALLOCV_END(buf);
+    return rows;
+}
+
+/* ---------------------------------------------------------
+ * Teek::Stats.percentile(histogram, pct) -> Integer or nil
+ *
+ * Upper bound, in microseconds, of the bucket holding the pct-th
+ * percentile of a histogram from Interp#stats. nil if it is empty.
+ * --------------------------------------------------------- */
+
+static VALUE
+stats_percentile(VALUE mod, VALUE hist, VALUE pct_val)
+{
+    double pct = NUM2DBL(pct_val);
+    double total = 0, target, seen = 0;
+    long i, len;
+
+    Check_Type(hist, T_ARRAY);
+    if (pct < 0 || pct > 100) {
+        rb_raise(rb_eArgError, "percentile must be between 0 and 100 (got %g)", pct);
+    }
+
+    len = RARRAY_LEN(hist);
+    for (i = 0; i < len; i++) {
+        total += NUM2DBL(RARRAY_AREF(hist, i));
+    }
+    if (total == 0) return Qnil;
+
+    target = total * pct / 100.0;
+    for (i = 0; i < len; i++) {
+        seen += NUM2DBL(RARRAY_AREF(hist, i));
+        if (seen >= target && seen > 0) break;
+    }
+    if (i >= len) i = len - 1;
+    if (i > 61) i = 61;
+    return LL2NUM(1LL << (i + 1));
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkstats(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    /* Teek::Stats - helpers for Interp#stats snapshots */
+    mStats = rb_define_module_under(mTeek, "Stats");
+    rb_define_const(mStats, "HISTOGRAM_BUCKETS", INT2FIX(TEEK_HIST_BUCKETS));
+    rb_define_module_function(mStats, "percentile", stats_percentile, 2);
+
+    rb_define_method(cInterp, "stats", interp_stats, 0);
+    rb_define_method(cInterp, "reset_stats", interp_reset_stats, 0);
+    rb_define_method(cInterp, "callback_top", interp_callback_top, -1);
+}
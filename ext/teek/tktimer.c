@@ -0,0 +1,441 @@
+/*
+ * tktimer.c - Native timers (Teek::Timer)
+ *
+ * Interp#after / #after_idle schedule a block straight on Tcl's
+ * notifier with Tcl_CreateTimerHandler / Tcl_DoWhenIdle. There is no
+ * `after` script to build or parse and no timer-id string: the block
+ * sits in a callback slot (so it shows up in Interp#stats and
+ * #callback_top under the site that created it) and the handler calls
+ * it directly. Cancelling deletes the Tcl handler, O(1).
+ *
+ * repeat: true keeps one timer and one callback slot for its whole
+ * life. Ticks are scheduled from the previous deadline rather than from
+ * when the block finished, so the period doesn't drift by the block's
+ * run time; a tick more than a whole interval late resets the schedule
+ * instead of firing a burst to catch up.
+ */
+
+#include "tcltkbridge.h"
+
+static VALUE cTimer;
+static ID id_repeat_kw, id_site_kw, id_start_timer;
+
+struct teek_timer {
+    struct tcltk_interp *tip;   /* NULL once the interp is freed */
+    VALUE self;                 /* The Teek::Timer (pinned while linked) */
+    VALUE interp;               /* Teek::Interp (GC-marked) */
+    Tcl_WideInt cb_id;          /* Callback slot holding the block, 0 once released */
+    Tcl_TimerToken token;       /* Pending Tcl timer handler, or NULL */
+    int idle;                   /* after_idle: Tcl_DoWhenIdle */
+    int idle_pending;           /* Idle handler queued */
+    int repeat;
+    int cancelled;
+    int firing;                 /* Inside the block */
+    Tcl_WideInt interval_us;
+    Tcl_WideInt deadline_us;    /* When the next tick is due (teek_now_us) */
+    Tcl_WideInt lateness_us;    /* How late the last tick started */
+    unsigned long ticks;
+    int linked;                 /* On tip->timers */
+    struct teek_timer *prev, *next;
+};
+
+static void timer_proc(ClientData);
+static void timer_idle_proc(ClientData);
+
+/* ---------------------------------------------------------
+ * Scheduling (main thread, GVL held)
+ *
+ * A timer is linked on its interp while it is pending or firing. The
+ * interp marks linked timers, so a scheduled block runs even if the
+ * caller dropped the Teek::Timer.
+ * --------------------------------------------------------- */
+
+static void
+timer_link(struct teek_timer *t)
+{
+    struct tcltk_interp *tip = t->tip;
+
+    if (t->linked) return;
+    t->prev = NULL;
+    t->next = tip->timers;
+    if (tip->timers) tip->timers->prev = t;
+    tip->timers = t;
+    t->linked = 1;
+}
+
+static void
+timer_unlink(struct teek_timer *t)
+{
+    if (!t->linked) return;
+    if (t->prev) {
+        t->prev->next = t->next;
+    } else {
+        t->tip->timers = t->next;
+    }
+    if (t->next) t->next->prev = t->prev;
+    t->prev = t->next = NULL;
+    t->linked = 0;
+}
+
+static void
+timer_arm(struct teek_timer *t, Tcl_WideInt delay_us)
+{
+    timer_link(t);
+    if (t->idle) {
+        t->idle_pending = 1;
+        Tcl_DoWhenIdle(timer_idle_proc, (ClientData)t);
+        return;
+    }
+    if (delay_us < 0) delay_us = 0;
+    t->token = Tcl_CreateTimerHandler((int)((delay_us + 999) / 1000),
+                                      timer_proc, (ClientData)t);
+}
+
+static void
+timer_disarm(struct teek_timer *t)
+{
+    if (t->token) {
+        Tcl_DeleteTimerHandler(t->token);
+        t->token = NULL;
+    }
+    if (t->idle_pending) {
+        Tcl_CancelIdleCall(timer_idle_proc, (ClientData)t);
+        t->idle_pending = 0;
+    }
+}
+
+/* Done for good: drop the handler, the callback slot and the pin */
+static void
+timer_release(struct teek_timer *t)
+{
+    timer_disarm(t);
+    if (t->tip) {
+        if (t->cb_id) teek_unregister_callback(t->tip, t->cb_id);
+        timer_unlink(t);
+    }
+    t->cb_id = 0;
+}
+
+static VALUE
+timer_call(VALUE arg)
+{
+    struct teek_timer *t = (struct teek_timer *)arg;
+    return INT2FIX(teek_run_callback(t->tip, t->cb_id, rb_ary_new()));
+}
+
+static void *
+timer_fire(void *arg)
+{
+    struct teek_timer *t = (struct teek_timer *)arg;
+    struct tcltk_interp *tip = t->tip;
+    Tcl_WideInt now;
+    VALUE code;
+    int state = 0, failed;
+
+    if (tip == NULL || tip->deleted || t->cancelled) {
+        timer_release(t);
+        return NULL;
+    }
+
+    now = teek_now_us();
+    t->lateness_us = t->idle ? 0 : now - t->deadline_us;
+    if (t->lateness_us < 0) t->lateness_us = 0;
+    t->ticks++;
+
+    t->firing = 1;
+    code = rb_protect(timer_call, (VALUE)t, &state);
+    t->firing = 0;
+
+    failed = state || code == INT2FIX(TCL_ERROR);
+    if (!state && failed && !tip->deleted) {
+        Tcl_BackgroundException(tip->interp, TCL_ERROR);
+    }
+
+    if (t->repeat && !t->cancelled && !failed && !tip->deleted) {
+        now = teek_now_us();
+        t->deadline_us += t->interval_us;
+        if (now - t->deadline_us > t->interval_us) {
+            t->deadline_us = now + t->interval_us;   /* Too far behind: start over */
+        }
+        timer_arm(t, t->deadline_us - now);
+    } else {
+        timer_release(t);
+    }
+
+    if (state) rb_jump_tag(state);
+    return NULL;
+}
+
+static void
+timer_proc(ClientData cd)
+{
+    struct teek_timer *t = (struct teek_timer *)cd;
+
+    t->token = NULL;
+    teek_call_with_gvl(timer_fire, t);
+}
+
+static void
+timer_idle_proc(ClientData cd)
+{
+    struct teek_timer *t = (struct teek_timer *)cd;
+
+    t->idle_pending = 0;
+    teek_call_with_gvl(timer_fire, t);
+}
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+static void
+timer_mark(void *ptr)
+{
+    struct teek_timer *t = ptr;
+    rb_gc_mark(t->interp);
+}
+
+static void
+timer_free(void *ptr)
+{
+    struct teek_timer *t = ptr;
+
+    /* Only reached unlinked, or together with an unreachable interp */
+    timer_disarm(t);
+    if (t->tip) timer_unlink(t);
+    xfree(t);
+}
+
+static size_t
+timer_memsize(const void *ptr)
+{
+    return sizeof(struct teek_timer);
+}
+
+static const rb_data_type_t timer_type = {
+    .wrap_struct_name = "Teek::Timer",
+    .function = {
+        .dmark = timer_mark,
+        .dfree = timer_free,
+        .dsize = timer_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+void
+teek_timers_mark(struct tcltk_interp *tip)
+{
+    struct teek_timer *t;
+    for (t = tip->timers; t; t = t->next) {
+        rb_gc_mark(t->self);
+    }
+}
+
+void
+teek_timers_free(struct tcltk_interp *tip)
+{
+    while (tip->timers) {
+        struct teek_timer *t = tip->timers;
+        timer_disarm(t);
+        timer_unlink(t);
+        t->tip = NULL;
+        t->cb_id = 0;
+    }
+}
+
+static struct teek_timer *
+get_timer(VALUE self)
+{
+    struct teek_timer *t;
+    TypedData_Get_Struct(self, struct teek_timer, &timer_type, t);
+    return t;
+}
+
+/* ---------------------------------------------------------
+ * Interp#after(ms, repeat: false, site: nil) { ... } -> Teek::Timer
+ * Interp#after_idle(site: nil) { ... } -> Teek::Timer
+ *
+ * Runs the block once after ms milliseconds (or when the event loop is
+ * next idle), or every ms milliseconds with repeat: true, until
+ * Timer#cancel. Exceptions from the block go to the Tcl background
+ * error handler; a repeating timer stops after one. site: is the
+ * "file:line" reported by #callback_top. Called from another thread,
+ * the timer is created on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+start_timer(VALUE self, VALUE ms_val, VALUE repeat, VALUE site, VALUE proc)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct teek_timer *t;
+    VALUE timer;
+    int idle = NIL_P(ms_val);
+    double ms = idle ? 0 : NUM2DBL(ms_val);
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, id_start_timer,
+                                  rb_ary_new_from_args(4, ms_val, repeat, site, proc));
+    }
+    if (RTEST(repeat) && !(ms > 0)) {
+        rb_raise(rb_eArgError, "repeating timer interval must be positive, got %g", ms);
+    }
+    if (ms < 0) ms = 0;
+    if (!NIL_P(site)) site = rb_str_new_frozen(rb_String(site));
+
+    timer = TypedData_Make_Struct(cTimer, struct teek_timer, &timer_type, t);
+    t->tip = tip;
+    t->self = timer;
+    t->interp = self;
+    t->idle = idle;
+    t->repeat = RTEST(repeat);
+    t->interval_us = (Tcl_WideInt)(ms * 1000.0);
+    t->deadline_us = teek_now_us() + t->interval_us;
+    t->cb_id = teek_register_callback(tip, proc, site);
+    timer_arm(t, t->interval_us);
+    return timer;
+}
+
+static VALUE
+interp_after(int argc, VALUE *argv, VALUE self)
+{
+    VALUE ms, opts;
+    ID kw[2];
+    VALUE vals[2] = { Qundef, Qundef };
+
+    rb_scan_args(argc, argv, "1:", &ms, &opts);
+    rb_need_block();
+    kw[0] = id_repeat_kw;
+    kw[1] = id_site_kw;
+    if (!NIL_P(opts)) rb_get_kwargs(opts, kw, 0, 2, vals);
+    return start_timer(self, rb_Float(ms),
+                       vals[0] == Qundef ? Qfalse : vals[0],
+                       vals[1] == Qundef ? Qnil : vals[1],
+                       rb_block_proc());
+}
+
+static VALUE
+interp_after_idle(int argc, VALUE *argv, VALUE self)
+{
+    VALUE opts, site = Qundef;
+
+    rb_scan_args(argc, argv, "0:", &opts);
+    rb_need_block();
+    if (!NIL_P(opts)) rb_get_kwargs(opts, &id_site_kw, 0, 1, &site);
+    return start_timer(self, Qnil, Qfalse, site == Qundef ? Qnil : site,
+                       rb_block_proc());
+}
+
+/* ---------------------------------------------------------
+ * Teek::Timer
+ * --------------------------------------------------------- */
+
+/* Timer#cancel -> nil. Safe to call repeatedly, or from the block. */
+static VALUE
+timer_cancel(VALUE self)
+{
+    struct teek_timer *t = get_timer(self);
+
+    if (t->cancelled) return Qnil;
+    if (t->tip && !t->tip->deleted && Tcl_GetCurrentThread() != t->tip->main_thread_id) {
+        return teek_queue_funcall(t->tip, self, rb_intern("cancel"), rb_ary_new());
+    }
+    t->cancelled = 1;
+    if (t->firing) {
+        timer_disarm(t);   /* timer_fire releases it when the block returns */
+    } else {
+        timer_release(t);
+    }
+    return Qnil;
+}
+
+/* Timer#active? - still scheduled (or running) and not cancelled */
+static VALUE
+timer_active_p(VALUE self)
+{
+    struct teek_timer *t = get_timer(self);
+    return (t->linked && !t->cancelled) ? Qtrue : Qfalse;
+}
+
+static VALUE
+timer_cancelled_p(VALUE self)
+{
+    return get_timer(self)->cancelled ? Qtrue : Qfalse;
+}
+
+static VALUE
+timer_repeat_p(VALUE self)
+{
+    return get_timer(self)->repeat ? Qtrue : Qfalse;
+}
+
+/* Timer#interval -> Float milliseconds (0 for after_idle) */
+static VALUE
+timer_interval(VALUE self)
+{
+    return DBL2NUM((double)get_timer(self)->interval_us / 1000.0);
+}
+
+/* Timer#interval = ms - takes effect from the next tick */
+static VALUE
+timer_set_interval(VALUE self, VALUE ms_val)
+{
+    struct teek_timer *t = get_timer(self);
+    double ms = NUM2DBL(ms_val);
+
+    if (!(ms > 0)) rb_raise(rb_eArgError, "interval must be positive, got %g", ms);
+    t->interval_us = (Tcl_WideInt)(ms * 1000.0);
+    return ms_val;
+}
+
+/* Timer#ticks -> Integer times the block has run */
+static VALUE
+timer_ticks(VALUE self)
+{
+    return ULONG2NUM(get_timer(self)->ticks);
+}
+
+/* Timer#lateness_ms -> Float, how far past its deadline the latest tick started */
+static VALUE
+timer_lateness_ms(VALUE self)
+{
+    return DBL2NUM((double)get_timer(self)->lateness_us / 1000.0);
+}
+
+/* Timer#callback_id -> Integer (the #callback_top row), nil once finished */
+static VALUE
+timer_callback_id(VALUE self)
+{
+    struct teek_timer *t = get_timer(self);
+    return t->cb_id ? LL2NUM(t->cb_id) : Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tktimer(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    id_repeat_kw = rb_intern("repeat");
+    id_site_kw = rb_intern("site");
+    id_start_timer = rb_intern("start_timer");
+
+    cTimer = rb_define_class_under(mTeek, "Timer", rb_cObject);
+    rb_undef_alloc_func(cTimer);
+    rb_define_method(cTimer, "cancel", timer_cancel, 0);
+    rb_define_method(cTimer, "active?", timer_active_p, 0);
+    rb_define_method(cTimer, "cancelled?", timer_cancelled_p, 0);
+    rb_define_method(cTimer, "repeat?", timer_repeat_p, 0);
+    rb_define_method(cTimer, "interval", timer_interval, 0);
+    rb_define_method(cTimer, "interval=", timer_set_interval, 1);
+    rb_define_method(cTimer, "ticks", timer_ticks, 0);
+    rb_define_method(cTimer, "lateness_ms", timer_lateness_ms, 0);
+    rb_define_method(cTimer, "callback_id", timer_callback_id, 0);
+
+    rb_define_method(cInterp, "after", interp_after, -1);
+    rb_define_method(cInterp, "after_idle", interp_after_idle, -1);
+    /* Positional form for requests queued from other threads */
+    rb_define_private_method(cInterp, "start_timer", start_timer, 4);
+}
@@ -0,0 +1,822 @@
+/*
+ * tkvars.c - Bulk variable access and push-based change notifications
+ *
+ * Interp#get_vars / #set_vars / #array_get / #array_set read and write
+ * many global variables (or array elements) in one call, straight
+ * through Tcl_ObjGetVar2/Tcl_ObjSetVar2 with the array index passed
+ * separately, so nothing builds "name(index)" strings or goes through
+ * the script parser.
+ *
+ * Interp#trace_vars(pattern) puts Tcl_TraceVar2 write/unset traces on
+ * the global variables matching pattern. The trace procs only note what
+ * changed; once per idle cycle the changes are handed to the Ruby block
+ * as one batch of [name, index, value] tuples, with values read at that
+ * point. A variable written a thousand times between idles is reported
+ * once, and variables that didn't change are never read.
+ */
+
+#include "tcltkbridge.h"
+#include "ruby/util.h"
+
+static VALUE cVarTrace;
+
+#define VAR_TRACE_FLAGS (TCL_GLOBAL_ONLY | TCL_TRACE_WRITES | TCL_TRACE_UNSETS)
+
+/* One traced global variable; the trace's clientData */
+struct traced_var {
+    struct var_trace *vt;
+    Tcl_HashEntry *entry;           /* In vt->vars, keyed by variable name */
+    int traced;                     /* Trace installed (Tcl drops it when the variable goes) */
+    int dirty;                      /* On vt's dirty list */
+    int whole;                      /* The variable itself was set or unset */
+    Tcl_HashTable *elems;           /* Changed array elements, keys only (lazy) */
+    struct traced_var *next_dirty;
+};
+
+/* A trace_vars registration. Owned by the interp (tip->var_traces) so
+ * trace procs never outlive it, whatever happens to the Ruby handle. */
+struct var_trace {
+    struct tcltk_interp *tip;
+    struct var_trace *next;         /* tip->var_traces list */
+    VALUE proc;                     /* Marked by teek_var_traces_mark */
+    char *pattern;
+    Tcl_HashTable vars;             /* name -> struct traced_var */
+    struct traced_var *dirty_head;  /* Changed since the last flush, in order */
+    struct traced_var *dirty_tail;
+    int flush_pending;              /* Idle flush queued */
+};
+
+/* Teek::VarTrace - Ruby handle on a registration */
+struct var_trace_handle {
+    VALUE interp;                   /* Keeps the interp, and so vt, alive */
+    struct var_trace *vt;           /* NULL once cancelled */
+};
+
+static void var_trace_idle(ClientData cd);
+
+/* ---------------------------------------------------------
+ * Dirty tracking (trace procs - pure C, no GVL needed)
+ * --------------------------------------------------------- */
+
+static void
+free_elems(struct traced_var *tv)
+{
+    if (tv->elems) {
+        Tcl_DeleteHashTable(tv->elems);
+        ckfree((char *)tv->elems);
+        tv->elems = NULL;
+    }
+}
+
+static void
+mark_dirty(struct traced_var *tv)
+{
+    struct var_trace *vt = tv->vt;
+
+    if (!tv->dirty) {
+        tv->dirty = 1;
+        tv->next_dirty = NULL;
+        if (vt->dirty_tail) {
+            vt->dirty_tail->next_dirty = tv;
+        } else {
+            vt->dirty_head = tv;
+        }
+        vt->dirty_tail = tv;
+    }
+    if (!vt->flush_pending) {
+        vt->flush_pending = 1;
+        Tcl_DoWhenIdle(var_trace_idle, (ClientData)vt);
+    }
+}
+
+static char *
+var_trace_proc(ClientData cd, Tcl_Interp *interp,
+               const char *name1, const char *name2, int flags)
+{
+    struct traced_var *tv = (struct traced_var *)cd;
+
+    if (flags & TCL_INTERP_DESTROYED) {
+        tv->traced = 0;
+        return NULL;
+    }
+
+    if (flags & TCL_TRACE_DESTROYED) {
+        /* Whole variable unset; Tcl has removed the trace with it */
+        tv->traced = 0;
+        tv->whole = 1;
+        free_elems(tv);
+    } else if (name2 != NULL) {
+        int isnew;
+        if (!tv->elems) {
+            tv->elems = (Tcl_HashTable *)ckalloc(sizeof(Tcl_HashTable));
+            Tcl_InitHashTable(tv->elems, TCL_STRING_KEYS);
+        }
+        Tcl_CreateHashEntry(tv->elems, name2, &isnew);
+    } else {
+        tv->whole = 1;
+    }
+    mark_dirty(tv);
+    return NULL;
+}
+
+/* Trace the matching globals not traced yet. New ones are reported as
+ * changed when mark_new is set. Returns how many were added, or -1 with
+ * the error in the interp result. */
+static long
+var_trace_scan(struct var_trace *vt, int mark_new)
+{
+    Tcl_Interp *interp = vt->tip->interp;
+    Tcl_Obj *cmd[3], *names, **namev;
+    Tcl_Size n, i;
+    long added = 0;
+    int code;
+
+    cmd[0] = Tcl_NewStringObj("info", -1);
+    cmd[1] = Tcl_NewStringObj("globals", -1);
+    cmd[2] = Tcl_NewStringObj(vt->pattern, -1);
+    for (i = 0; i < 3; i++) Tcl_IncrRefCount(cmd[i]);
+    code = Tcl_EvalObjv(interp, 3, cmd, TCL_EVAL_GLOBAL);
+    for (i = 0; i < 3; i++) Tcl_DecrRefCount(cmd[i]);
+    if (code != TCL_OK) return -1;
+
+    names = Tcl_GetObjResult(interp);
+    Tcl_IncrRefCount(names);
+    Tcl_ResetResult(interp);
+    if (Tcl_ListObjGetElements(interp, names, &n, &namev) != TCL_OK) {
+        Tcl_DecrRefCount(names);
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        const char *name = Tcl_GetString(namev[i]);
+        Tcl_HashEntry *entry;
+        struct traced_var *tv;
+        int isnew;
+
+        entry = Tcl_CreateHashEntry(&vt->vars, name, &isnew);
+        if (isnew) {
+            tv = (struct traced_var *)ckalloc(sizeof(struct traced_var));
+            memset(tv, 0, sizeof(*tv));
+            tv->vt = vt;
+            tv->entry = entry;
+            Tcl_SetHashValue(entry, tv);
+        } else {
+            tv = (struct traced_var *)Tcl_GetHashValue(entry);
+            if (tv->traced) continue;
+        }
+
+        if (Tcl_TraceVar2(interp, name, NULL, VAR_TRACE_FLAGS,
+                          var_trace_proc, (ClientData)tv) != TCL_OK) {
+            Tcl_ResetResult(interp);
+            continue;
+        }
+        tv->traced = 1;
+        added++;
+        if (mark_new) {
+            tv->whole = 1;
+            mark_dirty(tv);
+        }
+    }
+    Tcl_DecrRefCount(names);
+    return added;
+}
+
+/* ---------------------------------------------------------
+ * Flush (idle callback, main thread)
+ * --------------------------------------------------------- */
+
+static VALUE
+var_value(Tcl_Interp *interp, const char *name, const char *index)
+{
+    Tcl_Obj *val = Tcl_GetVar2Ex(interp, name, index, TCL_GLOBAL_ONLY);
+    return val ? teek_tcl_to_ruby(val, TEEK_RESULT_STRING) : Qnil;
+}
+
+static VALUE
+var_change(VALUE name, VALUE index, VALUE value)
+{
+    return rb_ary_new_from_args(3, name, index, value);
+}
+
+/* Detach the dirty list and turn it into [[name, index, value], ...].
+ * Reading a value can fire other read traces, which may set or unset
+ * traced variables (or cancel this trace), so the dirty keys are all
+ * copied out and their flags cleared before any value is read. A change
+ * made by those traces then lands on a fresh dirty list and is reported
+ * by the next flush. */
+static VALUE
+var_trace_collect(struct var_trace *vt)
+{
+    struct tcltk_interp *tip = vt->tip;
+    struct traced_var *tv = vt->dirty_head;
+    VALUE changes = rb_ary_new();
+    long i;
+
+    vt->dirty_head = vt->dirty_tail = NULL;
+    while (tv) {
+        struct traced_var *next = tv->next_dirty;
+        VALUE rname = rb_utf8_str_new_cstr(Tcl_GetHashKey(&vt->vars, tv->entry));
+
+        if (tv->whole) {
+            rb_ary_push(changes, var_change(rname, Qnil, Qnil));
+        }
+        if (tv->elems) {
+            Tcl_HashSearch search;
+            Tcl_HashEntry *e;
+            for (e = Tcl_FirstHashEntry(tv->elems, &search); e; e = Tcl_NextHashEntry(&search)) {
+                const char *index = Tcl_GetHashKey(tv->elems, e);
+                rb_ary_push(changes, var_change(rname, rb_utf8_str_new_cstr(index), Qnil));
+            }
+            free_elems(tv);
+        }
+        tv->dirty = 0;
+        tv->whole = 0;
+        tv->next_dirty = NULL;
+
+        /* Gone and reported: forget it (a rescan picks it up if it returns) */
+        if (!tv->traced) {
+            Tcl_DeleteHashEntry(tv->entry);
+            ckfree((char *)tv);
+        }
+        tv = next;
+    }
+
+    /* vt is not touched from here on */
+    for (i = 0; i < RARRAY_LEN(changes) && !tip->deleted; i++) {
+        VALUE change = RARRAY_AREF(changes, i);
+        VALUE rindex = RARRAY_AREF(change, 1);
+
+        rb_ary_store(change, 2,
+                     var_value(tip->interp, RSTRING_PTR(RARRAY_AREF(change, 0)),
+                               NIL_P(rindex) ? NULL : RSTRING_PTR(rindex)));
+    }
+    return changes;
+}
+
+static VALUE
+call_var_proc(VALUE arg)
+{
+    VALUE *pair = (VALUE *)arg;
+    return rb_proc_call(pair[0], rb_ary_new_from_args(1, pair[1]));
+}
+
+static void *
+var_trace_flush(void *arg)
+{
+    struct var_trace *vt = (struct var_trace *)arg;
+    Tcl_Interp *interp = vt->tip->interp;
+    VALUE pair[2];
+    int state = 0;
+
+    if (vt->dirty_head == NULL) return NULL;
+
+    /* The block may cancel the trace, so vt is not touched after this */
+    pair[0] = vt->proc;
+    pair[1] = var_trace_collect(vt);
+    rb_protect(call_var_proc, (VALUE)pair, &state);
+
+    if (state) {
+        VALUE errinfo = rb_errinfo();
+        VALUE msg;
+        rb_set_errinfo(Qnil);
+
+        /* Let SystemExit and Interrupt propagate - don't swallow them */
+        if (rb_obj_is_kind_of(errinfo, rb_eSystemExit) ||
+            rb_obj_is_kind_of(errinfo, rb_eInterrupt)) {
+            rb_exc_raise(errinfo);
+        }
+
+        /* Others go to the Tcl background error handler, like callbacks */
+        msg = rb_funcall(errinfo, rb_intern("message"), 0);
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(StringValueCStr(msg), -1));
+        Tcl_BackgroundException(interp, TCL_ERROR);
+    }
+    return NULL;
+}
+
+static void
+var_trace_idle(ClientData cd)
+{
+    struct var_trace *vt = (struct var_trace *)cd;
+
+    vt->flush_pending = 0;
+    if (vt->tip->deleted) return;
+    teek_call_with_gvl(var_trace_flush, vt);
+}
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+/* Remove vt's traces (if the interp is still alive) and free it */
+static void
+var_trace_release(struct var_trace *vt)
+{
+    struct tcltk_interp *tip = vt->tip;
+    struct var_trace **pp;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *e;
+    int live = tip->interp != NULL && !tip->deleted;
+
+    for (e = Tcl_FirstHashEntry(&vt->vars, &search); e; e = Tcl_NextHashEntry(&search)) {
+        struct traced_var *tv = (struct traced_var *)Tcl_GetHashValue(e);
+        if (tv->traced && live) {
+            Tcl_UntraceVar2(tip->interp, Tcl_GetHashKey(&vt->vars, e), NULL,
+                            VAR_TRACE_FLAGS, var_trace_proc, (ClientData)tv);
+        }
+        free_elems(tv);
+        ckfree((char *)tv);
+    }
+    Tcl_DeleteHashTable(&vt->vars);
+    if (vt->flush_pending) {
+        Tcl_CancelIdleCall(var_trace_idle, (ClientData)vt);
+    }
+
+    for (pp = &tip->var_traces; *pp; pp = &(*pp)->next) {
+        if (*pp == vt) {
+            *pp = vt->next;
+            break;
+        }
+    }
+    xfree(vt->pattern);
+    xfree(vt);
+}
+
+void
+teek_var_traces_mark(struct tcltk_interp *tip)
+{
+    struct var_trace *vt;
+    for (vt = tip->var_traces; vt; vt = vt->next) {
+        rb_gc_mark(vt->proc);
+    }
+}
+
+void
+teek_var_traces_free(struct tcltk_interp *tip)
+{
+    while (tip->var_traces) {
+        var_trace_release(tip->var_traces);
+    }
+}
+
+static void
+var_trace_handle_mark(void *ptr)
+{
+    struct var_trace_handle *h = ptr;
+    rb_gc_mark(h->interp);
+}
+
+static size_t
+var_trace_handle_memsize(const void *ptr)
+{
+    return sizeof(struct var_trace_handle);
+}
+
+static const rb_data_type_t var_trace_handle_type = {
+    .wrap_struct_name = "Teek::VarTrace",
+    .function = {
+        .dmark = var_trace_handle_mark,
+        .dfree = RUBY_TYPED_DEFAULT_FREE,  /* vt belongs to the interp */
+        .dsize = var_trace_handle_memsize,
+    },
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static struct var_trace_handle *
+get_handle(VALUE self)
+{
+    struct var_trace_handle *h;
+    TypedData_Get_Struct(self, struct var_trace_handle, &var_trace_handle_type, h);
+    return h;
+}
+
+static void
+check_main_thread(struct tcltk_interp *tip, const char *what)
+{
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        rb_raise(eTclError, "%s must be called from the main thread", what);
+    }
+}
+
+/* ---------------------------------------------------------
+ * Interp#trace_vars(pattern = "*") { |changes| ... } -> Teek::VarTrace
+ *
+ * Traces writes and unsets of the global variables matching the glob
+ * pattern. Once per idle cycle with anything changed, the block gets an
+ * Array of [name, index, value]:
+ *
+ *   index - the array element changed, or nil for the variable itself
+ *   value - the current value (a String), or nil if it no longer exists
+ *           (and for an array's own entry)
+ *
+ * Repeated changes between flushes are reported once, grouped by
+ * variable in order of first change. Variables created later are not
+ * traced until VarTrace#rescan; an unset variable is reported once and
+ * then dropped. Errors raised by the block go to the Tcl background
+ * error handler.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_trace_vars(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct var_trace_handle *h;
+    struct var_trace *vt;
+    VALUE pattern, handle;
+
+    rb_scan_args(argc, argv, "01", &pattern);
+    rb_need_block();
+    check_main_thread(tip, "trace_vars");
+    pattern = NIL_P(pattern) ? rb_str_new_cstr("*") : rb_String(pattern);
+
+    handle = TypedData_Make_Struct(cVarTrace, struct var_trace_handle,
+                                   &var_trace_handle_type, h);
+    h->interp = self;
+
+    vt = ALLOC(struct var_trace);
+    memset(vt, 0, sizeof(*vt));
+    vt->tip = tip;
+    vt->proc = rb_block_proc();
+    vt->pattern = ruby_strdup(StringValueCStr(pattern));
+    Tcl_InitHashTable(&vt->vars, TCL_STRING_KEYS);
+    vt->next = tip->var_traces;
+    tip->var_traces = vt;
+    h->vt = vt;
+
+    if (var_trace_scan(vt, 0) < 0) {
+        VALUE msg = rb_str_new_cstr(Tcl_GetStringResult(tip->interp));
+        h->vt = NULL;
+        var_trace_release(vt);
+        rb_raise(eTclError, "%"PRIsVALUE, msg);
+    }
+    return handle;
+}
+
+/* ---------------------------------------------------------
+ * VarTrace#rescan -> Integer
+ *
+ * Starts tracing matching globals created (or recreated) since the last
+ * scan and reports them as changed. Returns how many were added. Much
+ * cheaper than re-reading every variable: one `info globals` and a hash
+ * lookup per name.
+ * --------------------------------------------------------- */
+
+static VALUE
+var_trace_rescan(VALUE self)
+{
+    struct var_trace_handle *h = get_handle(self);
+    struct tcltk_interp *tip = get_interp(h->interp);
+    long added;
+
+    if (!h->vt) rb_raise(eTclError, "variable trace has been cancelled");
+    check_main_thread(tip, "rescan");
+
+    added = var_trace_scan(h->vt, 1);
+    if (added < 0) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+    return LONG2NUM(added);
+}
+
+/* ---------------------------------------------------------
+ * VarTrace#cancel -> nil
+ *
+ * Removes the traces. Pending changes are dropped. Safe to call twice
+ * or after the interp is deleted.
+ * --------------------------------------------------------- */
+
+static VALUE
+var_trace_cancel(VALUE self)
+{
+    struct var_trace_handle *h = get_handle(self);
+    struct var_trace *vt = h->vt;
+
+    if (!vt) return Qnil;
+    if (!vt->tip->deleted) check_main_thread(vt->tip, "cancel");
+    h->vt = NULL;
+    var_trace_release(vt);
+    return Qnil;
+}
+
+/* VarTrace#active? -> true until cancelled */
+static VALUE
+var_trace_active_p(VALUE self)
+{
+    return get_handle(self)->vt ? Qtrue : Qfalse;
+}
+
+/* VarTrace#size -> number of variables currently traced */
+static VALUE
+var_trace_size(VALUE self)
+{
+    struct var_trace *vt = get_handle(self)->vt;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *e;
+    long n = 0;
+
+    if (!vt) return INT2FIX(0);
+    for (e = Tcl_FirstHashEntry(&vt->vars, &search); e; e = Tcl_NextHashEntry(&search)) {
+        if (((struct traced_var *)Tcl_GetHashValue(e))->traced) n++;
+    }
+    return LONG2NUM(n);
+}
+
+/* VarTrace#pattern -> the glob pattern, or nil once cancelled */
+static VALUE
+var_trace_pattern(VALUE self)
+{
+    struct var_trace *vt = get_handle(self)->vt;
+    return vt ? rb_utf8_str_new_cstr(vt->pattern) : Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Bulk access
+ *
+ * Variable keys are a name (String or Symbol) or a [name, index] pair
+ * for an array element. Values are converted like Interp#command
+ * arguments, so Integers, Floats, Arrays (lists) and TclObjs keep
+ * their Tcl type.
+ * --------------------------------------------------------- */
+
+static VALUE
+key_string(VALUE v)
+{
+    if (SYMBOL_P(v)) return rb_sym2str(v);
+    if (RB_TYPE_P(v, T_STRING)) return v;
+    return rb_obj_as_string(v);
+}
+
+/* Split a variable key into name and index (Qnil for a plain variable) */
+static void
+var_key(VALUE key, VALUE *name, VALUE *index)
+{
+    if (RB_TYPE_P(key, T_ARRAY)) {
+        if (RARRAY_LEN(key) != 2) {
+            rb_raise(rb_eArgError, "array element key must be [name, index] (got %"PRIsVALUE")",
+                     rb_inspect(key));
+        }
+        *name = key_string(RARRAY_AREF(key, 0));
+        *index = key_string(RARRAY_AREF(key, 1));
+    } else if (SYMBOL_P(key) || RB_TYPE_P(key, T_STRING)) {
+        *name = key_string(key);
+        *index = Qnil;
+    } else {
+        rb_raise(rb_eTypeError, "variable name must be a String, Symbol or [name, index] (got %s)",
+                 rb_obj_classname(key));
+    }
+}
+
+static Tcl_Obj *
+str_obj(VALUE str)
+{
+    Tcl_Obj *obj = Tcl_NewStringObj(RSTRING_PTR(str), RSTRING_LEN(str));
+    Tcl_IncrRefCount(obj);
+    return obj;
+}
+
+/* Current value of name(index), or NULL if unset. No Ruby calls. */
+static Tcl_Obj *
+get_var_obj(Tcl_Interp *interp, VALUE name, VALUE index)
+{
+    Tcl_Obj *n = str_obj(name);
+    Tcl_Obj *i = NIL_P(index) ? NULL : str_obj(index);
+    Tcl_Obj *val = Tcl_ObjGetVar2(interp, n, i, TCL_GLOBAL_ONLY);
+
+    Tcl_DecrRefCount(n);
+    if (i) Tcl_DecrRefCount(i);
+    return val;
+}
+
+struct var_set {
+    struct tcltk_interp *tip;
+    Tcl_Obj *holder;    /* Owns the converted values until the set is done */
+    VALUE name;         /* Fixed array name (array_set), or Qnil */
+};
+
+/* Set name(index) = val; raises TclError if Tcl refuses */
+static void
+set_var(struct var_set *vs, VALUE name, VALUE index, VALUE val)
+{
+    Tcl_Interp *interp = vs->tip->interp;
+    Tcl_Obj *n, *i, *v;
+    Tcl_Size len;
+    int ok;
+
+    /* May raise; whatever it creates already belongs to the holder */
+    teek_append_ruby_value(vs->tip, vs->holder, val);
+    Tcl_ListObjLength(NULL, vs->holder, &len);
+    Tcl_ListObjIndex(NULL, vs->holder, len - 1, &v);
+
+    n = str_obj(name);
+    i = NIL_P(index) ? NULL : str_obj(index);
+    ok = Tcl_ObjSetVar2(interp, n, i, v, TCL_GLOBAL_ONLY | TCL_LEAVE_ERR_MSG) != NULL;
+    Tcl_DecrRefCount(n);
+    if (i) Tcl_DecrRefCount(i);
+    if (!ok) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(interp));
+    }
+}
+
+static int
+set_vars_i(VALUE key, VALUE val, VALUE arg)
+{
+    struct var_set *vs = (struct var_set *)arg;
+    VALUE name, index;
+
+    if (NIL_P(vs->name)) {
+        var_key(key, &name, &index);
+    } else {
+        name = vs->name;
+        index = key_string(key);
+    }
+    set_var(vs, name, index, val);
+    return ST_CONTINUE;
+}
+
+static VALUE
+set_vars_body(VALUE arg)
+{
+    VALUE *args = (VALUE *)arg;
+    rb_hash_foreach(args[1], set_vars_i, args[0]);
+    return Qnil;
+}
+
+static VALUE
+set_vars_cleanup(VALUE arg)
+{
+    Tcl_DecrRefCount(((struct var_set *)arg)->holder);
+    return Qnil;
+}
+
+/* Set every pair of hash, with elements of array name when given */
+static void
+set_vars_from_hash(struct tcltk_interp *tip, VALUE name, VALUE hash)
+{
+    struct var_set vs;
+    VALUE args[2];
+
+    vs.tip = tip;
+    vs.holder = Tcl_NewListObj(0, NULL);
+    vs.name = name;
+    Tcl_IncrRefCount(vs.holder);
+    args[0] = (VALUE)&vs;
+    args[1] = hash;
+    rb_ensure(set_vars_body, (VALUE)args, set_vars_cleanup, (VALUE)&vs);
+}
+
+/* ---------------------------------------------------------
+ * Interp#get_vars(keys) -> Hash
+ *
+ * Reads each variable or [name, index] element. The Hash maps each key
+ * as given to its value String, or nil if it isn't set.
+ *
+ *   interp.get_vars(["first", "last", ["form", "email"]])
+ *   # => {"first" => "Ada", "last" => "Lovelace", ["form", "email"] => nil}
+ *
+ * Thread-safe: from a background thread the read runs on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_get_vars(VALUE self, VALUE keys)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    VALUE result;
+    long i;
+
+    keys = rb_Array(keys);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("get_vars"), rb_ary_new3(1, keys));
+    }
+
+    result = rb_hash_new_capa(RARRAY_LEN(keys));
+    for (i = 0; i < RARRAY_LEN(keys); i++) {
+        VALUE key = RARRAY_AREF(keys, i);
+        VALUE name, index;
+        Tcl_Obj *val;
+
+        var_key(key, &name, &index);
+        val = get_var_obj(tip->interp, name, index);
+        rb_hash_aset(result, key, val ? teek_tcl_to_ruby(val, TEEK_RESULT_STRING) : Qnil);
+    }
+    return result;
+}
+
+/* ---------------------------------------------------------
+ * Interp#set_vars(hash) -> hash
+ *
+ * Sets every variable or [name, index] element in hash. Stops with a
+ * TclError at the first one Tcl refuses (e.g. an element of a scalar);
+ * the ones before it stay set.
+ *
+ * Thread-safe: from a background thread the writes run on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_set_vars(VALUE self, VALUE hash)
+{
+    struct tcltk_interp *tip = get_interp(self);
+
+    hash = rb_convert_type(hash, T_HASH, "Hash", "to_hash");
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("set_vars"), rb_ary_new3(1, hash));
+    }
+
+    set_vars_from_hash(tip, Qnil, hash);
+    return hash;
+}
+
+/* ---------------------------------------------------------
+ * Interp#array_get(name) -> Hash
+ *
+ * Every element of global array name as {index => value}, from a single
+ * `array get`. Empty if name isn't an array.
+ *
+ * Thread-safe: from a background thread the read runs on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_array_get(VALUE self, VALUE name)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    Tcl_Obj *cmd[3], *list, **elems;
+    Tcl_Size n, i;
+    VALUE result;
+    int code;
+
+    name = key_string(name);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("array_get"), rb_ary_new3(1, name));
+    }
+
+    cmd[0] = Tcl_NewStringObj("array", -1);
+    cmd[1] = Tcl_NewStringObj("get", -1);
+    cmd[2] = Tcl_NewStringObj(RSTRING_PTR(name), RSTRING_LEN(name));
+    for (i = 0; i < 3; i++) Tcl_IncrRefCount(cmd[i]);
+    code = Tcl_EvalObjv(tip->interp, 3, cmd, TCL_EVAL_GLOBAL);
+    for (i = 0; i < 3; i++) Tcl_DecrRefCount(cmd[i]);
+    if (code != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+
+    /* The result stays referenced by the interp while we convert */
+    list = Tcl_GetObjResult(tip->interp);
+    if (Tcl_ListObjGetElements(tip->interp, list, &n, &elems) != TCL_OK) {
+        rb_raise(eTclError, "%s", Tcl_GetStringResult(tip->interp));
+    }
+    result = rb_hash_new_capa(n / 2);
+    for (i = 0; i + 1 < n; i += 2) {
+        rb_hash_aset(result, teek_tcl_to_ruby(elems[i], TEEK_RESULT_STRING),
+                     teek_tcl_to_ruby(elems[i + 1], TEEK_RESULT_STRING));
+    }
+    Tcl_ResetResult(tip->interp);
+    return result;
+}
+
+/* ---------------------------------------------------------
+ * Interp#array_set(name, hash) -> hash
+ *
+ * Sets name(index) for every index => value in hash, creating the array
+ * if needed. Index keys may be any object (converted with to_s).
+ *
+ * Thread-safe: from a background thread the writes run on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_array_set(VALUE self, VALUE name, VALUE hash)
+{
+    struct tcltk_interp *tip = get_interp(self);
+
+    name = key_string(name);
+    hash = rb_convert_type(hash, T_HASH, "Hash", "to_hash");
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("array_set"), rb_ary_new3(2, name, hash));
+    }
+
+    set_vars_from_hash(tip, name, hash);
+    return hash;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkvars(VALUE cInterp)
+{
+    VALUE mTeek = rb_define_module("Teek");
+
+    cVarTrace = rb_define_class_under(mTeek, "VarTrace", rb_cObject);
+    rb_undef_alloc_func(cVarTrace);  /* Created by Interp#trace_vars */
+
+    rb_define_method(cVarTrace, "rescan", var_trace_rescan, 0);
+    rb_define_method(cVarTrace, "cancel", var_trace_cancel, 0);
+    rb_define_method(cVarTrace, "active?", var_trace_active_p, 0);
+    rb_define_method(cVarTrace, "size", var_trace_size, 0);
+    rb_define_method(cVarTrace, "pattern", var_trace_pattern, 0);
+
+    rb_define_method(cInterp, "get_vars", interp_get_vars, 1);
+    rb_define_method(cInterp, "set_vars", interp_set_vars, 1);
+    rb_define_method(cInterp, "array_get", interp_array_get, 1);
+    rb_define_method(cInterp, "array_set", interp_array_set, 2);
+    rb_define_method(cInterp, "trace_vars", interp_trace_vars, -1);
+}
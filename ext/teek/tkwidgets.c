@@ -0,0 +1,446 @@
+/*
+ * tkwidgets.c - Widget tree tracking
+ *
+ * Interp#track_widgets(commands) keeps a path -> class table of the
+ * widgets those commands create, entirely in C. Creation is caught by
+ * an execution trace whose command is a C function (no Tcl proc, no
+ * `winfo class`, no Ruby), which looks the new window up with
+ * Tk_NameToWindow and hangs a StructureNotify handler on it; the
+ * handler drops the entry when Tk sends DestroyNotify. Ruby only sees
+ * the table when it asks (Interp#tracked_widgets), and an optional
+ * listener gets the changes batched once per idle cycle.
+ */
+
+#include "tcltkbridge.h"
+#include "ruby/util.h"
+
+#define TRACK_CMD "teek_track_widget"
+
+/* One tracked window; its event handler's clientData */
+struct tracked_widget {
+    struct widget_tracker *wt;
+    Tcl_HashEntry *entry;       /* In wt->widgets, keyed by path */
+    Tk_Window tkwin;
+    Tk_Uid cls;                 /* Class at creation time (Tk_Uids live forever) */
+};
+
+/* A change waiting for the listener */
+struct widget_change {
+    struct widget_change *next;
+    int created;
+    Tk_Uid cls;
+    char path[1];               /* Allocated to fit */
+};
+
+/* Per-interp tracking state, created by the first track_widgets */
+struct widget_tracker {
+    struct tcltk_interp *tip;
+    Tcl_Interp *interp;
+    Tcl_HashTable widgets;      /* path -> struct tracked_widget */
+    char *exclude;              /* Path prefix never tracked, or NULL */
+    VALUE listener;             /* on_widget_change block, or Qnil (GC-marked) */
+    struct widget_change *changes_head;
+    struct widget_change *changes_tail;
+    int flush_pending;          /* Idle flush queued */
+};
+
+static ID id_exclude_kw;
+static VALUE sym_created, sym_destroyed;
+
+static void widget_tracker_idle(ClientData);
+
+/* ---------------------------------------------------------
+ * Change notifications
+ * --------------------------------------------------------- */
+
+static int
+notifications_wanted(struct widget_tracker *wt)
+{
+    return !NIL_P(wt->listener) && !wt->tip->deleted &&
+           !Tcl_InterpDeleted(wt->interp);
+}
+
+static void
+queue_change(struct widget_tracker *wt, int created, const char *path, Tk_Uid cls)
+{
+    size_t len = strlen(path);
+    struct widget_change *c = (struct widget_change *)ckalloc(sizeof(*c) + len);
+
+    c->next = NULL;
+    c->created = created;
+    c->cls = cls;
+    memcpy(c->path, path, len + 1);
+    if (wt->changes_tail) {
+        wt->changes_tail->next = c;
+    } else {
+        wt->changes_head = c;
+    }
+    wt->changes_tail = c;
+
+    if (!wt->flush_pending) {
+        wt->flush_pending = 1;
+        Tcl_DoWhenIdle(widget_tracker_idle, (ClientData)wt);
+    }
+}
+
+static void
+drop_changes(struct widget_tracker *wt)
+{
+    struct widget_change *c = wt->changes_head, *next;
+
+    for (; c; c = next) {
+        next = c->next;
+        ckfree((char *)c);
+    }
+    wt->changes_head = wt->changes_tail = NULL;
+}
+
+static VALUE
+call_listener(VALUE arg)
+{
+    VALUE *pair = (VALUE *)arg;
+    return rb_proc_call(pair[0], rb_ary_new_from_args(1, pair[1]));
+}
+
+static void *
+widget_tracker_flush(void *arg)
+{
+    struct widget_tracker *wt = (struct widget_tracker *)arg;
+    Tcl_Interp *interp = wt->interp;
+    struct widget_change *c;
+    VALUE pair[2];
+    int state = 0;
+
+    if (wt->changes_head == NULL || NIL_P(wt->listener)) {
+        drop_changes(wt);
+        return NULL;
+    }
+
+    pair[0] = wt->listener;
+    pair[1] = rb_ary_new();
+    for (c = wt->changes_head; c; c = c->next) {
+        rb_ary_push(pair[1], rb_ary_new_from_args(3,
+            c->created ? sym_created : sym_destroyed,
+            rb_utf8_str_new_cstr(c->path),
+            c->cls ? rb_utf8_str_new_cstr(c->cls) : Qnil));
+    }
+    drop_changes(wt);
+    rb_protect(call_listener, (VALUE)pair, &state);
+
+    if (state) {
+        VALUE errinfo = rb_errinfo();
+        VALUE msg;
+        rb_set_errinfo(Qnil);
+
+        /* Let SystemExit and Interrupt propagate - don't swallow them */
+        if (rb_obj_is_kind_of(errinfo, rb_eSystemExit) ||
+            rb_obj_is_kind_of(errinfo, rb_eInterrupt)) {
+            rb_exc_raise(errinfo);
+        }
+
+        /* Others go to the Tcl background error handler, like callbacks */
+        msg = rb_funcall(errinfo, rb_intern("message"), 0);
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(StringValueCStr(msg), -1));
+        Tcl_BackgroundException(interp, TCL_ERROR);
+    }
+    return NULL;
+}
+
+static void
+widget_tracker_idle(ClientData cd)
+{
+    struct widget_tracker *wt = (struct widget_tracker *)cd;
+
+    wt->flush_pending = 0;
+    if (wt->tip->deleted) {
+        drop_changes(wt);
+        return;
+    }
+    teek_call_with_gvl(widget_tracker_flush, wt);
+}
+
+/* ---------------------------------------------------------
+ * Tcl/Tk hooks (no Ruby, safe without the GVL)
+ * --------------------------------------------------------- */
+
+static void
+widget_event_proc(ClientData cd, XEvent *eventPtr)
+{
+    struct tracked_widget *tw = (struct tracked_widget *)cd;
+    struct widget_tracker *wt = tw->wt;
+
+    if (eventPtr->type != DestroyNotify) return;
+
+    /* Tk drops the window's handlers itself after DestroyNotify */
+    if (notifications_wanted(wt)) {
+        queue_change(wt, 0, Tcl_GetHashKey(&wt->widgets, tw->entry), NULL);
+    }
+    Tcl_DeleteHashEntry(tw->entry);
+    ckfree((char *)tw);
+}
+
+/* Execution trace: teek_track_widget cmd_string code result op */
+static int
+track_widget_cmd(ClientData cd, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    struct widget_tracker *wt = (struct widget_tracker *)cd;
+    struct tracked_widget *tw;
+    Tcl_HashEntry *entry;
+    Tk_Window mainwin, tkwin;
+    const char *path;
+    int code, is_new;
+
+    if (objc != 5) return TCL_OK;
+    if (Tcl_GetIntFromObj(NULL, objv[2], &code) != TCL_OK || code != TCL_OK) {
+        return TCL_OK;
+    }
+
+    /* Widget commands return the new path */
+    path = Tcl_GetString(objv[3]);
+    if (path[0] != '.') return TCL_OK;
+    if (wt->exclude && strncmp(path, wt->exclude, strlen(wt->exclude)) == 0) {
+        return TCL_OK;
+    }
+    if ((mainwin = Tk_MainWindow(interp)) == NULL) {
+        Tcl_ResetResult(interp);
+        return TCL_OK;
+    }
+    if ((tkwin = Tk_NameToWindow(interp, path, mainwin)) == NULL) {
+        Tcl_ResetResult(interp);
+        return TCL_OK;
+    }
+
+    entry = Tcl_CreateHashEntry(&wt->widgets, path, &is_new);
+    if (!is_new) return TCL_OK;
+
+    tw = (struct tracked_widget *)ckalloc(sizeof(*tw));
+    tw->wt = wt;
+    tw->entry = entry;
+    tw->tkwin = tkwin;
+    tw->cls = Tk_Class(tkwin);
+    Tcl_SetHashValue(entry, tw);
+    Tk_CreateEventHandler(tkwin, StructureNotifyMask, widget_event_proc, (ClientData)tw);
+
+    if (notifications_wanted(wt)) {
+        queue_change(wt, 1, path, tw->cls);
+    }
+    return TCL_OK;
+}
+
+/* ---------------------------------------------------------
+ * Lifetime
+ * --------------------------------------------------------- */
+
+void
+teek_widgets_mark(struct tcltk_interp *tip)
+{
+    if (tip->widgets) {
+        rb_gc_mark(tip->widgets->listener);
+    }
+}
+
+void
+teek_widgets_free(struct tcltk_interp *tip)
+{
+    struct widget_tracker *wt = tip->widgets;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *e;
+
+    if (!wt) return;
+
+    /* Entries left are windows still alive: unhook them */
+    for (e = Tcl_FirstHashEntry(&wt->widgets, &search); e; e = Tcl_NextHashEntry(&search)) {
+        struct tracked_widget *tw = (struct tracked_widget *)Tcl_GetHashValue(e);
+        Tk_DeleteEventHandler(tw->tkwin, StructureNotifyMask, widget_event_proc, (ClientData)tw);
+        ckfree((char *)tw);
+    }
+    Tcl_DeleteHashTable(&wt->widgets);
+    if (wt->flush_pending) {
+        Tcl_CancelIdleCall(widget_tracker_idle, (ClientData)wt);
+    }
+    drop_changes(wt);
+    xfree(wt->exclude);
+    xfree(wt);
+    tip->widgets = NULL;
+}
+
+/* ---------------------------------------------------------
+ * Interp#track_widgets(commands, exclude: nil) -> nil
+ *
+ * Tracks the widgets created by each command in commands (e.g.
+ * Teek::WIDGET_COMMANDS). Paths starting with exclude are skipped.
+ * Calling it again adds commands; exclude: given again replaces the
+ * prefix. Commands that don't exist are ignored; a trace Tcl refuses
+ * raises TclError. Main thread only.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_track_widgets(int argc, VALUE *argv, VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct widget_tracker *wt = tip->widgets;
+    VALUE commands, opts, exclude = Qundef;
+    long i;
+
+    rb_scan_args(argc, argv, "1:", &commands, &opts);
+    commands = rb_Array(commands);
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        rb_raise(eTclError, "track_widgets must be called from the main thread");
+    }
+    if (!NIL_P(opts)) {
+        rb_get_kwargs(opts, &id_exclude_kw, 0, 1, &exclude);
+    }
+
+    if (!wt) {
+        wt = ALLOC(struct widget_tracker);
+        memset(wt, 0, sizeof(*wt));
+        wt->tip = tip;
+        wt->interp = tip->interp;
+        wt->listener = Qnil;
+        Tcl_InitHashTable(&wt->widgets, TCL_STRING_KEYS);
+        tip->widgets = wt;
+        Tcl_CreateObjCommand(tip->interp, TRACK_CMD, track_widget_cmd, (ClientData)wt, NULL);
+    }
+    if (exclude != Qundef) {
+        xfree(wt->exclude);
+        wt->exclude = NIL_P(exclude) ? NULL : ruby_strdup(StringValueCStr(exclude));
+    }
+
+    for (i = 0; i < RARRAY_LEN(commands); i++) {
+        VALUE cmd = rb_String(RARRAY_AREF(commands, i));
+        Tcl_Obj *objv[6];
+        int j, traced, code = TCL_OK;
+
+        /* objv[1] flips from "info" to "add": query first, so commands
+         * that don't exist are skipped and repeated calls don't stack */
+        objv[0] = Tcl_NewStringObj("trace", -1);
+        objv[1] = Tcl_NewStringObj("info", -1);
+        objv[2] = Tcl_NewStringObj("execution", -1);
+        objv[3] = Tcl_NewStringObj(RSTRING_PTR(cmd), RSTRING_LEN(cmd));
+        objv[4] = Tcl_NewStringObj("leave", -1);
+        objv[5] = Tcl_NewStringObj(TRACK_CMD, -1);
+        for (j = 0; j < 6; j++) Tcl_IncrRefCount(objv[j]);
+
+        if (Tcl_EvalObjv(tip->interp, 4, objv, 0) == TCL_OK) {
+            traced = strstr(Tcl_GetStringResult(tip->interp), TRACK_CMD) != NULL;
+            if (!traced) {
+                Tcl_DecrRefCount(objv[1]);
+                objv[1] = Tcl_NewStringObj("add", -1);
+                Tcl_IncrRefCount(objv[1]);
+                code = Tcl_EvalObjv(tip->interp, 6, objv, 0);
+            }
+        }
+        for (j = 0; j < 6; j++) Tcl_DecrRefCount(objv[j]);
+        if (code != TCL_OK) {
+            VALUE msg = rb_utf8_str_new_cstr(Tcl_GetStringResult(tip->interp));
+            Tcl_ResetResult(tip->interp);
+            rb_raise(eTclError, "track_widgets: %"PRIsVALUE, msg);
+        }
+        Tcl_ResetResult(tip->interp);
+    }
+    return Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Interp#tracked_widgets -> Hash
+ *
+ * { path => { class: "Button", parent: ".frame" }, ... } for every
+ * tracked widget alive now, built on each call. Empty before
+ * track_widgets. Calls from other threads run on the main thread.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_tracked_widgets(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+    struct widget_tracker *wt = tip->widgets;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *e;
+    VALUE hash, sym_class, sym_parent;
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("tracked_widgets"), rb_ary_new());
+    }
+
+    hash = rb_hash_new();
+    if (!wt) return hash;
+
+    sym_class = ID2SYM(rb_intern("class"));
+    sym_parent = ID2SYM(rb_intern("parent"));
+    for (e = Tcl_FirstHashEntry(&wt->widgets, &search); e; e = Tcl_NextHashEntry(&search)) {
+        struct tracked_widget *tw = (struct tracked_widget *)Tcl_GetHashValue(e);
+        const char *path = Tcl_GetHashKey(&wt->widgets, e);
+        const char *dot = strrchr(path, '.');
+        VALUE info = rb_hash_new();
+
+        rb_hash_aset(info, sym_class, rb_utf8_str_new_cstr(tw->cls));
+        rb_hash_aset(info, sym_parent, dot == path ? rb_utf8_str_new_cstr(".")
+                                                   : rb_utf8_str_new(path, dot - path));
+        rb_hash_aset(hash, rb_utf8_str_new_cstr(path), info);
+    }
+    return hash;
+}
+
+/* ---------------------------------------------------------
+ * Interp#widget_tracked?(path) -> true/false
+ *
+ * Hash lookup without building the whole table.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_widget_tracked_p(VALUE self, VALUE path)
+{
+    struct tcltk_interp *tip = get_interp(self);
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        return teek_queue_funcall(tip, self, rb_intern("widget_tracked?"), rb_ary_new3(1, path));
+    }
+    if (!tip->widgets) return Qfalse;
+    return Tcl_FindHashEntry(&tip->widgets->widgets, StringValueCStr(path)) ? Qtrue : Qfalse;
+}
+
+/* ---------------------------------------------------------
+ * Interp#on_widget_change { |changes| ... } -> nil
+ *
+ * Once per idle cycle with anything created or destroyed, the block
+ * gets an Array of [:created, path, class] and [:destroyed, path, nil]
+ * in the order they happened. Without a block, removes the listener.
+ * Nothing is queued while there is no listener, so tracking alone
+ * never calls into Ruby. Errors raised by the block go to the Tcl
+ * background error handler. Main thread only.
+ * --------------------------------------------------------- */
+
+static VALUE
+interp_on_widget_change(VALUE self)
+{
+    struct tcltk_interp *tip = get_interp(self);
+
+    if (Tcl_GetCurrentThread() != tip->main_thread_id) {
+        rb_raise(eTclError, "on_widget_change must be called from the main thread");
+    }
+    if (!tip->widgets) {
+        rb_raise(eTclError, "widget tracking is not enabled (call track_widgets first)");
+    }
+    tip->widgets->listener = rb_block_given_p() ? rb_block_proc() : Qnil;
+    if (NIL_P(tip->widgets->listener)) {
+        drop_changes(tip->widgets);
+    }
+    return Qnil;
+}
+
+/* ---------------------------------------------------------
+ * Init — called from Init_tcltklib
+ * --------------------------------------------------------- */
+
+void
+Init_tkwidgets(VALUE cInterp)
+{
+    id_exclude_kw = rb_intern("exclude");
+    sym_created = ID2SYM(rb_intern("created"));
+    sym_destroyed = ID2SYM(rb_intern("destroyed"));
+
+    rb_define_method(cInterp, "track_widgets", interp_track_widgets, -1);
+    rb_define_method(cInterp, "tracked_widgets", interp_tracked_widgets, 0);
+    rb_define_method(cInterp, "widget_tracked?", interp_widget_tracked_p, 1);
+    rb_define_method(cInterp, "on_widget_change", interp_on_widget_change, 0);
+}
@@ -5,6 +5,7 @@ require_relative 'teek/version'
 require_relative 'teek/ractor_support'
 require_relative 'teek/widget'
 require_relative 'teek/photo'
+require_relative 'teek/fiber_scheduler'
 
 # Ruby interface to Tcl/Tk. Provides a thin wrapper around a Tcl interpreter
 # with Ruby callbacks, event bindings, and background work support.
@@ -47,14 +48,13 @@ module Teek
   ].freeze
 
   class App
-    attr_reader :interp, :widgets, :debugger
+    attr_reader :interp, :debugger
     attr_writer :_pending_exception # @api private
 
     def initialize(title: nil, track_widgets: true, debug: false, &block)
       @interp = Teek::Interp.new
       @interp.tcl_eval('package require Tk')
       hide
-      @widgets = {}
       @widget_counters = Hash.new(0)
       @_pending_exception = nil
       debug ||= !!ENV['TEEK_DEBUG']
@@ -63,6 +63,7 @@ module Teek
       if debug
         require_relative 'teek/debugger'
         @debugger = Teek::Debugger.new(self)
+        @interp.on_widget_change { |changes| @debugger.on_widget_changes(changes) }
       end
       set_window_title(title) if title
       instance_eval(&block) if block
@@ -72,18 +73,60 @@ module Teek
     # Prefer {#command} for building commands from Ruby values; use this
     # when you need Tcl-level features like variable substitution or
     # inline expressions that {#command} can't express.
+    #
+    # Pass +result:+ to convert the Tcl result object directly instead of
+    # getting a String back: +:list+ (Array of Strings), +:int+, +:double+,
+    # +:bool+, +:dict+ (Hash), or +:auto+, which picks a Ruby type from the
+    # object's internal representation without generating a string.
+    # @example
+    #   app.tcl_eval('winfo children .', result: :list)  # => [".btn", ".lbl"]
     # @param script [String] Tcl code to evaluate
-    # @return [String] the Tcl result
-    def tcl_eval(script)
-      @interp.tcl_eval(script)
+    # @param result [Symbol] result conversion (default +:string+)
+    # @return [String, Array, Integer, Float, Boolean, Hash] the Tcl result
+    # @raise [Teek::TclError] if the result doesn't parse as the requested type
+    def tcl_eval(script, result: :string)
+      @interp.tcl_eval(script, result: result)
     end
 
     # Invoke a Tcl command with pre-split arguments (no Tcl parsing).
     # Safer than {#tcl_eval} when arguments may contain special characters.
     # @param args [Array<String>] command name followed by arguments
-    # @return [String] the Tcl result
-    def tcl_invoke(*args)
-      @interp.tcl_invoke(*args)
+    # @param result [Symbol] result conversion, as for {#tcl_eval}
+    # @return [String, Array, Integer, Float, Boolean, Hash] the Tcl result
+    def tcl_invoke(*args, result: :string)
+      @interp.tcl_invoke(*args, result: result)
+    end
+
+    # Queue {#tcl_eval} for the main thread without waiting for it.
+    # Meant for background threads: issue many calls and block only on
+    # the results you need. On the main thread the script runs at once.
+    # @example
+    #   rows.each { |r| app.tcl_eval_nowait(".log insert end {#{r}}") }
+    #   count = app.tcl_eval_async('.log index end', result: :int).value
+    # @param script [String] Tcl code to evaluate
+    # @param result [Symbol] result conversion, as for {#tcl_eval}
+    # @return [Teek::Future] settles with the result or the raised error
+    def tcl_eval_async(script, result: :string)
+      @interp.tcl_eval_async(script, result: result)
+    end
+
+    # Asynchronous {#tcl_invoke}; see {#tcl_eval_async}.
+    # @return [Teek::Future]
+    def tcl_invoke_async(*args, result: :string)
+      @interp.tcl_invoke_async(*args, result: result)
+    end
+
+    # Fire-and-forget {#tcl_eval}: no reply is kept. Errors raised off the
+    # main thread are reported with +warn+.
+    # @return [nil]
+    def tcl_eval_nowait(script)
+      @interp.tcl_eval_nowait(script)
+    end
+
+    # Fire-and-forget {#tcl_invoke}; see {#tcl_eval_nowait}.
+    # @return [nil]
+    def tcl_invoke_nowait(*args)
+      @interp.tcl_invoke_nowait(*args)
     end
 
     # Register a Ruby callable as a Tcl callback.
@@ -91,10 +134,17 @@ module Teek
     #   throw :teek_break    - stop event propagation (like Tcl "break")
     #   throw :teek_continue - Tcl TCL_CONTINUE
     #   throw :teek_return   - Tcl TCL_RETURN
+    #
+    # By default every argument arrives as a String. Pass +types:+ to have
+    # the C dispatcher convert arguments by position instead, with no
+    # intermediate String; values that don't parse are passed as Strings.
+    # @example Integer coordinates
+    #   id = app.register_callback(proc { |x, y| x + y }, types: [:int, :int])
     # @param callable [#call] a Proc or lambda to invoke from Tcl
+    # @param types [Array<:str, :int, :float, :bool>, nil] per-argument conversions
     # @return [Integer] callback ID, usable as +ruby_callback <id>+ in Tcl
     # @see #unregister_callback
-    def register_callback(callable)
+    def register_callback(callable, types: nil)
       wrapped = proc { |*args|
         caught = nil
         catch(:teek_break) do
@@ -110,7 +160,7 @@ module Teek
         caught ||= :break
         caught == :_none ? nil : caught
       }
-      @interp.register_callback(wrapped)
+      @interp.register_callback(wrapped, types: types, site: callback_site)
     end
 
     # Remove a previously registered callback by its ID.
@@ -127,38 +177,23 @@ module Teek
     #   - +Proc+ — called with the exception; error is swallowed.
     #   - +nil+ — error is silently swallowed.
     # @yield block to call when the timer fires
-    # @return [String] timer ID, pass to {#after_cancel} to cancel
+    # @return [Teek::Timer] pass to {#after_cancel} (or call +cancel+) to cancel
     # @see https://www.tcl-lang.org/man/tcl8.6/TclCmd/after.htm#M5 after ms
     def after(ms, on_error: :raise, &block)
-      cb_id = nil
-      cb_id = @interp.register_callback(proc { |*|
-        begin
-          block.call
-        rescue => e
-          raise if on_error == :raise
-          on_error.call(e) if on_error.is_a?(Proc)
-        ensure
-          @interp.unregister_callback(cb_id)
-        end
-      })
-      after_id = @interp.tcl_eval("after #{ms.to_i} {ruby_callback #{cb_id}}")
-      after_id.instance_variable_set(:@cb_id, cb_id)
-      after_id
+      @interp.after(ms.to_i, site: callback_site) do
+        block.call
+      rescue => e
+        raise if on_error == :raise
+        on_error.call(e) if on_error.is_a?(Proc)
+      end
     end
 
     # Schedule a block to run once when the event loop is idle.
     # @yield block to call when the event loop is idle
-    # @return [String] timer ID, pass to {#after_cancel} to cancel
+    # @return [Teek::Timer] pass to {#after_cancel} (or call +cancel+) to cancel
     # @see https://www.tcl-lang.org/man/tcl8.6/TclCmd/after.htm#M9 after idle
     def after_idle(&block)
-      cb_id = nil
-      cb_id = @interp.register_callback(proc { |*|
-        block.call
-        @interp.unregister_callback(cb_id)
-      })
-      after_id = @interp.tcl_eval("after idle {ruby_callback #{cb_id}}")
-      after_id.instance_variable_set(:@cb_id, cb_id)
-      after_id
+      @interp.after_idle(site: callback_site, &block)
     end
 
     # Schedule a repeating timer. Calls the block every +ms+ milliseconds
@@ -185,34 +220,102 @@ module Teek
     #   timer = app.every(50, on_error: nil) { maybe_fails }
     #   timer.last_error  # => check later
     def every(ms, on_error: :raise, &block)
-      RepeatingTimer.new(self, ms, on_error: on_error, &block)
+      RepeatingTimer.new(self, ms, on_error: on_error, site: callback_site, &block)
     end
 
     # Cancel a pending {#after} or {#after_idle} timer.
-    # @param after_id [String] timer ID returned by {#after} or {#after_idle}
+    # @param after_id [Teek::Timer, String] timer returned by {#after} or
+    #   {#after_idle}, or an id from a Tcl +after+ command
     # @return [void]
     # @see https://www.tcl-lang.org/man/tcl8.6/TclCmd/after.htm#M7 after cancel
     def after_cancel(after_id)
-      @interp.tcl_eval("after cancel #{after_id}")
-      if (cb_id = after_id.instance_variable_get(:@cb_id))
-        @interp.unregister_callback(cb_id)
-        after_id.instance_variable_set(:@cb_id, nil)
+      if after_id.is_a?(Teek::Timer)
+        after_id.cancel
+      else
+        @interp.tcl_eval("after cancel #{after_id}")
       end
       after_id
     end
 
+    # Call a block from the event loop whenever +io+ is ready, without a
+    # thread per stream or a polling timer. The descriptor goes straight
+    # to Tcl's notifier, so the loop wakes as soon as data arrives (or
+    # the pipe/socket can take more).
+    #
+    # Watching is level-triggered: read what is available (with
+    # +read_nonblock+ or +readpartial+) or the block is called again.
+    # Cancel the watch before closing the IO.
+    #
+    # @param io [IO, #to_io] socket, pipe, subprocess output, ...
+    # @param events [Symbol, Array<Symbol>, Integer] +:read+, +:write+,
+    #   +:priority+, an Array of them, or +IO::READABLE+/+WRITABLE+/+PRIORITY+ bits
+    # @param on_error [:raise, Proc, nil] error handling strategy:
+    #   - +:raise+ (default) — cancels the watch and raises the exception
+    #     from the next call to {#update}.
+    #   - +Proc+ — called with the exception; the watch keeps running.
+    #   - +nil+ — cancels the watch silently.
+    # @yield [io, ready] +ready+ is the +IO::READABLE+/+WRITABLE+/+PRIORITY+ bits set
+    # @return [Teek::IOWatch] call +cancel+ to stop watching
+    # @raise [NotImplementedError] on Windows
+    #
+    # @example Tail a subprocess into a text widget
+    #   out = IO.popen(%w[tail -f /var/log/syslog])
+    #   watch = app.watch_io(out) do |io|
+    #     app.command('.log', :insert, :end, io.read_nonblock(4096))
+    #   rescue EOFError
+    #     watch.cancel
+    #     io.close
+    #   end
+    def watch_io(io, events = :read, on_error: :raise, &block)
+      watch = @interp.watch_io(io, events, site: callback_site) do |ready_io, ready|
+        block.call(ready_io, ready)
+      rescue => e
+        if on_error.is_a?(Proc)
+          begin
+            on_error.call(e)
+          rescue => handler_err
+            watch.cancel
+            @_pending_exception = handler_err
+          end
+        else
+          watch.cancel
+          # Raised from the next update, not sent to bgerror
+          @_pending_exception = e if on_error == :raise
+        end
+      end
+    end
+
     # Split a Tcl list string into a Ruby array of strings.
-    # @param str [String] a Tcl-formatted list
-    # @return [Array<String>]
-    def split_list(str)
-      Teek.split_list(str)
+    # @param str [String, Teek::TclObj] a Tcl-formatted list
+    # @param deep [Boolean, Integer] also decode nested lists, to any
+    #   depth (+true+) or that many levels
+    # @return [Array]
+    def split_list(str, deep: false)
+      Teek.split_list(str, deep: deep)
     end
 
-    # Build a properly-escaped Tcl list from Ruby strings.
-    # @param args [Array<String>] elements to join
-    # @return [String] a Tcl-formatted list
-    def make_list(*args)
-      Teek.make_list(*args)
+    # Split a Tcl dict (or option/value list, like +font actual+ output)
+    # into a Hash.
+    # @example
+    #   app.split_dict(app.tcl_eval('font actual TkDefaultFont'))
+    #   # => {"-family" => "DejaVu Sans", "-size" => "9", ...}
+    # @param str [String, Teek::TclObj] a Tcl-formatted dict
+    # @param deep [Boolean, Integer] decode values that are lists, as in {#split_list}
+    # @return [Hash{String => Object}]
+    def split_dict(str, deep: false)
+      Teek.split_dict(str, deep: deep)
+    end
+
+    # Build a properly-escaped Tcl list from Ruby values. Integers and
+    # Floats become numeric Tcl objects, Arrays nested lists, nil "".
+    # @example Canvas coordinates, reused across calls
+    #   coords = app.make_list(*points.flatten, result: :obj)
+    #   app.command(canvas, 'coords', 'line', coords)
+    # @param args [Array<String, Symbol, Integer, Float, Array, nil, Teek::TclObj>] elements
+    # @param result [:string, :obj] return a String or a reusable {Teek::TclObj}
+    # @return [String, Teek::TclObj] a Tcl-formatted list
+    def make_list(*args, result: :string)
+      Teek.make_list(*args, result: result)
     end
 
     # Convert a Tcl boolean string ("0", "1", "yes", "no", etc.) to Ruby boolean.
@@ -229,44 +332,63 @@ module Teek
       Teek.bool_to_tcl(val)
     end
 
-    # Build and evaluate a Tcl command from Ruby values.
-    # Positional args are converted: Symbols pass bare, Procs become
-    # callbacks, everything else is brace-quoted. Keyword args become
-    # +-key value+ option pairs.
+    # Invoke a Tcl command built from Ruby values.
+    #
+    # Arguments are marshalled straight into Tcl objects by the C
+    # extension, so nothing is quoted into a script and re-parsed:
+    # Integers and Floats keep their numeric representation, Arrays
+    # become Tcl lists, Symbols pass bare, nil becomes an empty string,
+    # and Procs become callbacks (any following +%+-prefixed Strings
+    # are appended as substitutions). Keyword args become +-key value+
+    # option pairs.
     # @example
     #   app.command(:pack, '.btn', side: :left, padx: 10)
-    #   # evaluates: pack .btn -side left -padx {10}
+    #   # invokes: pack .btn -side left -padx 10
     # @param cmd [Symbol, String] the Tcl command name
     # @param args positional arguments
     # @param kwargs keyword arguments mapped to +-key value+ pairs
     # @return [String] the Tcl result
     def command(cmd, *args, **kwargs)
-      parts = [cmd.to_s]
-      i = 0
-      while i < args.length
-        arg = args[i]
-        if arg.is_a?(Proc)
-          id = @interp.register_callback(arg)
-          subs = []
-          while i + 1 < args.length && args[i + 1].is_a?(String) && args[i + 1].start_with?('%')
-            subs << args[i + 1]
-            i += 1
-          end
-          parts << if subs.empty?
-                     "{ruby_callback #{id}}"
-                   else
-                     "{ruby_callback #{id} #{subs.join(' ')}}"
-                   end
-        else
-          parts << tcl_value(arg)
-        end
-        i += 1
-      end
-      kwargs.each do |key, value|
-        parts << "-#{key}"
-        parts << tcl_value(value)
-      end
-      @interp.tcl_eval(parts.join(' '))
+      @interp.command(cmd, *args, **kwargs)
+    end
+
+    # Compile a Tcl script once for repeated evaluation.
+    #
+    # The returned {Teek::Script} keeps the script in a retained Tcl
+    # object, so Tcl reuses its cached bytecode on every +call+ instead
+    # of recompiling the source like {#tcl_eval} does. With +params:+ the
+    # script runs as an +apply+ lambda body: arguments to +call+ bind to
+    # the named parameters, and variables are local to the call (use
+    # +global+ or +upvar #0+ for globals).
+    # @example
+    #   move = app.compile('.c move $item $dx $dy', params: %w[item dx dy])
+    #   move.call(id, 2, 0)
+    # @param script [String] Tcl code
+    # @param params [Array<String, Symbol>, nil] parameter names
+    # @return [Teek::Script]
+    def compile(script, params: nil)
+      @interp.compile(script, params: params)
+    end
+
+    # Record many Tcl commands and run them in a single pass.
+    #
+    # The block receives a {Teek::Batch}; +b.command+ takes the same
+    # arguments as {#command} and +b.invoke+ the same as +tcl_invoke+.
+    # Nothing runs until the block returns, and a batch built on a
+    # background thread crosses to the main thread once.
+    #
+    # @example Populate a canvas
+    #   app.batch(results: false) do |b|
+    #     points.each { |x, y| b.command(canvas, :create, :oval, x, y, x + 2, y + 2) }
+    #   end
+    # @param results [Boolean] collect each command's result string
+    # @param capacity [Integer] initial number of command slots to allocate
+    # @yieldparam b [Teek::Batch]
+    # @return [Array<String>, Integer] results, or the command count when +results: false+
+    # @raise [Teek::BatchError] on the first failing command; +#index+ is its
+    #   position and +#results+ holds the results of the commands before it
+    def batch(results: true, capacity: 16, &block)
+      @interp.batch(results: results, capacity: capacity, &block)
     end
 
     # Create a Tk widget and return a {Widget} wrapper.
@@ -367,6 +489,78 @@ module Teek
       tcl_eval("set #{name}")
     end
 
+    # Read many global variables in one call. A key is a variable name or
+    # a +[array, index]+ pair for an element.
+    #
+    # @example
+    #   app.get_variables(['first', 'last', ['form', 'email']])
+    #   # => {"first" => "Ada", "last" => "Lovelace", ["form", "email"] => nil}
+    # @param keys [Array<String, Array(String, String)>]
+    # @return [Hash] each key mapped to its value, or nil if unset
+    def get_variables(keys)
+      @interp.get_vars(keys)
+    end
+
+    # Set many global variables in one call, e.g. to sync every
+    # +-textvariable+ of a form from its model. Keys as in {#get_variables};
+    # values convert like {#command} arguments.
+    # @param values [Hash]
+    # @return [Hash] values
+    # @raise [Teek::TclError] at the first variable Tcl refuses
+    def set_variables(values)
+      @interp.set_vars(values)
+    end
+
+    # All elements of a Tcl array.
+    # @param name [String] array variable name
+    # @return [Hash{String => String}] empty if +name+ is not an array
+    def array_get(name)
+      @interp.array_get(name)
+    end
+
+    # Set elements of a Tcl array, creating it if needed.
+    # @param name [String] array variable name
+    # @param values [Hash] index => value
+    # @return [Hash] values
+    def array_set(name, values)
+      @interp.array_set(name, values)
+    end
+
+    # Get notified when global variables change, instead of polling them.
+    # Write and unset traces are kept in C; once per idle cycle the block
+    # gets every change since the last call as +[name, index, value]+
+    # (+index+ is the array element or nil; +value+ is nil once unset).
+    # Variables created later are picked up by {Teek::VarTrace#rescan}.
+    #
+    # @example Mirror -textvariable values into a model
+    #   trace = app.trace_vars('form_*') do |changes|
+    #     changes.each { |name, _index, value| model[name] = value }
+    #   end
+    #   trace.cancel # when done
+    # @param pattern [String] glob pattern for global variable names
+    # @yieldparam changes [Array<Array(String, String, String)>]
+    # @return [Teek::VarTrace]
+    def trace_vars(pattern = '*', &block)
+      @interp.trace_vars(pattern, &block)
+    end
+
+    # Widgets created since the app started, when +track_widgets:+ is on.
+    # The table lives in C and is updated by Tk itself; this builds a
+    # snapshot Hash, so prefer {#widget_tracked?} for single lookups.
+    # @example
+    #   app.widgets['.btn'] # => { class: "Button", parent: "." }
+    # @return [Hash{String => Hash}] path => +{ class:, parent: }+
+    def widgets
+      @interp.tracked_widgets
+    end
+
+    # Whether a tracked widget with this path exists.
+    # @param path [String] Tk widget path
+    # @return [Boolean]
+    def widget_tracked?(path)
+      @interp.widget_tracked?(path)
+    end
+
     # Destroy a widget and all its children.
     # @param widget [String] Tk widget path (e.g. ".frame1")
     # @return [void]
@@ -428,7 +622,10 @@ module Teek
     end
 
     # Enter the Tk event loop. Blocks until the application exits.
+    # Set +interp.mainloop_mode = :event+ beforehand to wait for events
+    # without holding the GVL (no polling timer, no CPU use when idle).
     # @return [void]
+    # @see Teek::Interp#mainloop_mode=
     # @see https://www.tcl-lang.org/man/tcl8.6/TkLib/MainLoop.htm Tk_MainLoop
     def mainloop
       if defined?(IRB) || defined?(Pry) || $0 == 'irb' || $0 == 'pry'
@@ -442,6 +639,95 @@ module Teek
       @interp.mainloop
     end
 
+    # Run a frame-paced loop instead of {#mainloop}: each frame processes
+    # pending Tk events, yields, then sleeps (without the GVL) until the
+    # next frame is due. Useful for games and animations that redraw on
+    # a fixed tick.
+    #
+    # Stops when the block breaks, after +frames+ frames, or when the
+    # last main window is destroyed. An error stored by a timer's
+    # +on_error: :raise+ is raised between frames, as from {#update}.
+    #
+    # @example
+    #   app.run_frames(fps: 60) do |t|
+    #     world.step(t.dt)
+    #     warn "frame #{t.frame - 1} overran" if t.late
+    #   end
+    # @param fps [Numeric] target frame rate
+    # @param frames [Integer, nil] stop after this many frames
+    # @param event_budget_ms [Numeric, nil] max time spent processing
+    #   events per frame (default: half the frame period); at least one
+    #   pending event is processed per frame even with a budget of 0
+    # @yieldparam timing [Teek::FrameTiming] frame number, +dt+ in seconds,
+    #   and the previous frame's +event_ms+, +callback_ms+, +render_ms+,
+    #   +slack_ms+ and +late+
+    # @return [Integer] number of frames run
+    # @see Teek::Interp#run_frames
+    def run_frames(fps: 60, frames: nil, event_budget_ms: nil)
+      @interp.run_frames(fps: fps, frames: frames, event_budget_ms: event_budget_ms) do |timing|
+        if (e = @_pending_exception)
+          @_pending_exception = nil
+          raise e
+        end
+        yield timing
+      end
+    end
+
+    # Event loop counters kept in C: iterations, events handled by kind
+    # (+:window+, +:timer_file+, +:idle+, +:cross_thread+) and the time
+    # they took, per-callback call counts and timings, cross-thread queue
+    # depth, and log2 latency histograms. Cheap enough to leave on.
+    #
+    # @example Where is the main thread's time going?
+    #   s = app.stats
+    #   s[:event_us]                                      # => {window: ..., ...}
+    #   Teek::Stats.percentile(s[:histograms][:callback], 99)  # => 4096 (us)
+    # @return [Hash] snapshot; see {Teek::Interp#stats} for the keys
+    def stats
+      @interp.stats
+    end
+
+    # Zero the counters reported by {#stats}.
+    # @return [void]
+    def reset_stats
+      @interp.reset_stats
+    end
+
+    # The callbacks that cost the most, from always-on per-callback
+    # accounting. Each row has the callback +id+, +calls+, +total_us+,
+    # +max_us+, +errors+ (calls that raised) and +site+, the
+    # "file:line" that created it via {#register_callback}, {#bind},
+    # {#after}, {#after_idle} or {#every}. Callbacks already released
+    # (one-shot timers, replaced bindings) are summed per site into
+    # rows with +id+ nil.
+    #
+    # @example Find the slow event handler
+    #   app.callback_top(5, by: :max_us).each do |row|
+    #     puts format("%8.1fms  %s", row[:max_us] / 1000.0, row[:site])
+    #   end
+    # @param n [Integer] number of rows
+    # @param by [:total_us, :max_us, :calls, :errors] sort key (descending)
+    # @return [Array<Hash>]
+    # @see #reset_stats
+    def callback_top(n = 10, by: :total_us)
+      @interp.callback_top(n, by: by)
+    end
+
+    # Callback table counters. Procs passed to {#command} (and blocks
+    # given to {#bind} on a widget path) belong to that widget and are
+    # unregistered after it is destroyed, so +:live+ should level off in
+    # a long-running app rather than grow with every +configure+.
+    # @example
+    #   app.callback_counts
+    #   # => {live: 42, registered: 9120, released: 9078, reused: 310,
+    #   #     owned: 40, widgets: 25}
+    # @return [Hash{Symbol => Integer}] +:live+, +:registered+,
+    #   +:released+, +:reused+ (a Proc passed again kept its id),
+    #   +:owned+ (held by widgets) and +:widgets+ (widgets holding any)
+    def callback_counts
+      @interp.callback_counts
+    end
+
     # Process all pending events and idle callbacks, then return.
     # @return [void]
     # @see https://www.tcl-lang.org/man/tcl8.6/TclCmd/update.htm update
@@ -589,11 +875,27 @@ module Teek
     #   calls inside the block are additional round-trips. This is negligible
     #   for click/key events but could matter for hot-path handlers like
     #   +<Motion>+ that fire hundreds of times per second. For those, consider
-    #   {#tcl_eval} with inline Tcl expressions to do all work in one evaluation.
+    #   {#tcl_eval} with inline Tcl expressions to do all work in one evaluation,
+    #   or +coalesce:+ when only the newest values matter.
     #
     # @param widget [String] Tk widget path or class tag (e.g. ".btn", "Entry")
     # @param event [String] Tk event name, with or without angle brackets
+    # @example Typed substitutions (Integers converted in C)
+    #   app.bind('.c', 'Motion', :x, :y, types: :auto) { |x, y| plot(x, y) }
+    # @example Drag handler called at most once per idle cycle
+    #   app.bind('.c', 'B1-Motion', :x, :y, types: :auto, coalesce: :latest) do |x, y, merged|
+    #     move_brush(x, y)
+    #   end
+    #
     # @param subs [Array<Symbol, String>] substitution codes (see {BIND_SUBS})
+    # @param types [:auto, Array<Symbol>, nil] argument conversions passed to
+    #   {#register_callback}; +:auto+ uses {BIND_TYPES} for Symbol subs and
+    #   +:str+ for raw codes. +nil+ (the default) passes every value as a String.
+    # @param coalesce [:latest, :per_frame, nil] merge bursts of events in C
+    #   and call the block once with the newest values, plus the number of
+    #   events merged as an extra last argument: +:latest+ at the next idle
+    #   point, +:per_frame+ once per {#run_frames} frame (or at 60 Hz outside
+    #   it). The block can't stop event propagation (+throw :teek_break+).
     # @yield [*values] called when the event fires, with substitution values
     # @return [void]
     # @see #unbind
@@ -611,12 +913,36 @@ module Teek
       type: '%T',                          # event type
     }.freeze
 
-    def bind(widget, event, *subs, &block)
+    # Conversion used for each {BIND_SUBS} entry when +types: :auto+.
+    # Subs not listed here arrive as Strings.
+    BIND_TYPES = {
+      x: :int, y: :int,
+      root_x: :int, root_y: :int,
+      keycode: :int,
+      width: :int, height: :int,
+      button: :int,
+      mouse_wheel: :int,
+    }.freeze
+
+    # Tcl command prefix for each {#bind} +coalesce:+ mode
+    BIND_COALESCE = {
+      nil => 'ruby_callback',
+      latest: 'ruby_coalesce latest',
+      per_frame: 'ruby_coalesce frame',
+    }.freeze
+
+    def bind(widget, event, *subs, types: nil, coalesce: nil, &block)
       event_str = event.start_with?('<') ? event : "<#{event}>"
-      cb = register_callback(proc { |*args| block.call(*args) })
+      dispatch = BIND_COALESCE.fetch(coalesce) do
+        raise ArgumentError, "coalesce must be :latest, :per_frame or nil, got #{coalesce.inspect}"
+      end
+      types = subs.map { |s| s.is_a?(Symbol) ? BIND_TYPES.fetch(s, :str) : :str } if types == :auto
+      cb = register_callback(proc { |*args| block.call(*args) }, types: types)
       tcl_subs = subs.map { |s| s.is_a?(Symbol) ? BIND_SUBS.fetch(s) : s.to_s }
       sub_str = tcl_subs.empty? ? '' : ' ' + tcl_subs.join(' ')
-      @interp.tcl_eval("bind #{widget} #{event_str} {ruby_callback #{cb}#{sub_str}}")
+      @interp.tcl_eval("bind #{widget} #{event_str} {#{dispatch} #{cb}#{sub_str}}")
+      # Freed with the widget, or when the event is bound again
+      @interp.attach_callback(cb, widget.to_s, event_str) if widget.to_s.start_with?('.')
     end
 
     # Remove an event binding previously set with {#bind}.
@@ -628,6 +954,7 @@ module Teek
     def unbind(widget, event)
       event_str = event.start_with?('<') ? event : "<#{event}>"
       @interp.tcl_eval("bind #{widget} #{event_str} {}")
+      @interp.detach_callbacks(widget.to_s, event_str) if widget.to_s.start_with?('.')
     end
 
     # Get the macOS window appearance. No-op (returns +nil+) on non-macOS.
@@ -675,6 +1002,17 @@ module Teek
 
     private
 
+    # Frames from teek's own files are skipped when recording where a
+    # callback was registered
+    LIB_PREFIX = File.join(__dir__, 'teek')
+    private_constant :LIB_PREFIX
+
+    # "file:line" of the nearest caller outside teek, or nil
+    def callback_site
+      loc = caller_locations(1, 16).find { |l| !(l.absolute_path || l.path).start_with?(LIB_PREFIX) }
+      loc && "#{loc.path}:#{loc.lineno}"
+    end
+
     # Short prefixes for common Tk widget types.
     # The base name (after the last ::) is looked up here; the namespace
     # prefix (e.g. "ttk") is prepended verbatim.  Unmapped types fall
@@ -738,55 +1076,16 @@ module Teek
     end
 
     def setup_widget_tracking
-      @create_cb_id = @interp.register_callback(proc { |path, cls|
-        next if path.start_with?('.teek_debug')
-        @widgets[path] = { class: cls, parent: File.dirname(path).gsub(/\A$/, '.') }
-        @debugger&.on_widget_created(path, cls)
-      })
-      @destroy_cb_id = @interp.register_callback(proc { |path|
-        next if path.start_with?('.teek_debug')
-        @widgets.delete(path)
-        @debugger&.on_widget_destroyed(path)
-      })
-
-      # Tcl proc called on widget creation (trace leave)
-      @interp.tcl_eval("proc ::teek_track_create {cmd_string code result op} {
-        set path [lindex $cmd_string 1]
-        if {$code == 0 && [winfo exists $path]} {
-          set cls [winfo class $path]
-          ruby_callback #{@create_cb_id} $path $cls
-        }
-      }")
-
-      # Tcl proc called on widget destruction (bind)
-      @interp.tcl_eval("bind all <Destroy> {ruby_callback #{@destroy_cb_id} %W}")
-
-      # Add trace on each widget command
-      Teek::WIDGET_COMMANDS.each do |cmd|
-        @interp.tcl_eval("catch {trace add execution #{cmd} leave ::teek_track_create}")
-      end
-    end
-
-    def tcl_value(value)
-      case value
-      when Proc
-        id = @interp.register_callback(value)
-        "{ruby_callback #{id}}"
-      when Symbol
-        value.to_s
-      when Array
-        "{#{value.map { |v| tcl_value(v) }.join(' ')}}"
-      else
-        "{#{value}}"
-      end
+      @interp.track_widgets(Teek::WIDGET_COMMANDS, exclude: '.teek_debug')
     end
   end
 
   # A cancellable repeating timer that fires on the main thread.
   #
-  # Created via {App#every}. Reschedules itself after each tick using
-  # Tcl's +after+ command. The block runs in the event loop, so it
-  # must complete quickly to avoid blocking the UI.
+  # Created via {App#every}. Wraps a repeating {Teek::Timer}, which
+  # reschedules itself in C from each tick's deadline, so the period
+  # doesn't drift by the block's run time. The block runs in the event
+  # loop, so it must complete quickly to avoid blocking the UI.
   #
   # Tracks timing drift: if a tick fires significantly late (more than
   # 2x the interval), a warning is printed to stderr. This helps catch
@@ -804,92 +1103,76 @@ module Teek
     # @return [Integer] number of ticks that fired late (> 2x interval)
     attr_reader :late_ticks
 
+    # @return [Teek::Timer] the underlying native timer
+    attr_reader :timer
+
     # @api private
-    def initialize(app, ms, on_error: nil, &block)
+    def initialize(app, ms, on_error: nil, site: nil, &block)
       raise ArgumentError, "interval must be positive, got #{ms}" if ms <= 0
 
       @app = app
       @interval = ms
       @block = block
       @on_error = on_error
-      @cancelled = false
-      @after_id = nil
       @last_error = nil
       @late_ticks = 0
-      @next_expected = nil
-      schedule
+      # One timer and callback for the whole lifetime, so its ticks add
+      # up in App#callback_top under the line that called App#every
+      @timer = app.interp.after(ms, repeat: true, site: site) { tick }
     end
 
     # Stop the timer. Safe to call multiple times.
     # @return [void]
     def cancel
-      return if @cancelled
-      @cancelled = true
-      @app.after_cancel(@after_id) if @after_id
-      @after_id = nil
+      @timer.cancel
     end
 
     # @return [Boolean] true if the timer has been cancelled
     def cancelled?
-      @cancelled
+      @timer.cancelled?
     end
 
     # Change the interval. Takes effect on the next tick.
     # @param ms [Integer] new interval in milliseconds
     def interval=(ms)
       raise ArgumentError, "interval must be positive, got #{ms}" if ms <= 0
+      @timer.interval = ms
       @interval = ms
     end
 
     private
 
-    def schedule
-      return if @cancelled
-      @next_expected = now_ms + @interval
-      @after_id = @app.after(@interval) { tick }
-    end
-
     def tick
-      return if @cancelled
       check_drift
       @block.call
-      schedule
     rescue => e
       @last_error = e
       case @on_error
       when :raise
-        @cancelled = true
+        cancel
         # Store on App so it raises from the next app.update call.
-        # Don't re-raise here — that would go through rb_protect → bgerror.
+        # Don't re-raise here — that would go to bgerror.
         @app._pending_exception = e
       when Proc
         begin
           @on_error.call(e)
         rescue => handler_err
           @last_error = handler_err
-          @cancelled = true
+          cancel
           @app._pending_exception = handler_err
-          return
         end
-        schedule
       when nil
-        @cancelled = true
+        cancel
       end
     end
 
     def check_drift
-      return unless @next_expected
-      actual = now_ms
-      drift = actual - @next_expected
+      drift = @timer.lateness_ms
       if drift > @interval
         @late_ticks += 1
         warn "Teek::RepeatingTimer: tick #{@late_ticks} fired #{drift.round}ms late " \
              "(interval=#{@interval}ms)"
       end
     end
-
-    def now_ms
-      Process.clock_gettime(Process::CLOCK_MONOTONIC, :millisecond)
-    end
   end
 end
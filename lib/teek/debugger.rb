@@ -1,9 +1,9 @@
 # frozen_string_literal: true
 
 module Teek
-  # Live inspector for Teek applications. Opens a Toplevel window with three
-  # tabs: Widgets (tree + config), Variables (searchable list), and Watches
-  # (tracked variable history).
+  # Live inspector for Teek applications. Opens a Toplevel window with four
+  # tabs: Widgets (tree + config), Variables (searchable list), Watches
+  # (tracked variable history), and Profile (costliest callbacks).
   #
   # @example
   #   app = Teek::App.new(debug: true)
@@ -14,6 +14,7 @@ module Teek
     TOP = ".teek_debug"
     NB  = "#{TOP}.nb"
     WATCH_HISTORY_SIZE = 50
+    PROFILE_ROWS = 50
 
     attr_reader :interp
 
@@ -47,7 +48,19 @@ module Teek
       @app.hide(TOP)
     end
 
-    # Called by App when a widget is created
+    # Called by App once per idle cycle with the widgets created and
+    # destroyed since the last one (see Interp#on_widget_change)
+    def on_widget_changes(changes)
+      changes.each do |op, path, cls|
+        if op == :created
+          on_widget_created(path, cls)
+        else
+          on_widget_destroyed(path)
+        end
+      end
+    end
+
+    # Called when a widget is created
     def on_widget_created(path, cls)
       tree = "#{NB}.widgets.tree"
       return unless @app.command(:winfo, 'exists', tree) == "1"
@@ -64,7 +77,7 @@ module Teek
       $stderr.puts "teek debugger: on_widget_created(#{path}): #{e.message}"
     end
 
-    # Called by App when a widget is destroyed
+    # Called when a widget is destroyed
     def on_widget_destroyed(path)
       tree = "#{NB}.widgets.tree"
       return unless @app.command(:winfo, 'exists', tree) == "1"
@@ -121,6 +134,7 @@ module Teek
       setup_widget_tree_tab
       setup_variables_tab
       setup_watches_tab
+      setup_profile_tab
     end
 
     # ── Widgets tab ──────────────────────────────────────────
@@ -183,9 +197,8 @@ module Teek
       path = sel
       begin
         config = @app.command(path, 'configure')
-        lines = Teek.split_list(config).map { |item|
-          parts = Teek.split_list(item)
-          next if parts.size < 5
+        lines = Teek.split_list(config, deep: 1).map { |parts|
+          next unless parts.is_a?(Array) && parts.size >= 5
           "  #{parts[0]} = #{parts[4]}"
         }.compact.join("\n")
         detail = "#{path}\n#{lines}"
@@ -264,9 +277,13 @@ module Teek
       @app.command(:bind, vars_tree, '<Double-1>', proc { |*| watch_selected_variable })
 
       refresh_variables
+
+      # Changes are pushed from C traces; only new globals need a rescan
+      @var_trace = @app.trace_vars { |changes| apply_variable_changes(changes) }
     end
 
     def refresh_variables
+      @var_trace&.rescan
       new_data = fetch_variables
       return if new_data == @var_data
 
@@ -297,26 +314,26 @@ module Teek
     def fetch_variables
       vars = {}
       names = Teek.split_list(@app.command(:info, 'globals'))
-      names.sort.each do |name|
-        is_array = @app.command(:array, 'exists', name) == "1"
-        if is_array
-          begin
-            elements = Teek.split_list(@app.command(:array, 'get', name))
-            pairs = elements.each_slice(2).to_a
-            vars[name] = { type: "array", value: "(#{pairs.size} elements)", elements: pairs }
-          rescue Teek::TclError
-            vars[name] = { type: "array", value: "(error reading)" }
-          end
-        else
-          begin
-            val = @app.command(:set, name)
-            vars[name] = { type: "scalar", value: val }
-          rescue Teek::TclError
-            vars[name] = { type: "?", value: "(error reading)" }
-          end
+      names.sort.each { |name| vars[name] = fetch_variable(name) }
+      vars
+    end
+
+    def fetch_variable(name)
+      if @app.command(:array, 'exists', name) == "1"
+        begin
+          elements = Teek.split_list(@app.command(:array, 'get', name))
+          pairs = elements.each_slice(2).to_a
+          { type: "array", value: "(#{pairs.size} elements)", elements: pairs }
+        rescue Teek::TclError
+          { type: "array", value: "(error reading)" }
+        end
+      else
+        begin
+          { type: "scalar", value: @app.command(:set, name) }
+        rescue Teek::TclError
+          { type: "?", value: "(error reading)" }
         end
       end
-      vars
     end
 
     def filter_variables
@@ -357,83 +374,68 @@ module Teek
       $stderr.puts "teek debugger: filter_variables: #{e.message}"
     end
 
-    def update_variables_incremental
+    # Trace callback: re-read just the variables that changed and update
+    # their rows in place, so selection and scroll are left alone.
+    def apply_variable_changes(changes)
       return unless @var_data
 
       vars_tree = "#{NB}.vars.tree"
       pattern = @app.command("#{NB}.vars.toolbar.search", 'get').downcase
 
-      # Build set of vars that match the current filter
-      visible = {}
-      @var_data.each do |name, info|
-        next unless pattern.empty? ||
-          name.downcase.include?(pattern) ||
-          info[:value].downcase.include?(pattern)
-        visible[name] = info
-      end
-
-      # Walk current tree items: update existing, mark deleted
-      current_ids = Teek.split_list(@app.command(vars_tree, 'children', ''))
-      in_tree = {}
-
-      current_ids.each do |item_id|
-        name = item_id.sub(/\Av:/, '')
-        in_tree[name] = item_id
-
-        if visible.key?(name)
-          info = visible[name]
-          display_val = info[:value]
-          display_val = display_val[0, 200] + "..." if display_val.size > 200
-
-          @app.command(vars_tree, 'item', item_id,
-            text: name,
-            values: Teek.make_list(display_val, info[:type]))
-
-          if info[:type] == "array" && info[:elements]
-            update_array_children(vars_tree, item_id, name, info[:elements], pattern)
-          else
-            # Remove leftover children (e.g. was array, now scalar)
-            children = Teek.split_list(@app.command(vars_tree, 'children', item_id))
-            children.each { |c| @app.command(vars_tree, 'delete', c) } unless children.empty?
-          end
+      changes.map(&:first).uniq.each do |name|
+        if @app.command(:info, 'exists', name) == "1"
+          @var_data[name] = fetch_variable(name)
         else
-          # Mark as deleted in-place
-          current_text = @app.command(vars_tree, 'item', item_id, '-text')
-          unless current_text.include?("(deleted)")
-            @app.command(vars_tree, 'item', item_id,
-              text: "(deleted) #{name}",
-              values: Teek.make_list("", ""))
-            children = Teek.split_list(@app.command(vars_tree, 'children', item_id))
-            children.each { |c| @app.command(vars_tree, 'delete', c) }
-          end
+          @var_data.delete(name)
         end
+        sync_variable_row(vars_tree, name, @var_data[name], pattern)
       end
+    rescue Teek::TclError => e
+      $stderr.puts "teek debugger: apply_variable_changes: #{e.message}"
+    end
 
-      # Append new vars not yet in tree
-      visible.each do |name, info|
-        next if in_tree.key?(name)
+    def sync_variable_row(vars_tree, name, info, pattern)
+      item_id = "v:#{name}"
+      in_tree = @app.command(vars_tree, 'exists', item_id) == "1"
+
+      if info.nil?
+        # Mark as deleted in-place
+        return unless in_tree
+        @app.command(vars_tree, 'item', item_id,
+          text: "(deleted) #{name}",
+          values: Teek.make_list("", ""))
+        children = Teek.split_list(@app.command(vars_tree, 'children', item_id))
+        children.each { |c| @app.command(vars_tree, 'delete', c) }
+        return
+      end
 
-        display_val = info[:value]
-        display_val = display_val[0, 200] + "..." if display_val.size > 200
+      unless pattern.empty? ||
+          name.downcase.include?(pattern) ||
+          info[:value].downcase.include?(pattern)
+        @app.command(vars_tree, 'delete', item_id) if in_tree
+        return
+      end
 
-        item_id = "v:#{name}"
+      display_val = info[:value]
+      display_val = display_val[0, 200] + "..." if display_val.size > 200
+
+      if in_tree
+        @app.command(vars_tree, 'item', item_id,
+          text: name,
+          values: Teek.make_list(display_val, info[:type]))
+      else
         @app.command(vars_tree, 'insert', '', 'end',
           id: item_id, text: name,
           values: Teek.make_list(display_val, info[:type]))
+      end
 
-        next unless info[:type] == "array" && info[:elements]
-        info[:elements].each do |key, val|
-          next unless pattern.empty? ||
-            key.downcase.include?(pattern) ||
-            val.downcase.include?(pattern)
-          el_val = val.size > 200 ? val[0, 200] + "..." : val
-          @app.command(vars_tree, 'insert', item_id, 'end',
-            id: "v:#{name}:#{key}", text: "#{name}(#{key})",
-            values: Teek.make_list(el_val, ''))
-        end
+      if info[:type] == "array" && info[:elements]
+        update_array_children(vars_tree, item_id, name, info[:elements], pattern)
+      else
+        # Remove leftover children (e.g. was array, now scalar)
+        children = Teek.split_list(@app.command(vars_tree, 'children', item_id))
+        children.each { |c| @app.command(vars_tree, 'delete', c) } unless children.empty?
       end
-    rescue Teek::TclError => e
-      $stderr.puts "teek debugger: update_variables_incremental: #{e.message}"
     end
 
     def update_array_children(vars_tree, parent_id, name, elements, pattern)
@@ -668,6 +670,88 @@ module Teek
       remove_watch(name)
     end
 
+    # ── Profile tab ──────────────────────────────────────────
+
+    def setup_profile_tab
+      prof_tree = "#{NB}.profile.tree"
+
+      @app.command('ttk::frame', "#{NB}.profile")
+      @app.command(NB, 'add', "#{NB}.profile", text: 'Profile')
+
+      # Toolbar: sort order + reset button
+      @app.command('ttk::frame', "#{NB}.profile.toolbar")
+      @app.command(:pack, "#{NB}.profile.toolbar", fill: :x, padx: 2, pady: 2)
+
+      @app.command('ttk::label', "#{NB}.profile.toolbar.lbl", text: 'Sort by:')
+      @app.command(:pack, "#{NB}.profile.toolbar.lbl", side: :left)
+
+      @app.command(:set, '::teek_debug_profile_by', 'total_us')
+      @app.command('ttk::combobox', "#{NB}.profile.toolbar.by",
+        textvariable: '::teek_debug_profile_by', state: :readonly, width: 10,
+        values: Teek.make_list('total_us', 'max_us', 'calls', 'errors'))
+      @app.command(:pack, "#{NB}.profile.toolbar.by", side: :left, padx: 4)
+      @app.command(:bind, "#{NB}.profile.toolbar.by", '<<ComboboxSelected>>',
+        proc { |*| refresh_profile })
+
+      reset_proc = proc { |*|
+        @app.reset_stats
+        refresh_profile
+      }
+      @app.command('ttk::button', "#{NB}.profile.toolbar.reset",
+        text: 'Reset', command: reset_proc)
+      @app.command(:pack, "#{NB}.profile.toolbar.reset", side: :right)
+
+      # Treeview: one row per callback, registration site as the name
+      @app.command('ttk::treeview', prof_tree,
+        columns: 'calls total max avg errors', show: 'tree headings', selectmode: :browse)
+      @app.command(prof_tree, 'heading', '#0', text: 'Callback')
+      @app.command(prof_tree, 'heading', 'calls', text: 'Calls')
+      @app.command(prof_tree, 'heading', 'total', text: 'Total ms')
+      @app.command(prof_tree, 'heading', 'max', text: 'Max ms')
+      @app.command(prof_tree, 'heading', 'avg', text: 'Avg ms')
+      @app.command(prof_tree, 'heading', 'errors', text: 'Errors')
+      @app.command(prof_tree, 'column', '#0', width: 150)
+      %w[calls total max avg errors].each do |col|
+        @app.command(prof_tree, 'column', col, width: 50, anchor: :e)
+      end
+
+      @app.command('ttk::scrollbar', "#{NB}.profile.vsb",
+        orient: :vertical, command: "#{prof_tree} yview")
+      @app.command(prof_tree, 'configure',
+        yscrollcommand: "#{NB}.profile.vsb set")
+
+      @app.command(:pack, "#{NB}.profile.vsb", side: :right, fill: :y)
+      @app.command(:pack, prof_tree, fill: :both, expand: 1)
+
+      # Fill in right away when the tab is opened
+      @app.command(:bind, NB, '<<NotebookTabChanged>>', proc { |*|
+        refresh_profile if profile_visible?
+      })
+    end
+
+    def profile_visible?
+      @app.command(NB, 'select') == "#{NB}.profile"
+    end
+
+    def refresh_profile
+      prof_tree = "#{NB}.profile.tree"
+      by = @app.command(:set, '::teek_debug_profile_by').to_sym
+      rows = @app.callback_top(PROFILE_ROWS, by: by)
+
+      @app.command(prof_tree, 'delete', @app.command(prof_tree, 'children', ''))
+      rows.each_with_index do |row, i|
+        ms = ->(us) { format('%.2f', us / 1000.0) }
+        # Released callbacks come summed per site, with no id
+        item = row[:id] ? "cb_#{row[:id]}" : "cb_retired_#{i}"
+        @app.command(prof_tree, 'insert', '', 'end',
+          id: item, text: row[:site] || (row[:id] ? "##{row[:id]}" : '(released)'),
+          values: Teek.make_list(row[:calls].to_s, ms.(row[:total_us]), ms.(row[:max_us]),
+                                 ms.(row[:total_us] / row[:calls]), row[:errors].to_s))
+      end
+    rescue Teek::TclError => e
+      $stderr.puts "teek debugger: refresh_profile: #{e.message}"
+    end
+
     # ── Auto-refresh ─────────────────────────────────────────
 
     def start_auto_refresh
@@ -678,31 +762,12 @@ module Teek
     end
 
     def auto_refresh_tick
-      vars_tree = "#{NB}.vars.tree"
-
-      new_data = fetch_variables
-      unless new_data == @var_data
-        # Preserve selection and scroll
-        sel = @app.command(vars_tree, 'selection') rescue ""
-        scroll = Teek.split_list(@app.command(vars_tree, 'yview')) rescue nil
-
-        @var_data = new_data
-        update_variables_incremental
-
-        # Restore selection if item still exists
-        unless sel.empty?
-          if @app.command(vars_tree, 'exists', sel) == "1"
-            @app.command(vars_tree, 'selection', 'set', sel)
-          end
-        end
-
-        # Restore scroll position
-        if scroll && scroll.size == 2
-          @app.command(vars_tree, 'yview', 'moveto', scroll[0])
-        end
-      end
+      # Existing variables report their own changes through @var_trace;
+      # new globals just need tracing (reported on the next idle)
+      @var_trace&.rescan
 
       refresh_watches
+      refresh_profile if profile_visible?
     rescue Teek::TclError => e
       $stderr.puts "teek debugger: auto-refresh error: #{e.message}"
     end
@@ -0,0 +1,203 @@
+# frozen_string_literal: true
+
+module Teek
+  # A Fiber scheduler (+Fiber.set_scheduler+) that runs non-blocking
+  # fibers on Tk's own event loop. Waiting for an IO, sleeping, or
+  # blocking on a Mutex, Queue or Thread#join suspends just the fiber:
+  # the wait is a Tcl file handler ({Interp#watch_io}) or timer
+  # ({Interp#after}), and the fiber is resumed from the event loop when
+  # it fires. UI code can read a socket or sleep in straight-line code
+  # without freezing the window and without a thread per task.
+  #
+  # Fibers resume inside the event loop, like any other callback, so they
+  # should hand back control (by waiting) rather than compute for long.
+  # An exception that escapes a fiber is reported like a callback error.
+  #
+  # Install it on the thread running the Tk event loop. At thread exit
+  # (or +Fiber.set_scheduler(nil)+) Ruby calls {#close}, which keeps
+  # running the event loop until every waiting fiber has finished, so
+  # end long-running fibers (close their streams) before then.
+  #
+  # @example Read a socket without blocking the UI
+  #   Fiber.set_scheduler(Teek::FiberScheduler.new(app))
+  #   Fiber.schedule do
+  #     sock = TCPSocket.new('example.com', 80)
+  #     sock.write("GET / HTTP/1.0\r\n\r\n")
+  #     app.command('.out', :insert, :end, sock.read)
+  #   end
+  #   app.mainloop
+  #
+  # @note Not available on Windows, where {Interp#watch_io} is not supported.
+  # @see https://docs.ruby-lang.org/en/master/Fiber/Scheduler.html Fiber::Scheduler
+  class FiberScheduler
+    # @param app [Teek::App, Teek::Interp] the interpreter whose event loop runs the fibers
+    def initialize(app)
+      @interp = app.respond_to?(:interp) ? app.interp : app
+      @thread = Thread.current
+      @waiting = {}.compare_by_identity   # fiber => token of its current wait
+      @blocked = {}.compare_by_identity   # fiber => token, for waits #unblock may end
+      @lock = Thread::Mutex.new
+      @unblocked = []                     # [fiber, token] unblocked from other threads
+      @wake_r, @wake_w = IO.pipe
+      @wake = @interp.watch_io(@wake_r) { wake_unblocked }
+      @closed = false
+    end
+
+    # @return [Integer] fibers currently suspended in a wait
+    def waiting_count
+      @waiting.size
+    end
+
+    # Start a non-blocking fiber (+Fiber.schedule+) and run it until it
+    # first waits.
+    def fiber(**kwargs, &block)
+      fiber = Fiber.new(**kwargs, blocking: false, &block)
+      fiber.resume
+      fiber
+    end
+
+    # Wait for +io+ to be ready for +events+ (+IO::READABLE+ etc.).
+    # @return [Integer, false] the ready events, or false on timeout
+    def io_wait(io, events, timeout)
+      watch = timer = nil
+      wait do |fiber, token|
+        watch = @interp.watch_io(io, events) { |_io, ready| resume(fiber, token, ready) }
+        timer = @interp.after(timeout * 1000.0) { resume(fiber, token, false) } if timeout
+      end
+    ensure
+      watch&.cancel
+      timer&.cancel
+    end
+
+    # +sleep+ (and +Mutex#sleep+) in a non-blocking fiber. The sleep also
+    # ends early on {#unblock}, which is how +ConditionVariable#signal+
+    # and +Thread#wakeup+ reach it; a bare +sleep+ with no duration
+    # ends only that way, so it is never stuck for good.
+    def kernel_sleep(duration = nil)
+      timer = nil
+      wait(blockable: true) do |fiber, token|
+        timer = @interp.after(duration * 1000.0) { resume(fiber, token, true) } if duration
+      end
+      true
+    ensure
+      timer&.cancel
+    end
+
+    # Suspend the fiber on a Mutex, Queue, Thread#join, ... until
+    # {#unblock} or the timeout.
+    # @return [Boolean] false if it timed out
+    def block(blocker, timeout = nil)
+      timer = nil
+      wait(blockable: true) do |fiber, token|
+        timer = @interp.after(timeout * 1000.0) { resume(fiber, token, false) } if timeout
+      end
+    ensure
+      timer&.cancel
+    end
+
+    # Wake a fiber suspended in {#block} or {#kernel_sleep}. Called from any thread; from
+    # another thread it wakes the event loop through a pipe. Only the
+    # wait the fiber is in now ends: if that one is over by the time the
+    # wake-up runs (it timed out meanwhile), a later wait is left alone.
+    def unblock(blocker, fiber)
+      if Thread.current == @thread
+        token = @blocked[fiber]
+        @interp.after_idle { resume_blocked(fiber, token) } if token && !@closed
+      else
+        # The fiber can be on the blocker's wait list before #block has
+        # recorded its wait; no token then means the wait it is entering
+        @lock.synchronize { @unblocked << [fiber, @blocked[fiber]] }
+        @wake_w.write_nonblock('.', exception: false)
+      end
+      nil
+    end
+
+    # Raise +exception+ in the current fiber if the block takes longer
+    # than +duration+ seconds.
+    def timeout_after(duration, exception, *args)
+      fiber = Fiber.current
+      timer = @interp.after(duration * 1000.0) do
+        fiber.raise(exception, *args) if fiber.alive?
+      end
+      yield duration
+    ensure
+      timer&.cancel
+    end
+
+    # Wait for a child process on a helper thread; the fiber blocks on
+    # its join like on any other Thread.
+    def process_wait(pid, flags)
+      Thread.new { Process::Status.wait(pid, flags) }.value
+    end
+
+    # Run the event loop until every waiting fiber has finished, then
+    # release the scheduler's pipe. Called by Ruby at thread exit.
+    # @return [void]
+    def close
+      return if @closed
+      run
+      @closed = true
+      @wake.cancel
+      @wake_r.close
+      @wake_w.close
+    end
+
+    # @return [Boolean]
+    def closed?
+      @closed
+    end
+
+    # Process events until no fiber is waiting (or the interpreter is gone).
+    # @return [void]
+    def run
+      flags = Teek::ALL_EVENTS
+      # The timer-mode loop holds the GVL while it waits, so poll there
+      # to let other threads reach #unblock
+      flags |= Teek::DONT_WAIT unless @interp.mainloop_mode == :event
+      until @waiting.empty? || @interp.deleted?
+        next if @interp.do_one_event(flags)
+        IO.select([@wake_r], nil, nil, [@interp.thread_timer_ms, 1].max / 1000.0) if flags & Teek::DONT_WAIT != 0
+      end
+    end
+
+    private
+
+    # Suspend the current fiber until resume(fiber, token, value)
+    def wait(blockable: false)
+      fiber = Fiber.current
+      token = Object.new
+      @waiting[fiber] = token
+      @blocked[fiber] = token if blockable
+      yield fiber, token
+      Fiber.yield
+    ensure
+      if fiber && @waiting[fiber].equal?(token)
+        @waiting.delete(fiber)
+        @blocked.delete(fiber)
+      end
+    end
+
+    # Resume fiber with value if it is still in the wait token belongs to
+    def resume(fiber, token, value)
+      return unless @waiting[fiber].equal?(token)
+      @waiting.delete(fiber)
+      @blocked.delete(fiber)
+      fiber.resume(value)
+    end
+
+    def resume_blocked(fiber, token)
+      resume(fiber, token, true) if @blocked[fiber].equal?(token)
+    end
+
+    # Each fiber resumes from its own idle callback, so one that raises
+    # doesn't take the wake watch down with it
+    def wake_unblocked
+      nil while @wake_r.read_nonblock(256, exception: false).is_a?(String)
+      waits = @lock.synchronize { @unblocked.slice!(0..) }
+      waits.each do |fiber, token|
+        token ||= @blocked[fiber]
+        @interp.after_idle { resume_blocked(fiber, token) } if token
+      end
+    end
+  end
+end
@@ -73,11 +73,13 @@ module Teek
     # Bind an event on this widget.
     # @param event [String] Tk event name
     # @param subs [Array<Symbol, String>] substitution codes
+    # @param types [:auto, Array<Symbol>, nil] argument conversions (see {App#bind})
+    # @param coalesce [:latest, :per_frame, nil] merge event bursts (see {App#bind})
     # @yield called when the event fires
     # @return [void]
     # @see App#bind
-    def bind(event, *subs, &block)
-      @app.bind(@path, event, *subs, &block)
+    def bind(event, *subs, types: nil, coalesce: nil, &block)
+      @app.bind(@path, event, *subs, types: types, coalesce: coalesce, &block)
     end
 
     # Remove an event binding from this widget.
@@ -72,4 +72,73 @@ class TestAfter < Minitest::Test
       assert_equal ["first", "second"], results
     end
   end
+
+  def test_after_returns_timer
+    assert_tk_app("after should return a Teek::Timer") do
+      fired = 0
+      timer = app.after(20) { fired += 1 }
+      assert_kind_of Teek::Timer, timer
+      assert timer.active?
+      refute timer.repeat?
+
+      deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+      until fired > 0 || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+        app.update
+        sleep 0.01
+      end
+
+      assert_equal 1, fired
+      refute timer.active?
+      assert_equal 1, timer.ticks
+      assert_nil timer.callback_id, "one-shot timer should release its callback"
+      timer.cancel # no-op once fired
+    end
+  end
+
+  def test_after_cancel_tcl_after_id
+    assert_tk_app("after_cancel should still accept Tcl after ids") do
+      id = app.tcl_eval('after 5000 {set ::teek_after_fired 1}')
+      app.after_cancel(id)
+      refute_includes app.tcl_eval('after info').split, id
+    end
+  end
+
+  def test_interp_after_repeat
+    assert_tk_app("Interp#after repeat: should tick until cancelled") do
+      ticks = 0
+      timer = app.interp.after(10, repeat: true) { ticks += 1 }
+      assert timer.repeat?
+      assert_equal 10, timer.interval
+
+      deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+      until ticks >= 3 || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+        app.update
+        sleep 0.005
+      end
+      timer.cancel
+      seen = ticks
+      20.times { app.update; sleep 0.005 }
+
+      assert seen >= 3, "expected at least 3 ticks, got #{seen}"
+      assert_equal seen, ticks, "timer ticked after cancel"
+      assert timer.cancelled?
+      assert_raises(ArgumentError) { app.interp.after(0, repeat: true) { } }
+    end
+  end
+
+  def test_dropped_timers_still_fire
+    assert_tk_app("timers should fire even if the Timer is not kept") do
+      fired = 0
+      50.times { app.after(1) { fired += 1 } }
+      GC.start
+
+      deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+      until fired == 50 || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+        app.update
+        sleep 0.005
+      end
+
+      assert_equal 50, fired
+    end
+  end
 end
@@ -0,0 +1,71 @@
+# frozen_string_literal: true
+
+# Tests for App#batch / Interp#batch - many commands in one Ruby->Tcl crossing.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestBatch < Minitest::Test
+  include TeekTestHelper
+
+  def test_batch_returns_results_in_order
+    assert_tk_app("batch should return each command's result") do
+      results = app.batch do |b|
+        b.invoke('set', 'batch_a', 'one')
+        b.command(:expr, 6, '*', 7)
+        b.invoke('list', nil, 'x y')
+      end
+      assert_equal ["one", "42", "{} {x y}"], results
+    end
+  end
+
+  def test_batch_without_results_returns_count
+    assert_tk_app("batch(results: false) should return the command count") do
+      app.command('canvas', '.c')
+      count = app.batch(results: false) do |b|
+        500.times { |i| b.command('.c', :create, :rectangle, i, i, i + 1, i + 1) }
+      end
+      assert_equal 500, count
+      assert_equal 500, app.split_list(app.command('.c', :find, :all)).size
+    end
+  end
+
+  def test_batch_stops_at_first_error
+    assert_tk_app("batch should stop at the first failing command") do
+      err = assert_raises(Teek::BatchError) do
+        app.batch do |b|
+          b.invoke('set', 'batch_q', '1')
+          b.invoke('no_such_command_xyz')
+          b.invoke('set', 'batch_q', '2')
+        end
+      end
+      assert_kind_of Teek::TclError, err
+      assert_equal 1, err.index
+      assert_equal ["1"], err.results
+      assert_equal "1", app.tcl_get_var('batch_q')
+    end
+  end
+
+  def test_batch_closed_after_block
+    assert_tk_app("recording into a finished batch should raise") do
+      saved = nil
+      assert_equal [], app.batch { |b| saved = b }
+      assert_raises(Teek::TclError) { saved.invoke('set', 'x', '1') }
+    end
+  end
+
+  def test_batch_from_background_thread
+    assert_tk_app("batch from a background thread should run on the main thread") do
+      result = nil
+      t = Thread.new do
+        result = app.batch do |b|
+          b.invoke('set', 'batch_bg', 'bg')
+          b.command(:expr, 1, '+', 1)
+        end
+      end
+      app.update until !t.alive?
+      t.join
+      assert_equal ["bg", "2"], result
+    end
+  end
+end
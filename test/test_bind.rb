@@ -66,6 +66,42 @@ class TestBind < Minitest::Test
     end
   end
 
+  def test_bind_with_auto_types
+    assert_tk_app("bind types: :auto should deliver Integer coordinates") do
+      got = nil
+
+      app.show
+      app.tcl_eval("frame .f -width 100 -height 100")
+      app.tcl_eval("pack .f")
+      app.update
+
+      app.bind('.f', 'Button-1', :x, :y, :widget, types: :auto) { |*args| got = args }
+
+      app.tcl_eval("event generate .f <Button-1> -x 42 -y 17")
+      app.update
+
+      assert_equal [42, 17, ".f"], got
+    end
+  end
+
+  def test_bind_with_explicit_types
+    assert_tk_app("bind with explicit types should convert by position") do
+      got = nil
+
+      app.show
+      app.tcl_eval("frame .f -width 100 -height 100")
+      app.tcl_eval("pack .f")
+      app.update
+
+      app.bind('.f', 'Button-1', :x, :y, types: [:float, :str]) { |*args| got = args }
+
+      app.tcl_eval("event generate .f <Button-1> -x 5 -y 6")
+      app.update
+
+      assert_equal [5.0, "6"], got
+    end
+  end
+
   def test_bind_with_raw_sub
     assert_tk_app("bind with raw %W should forward widget path") do
       got_widget = nil
@@ -211,4 +247,57 @@ class TestBind < Minitest::Test
       assert_equal 1, count, "binding still fired after unbind"
     end
   end
+
+  def test_bind_coalesce_latest
+    assert_tk_app("coalesce: :latest should deliver the newest values once per idle") do
+      got = []
+
+      app.show
+      app.tcl_eval("frame .fc -width 100 -height 100")
+      app.tcl_eval("pack .fc")
+      app.update
+
+      app.bind('.fc', 'Motion', :x, :y, types: :auto, coalesce: :latest) { |*args| got << args }
+
+      app.reset_stats
+      10.times { |i| app.tcl_eval("event generate .fc <Motion> -x #{i} -y #{i * 2}") }
+      assert_empty got, "delivered before idle"
+      app.update
+
+      assert_equal [[9, 18, 10]], got
+      assert_equal 10, app.stats[:coalesced_events]
+      assert_equal 1, app.stats[:coalesced_calls]
+    end
+  end
+
+  def test_bind_coalesce_per_frame
+    assert_tk_app("coalesce: :per_frame should deliver before the next run_frames block") do
+      got = []
+      seen = nil
+
+      app.show
+      app.tcl_eval("frame .ff -width 100 -height 100")
+      app.tcl_eval("pack .ff")
+      app.update
+
+      app.bind('.ff', 'Configure', :width, types: :auto, coalesce: :per_frame) { |*args| got << args }
+
+      app.run_frames(fps: 100, frames: 2) do |t|
+        if t.frame == 0
+          got.clear
+          5.times { |i| app.tcl_eval("event generate .ff <Configure> -width #{10 + i}") }
+        else
+          seen = got.dup
+        end
+      end
+
+      assert_equal [[14, 5]], seen
+    end
+  end
+
+  def test_bind_coalesce_invalid_mode
+    assert_tk_app("bind should reject an unknown coalesce: mode") do
+      assert_raises(ArgumentError) { app.bind('.', 'Motion', coalesce: :sometimes) { } }
+    end
+  end
 end
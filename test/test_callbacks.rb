@@ -0,0 +1,206 @@
+# frozen_string_literal: true
+
+# Tests for the callback table behind register_callback / ruby_callback.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestCallbacks < Minitest::Test
+  include TeekTestHelper
+
+  def test_register_returns_integer_id
+    assert_tk_app("register_callback should return an Integer id") do
+      id = app.register_callback(proc { |a, b| "#{a}-#{b}" })
+      assert_kind_of Integer, id
+      assert_equal "x-y", app.tcl_eval("ruby_callback #{id} x y")
+    end
+  end
+
+  def test_unregistered_id_is_unknown
+    assert_tk_app("an unregistered id should not dispatch") do
+      id = app.register_callback(proc { "hit" })
+      app.unregister_callback(id)
+      err = assert_raises(Teek::TclError) { app.tcl_eval("ruby_callback #{id}") }
+      assert_match(/unknown callback id/, err.message)
+    end
+  end
+
+  def test_stale_id_does_not_reach_reused_slot
+    assert_tk_app("a reused slot should reject the previous owner's id") do
+      old_id = app.register_callback(proc { "old" })
+      app.unregister_callback(old_id)
+      new_id = app.register_callback(proc { "new" })
+
+      refute_equal old_id, new_id
+      assert_equal "new", app.tcl_eval("ruby_callback #{new_id}")
+      assert_raises(Teek::TclError) { app.tcl_eval("ruby_callback #{old_id}") }
+    end
+  end
+
+  def test_unregister_unknown_id_is_noop
+    assert_tk_app("unregistering an unknown id should be ignored") do
+      app.unregister_callback(987_654)
+      app.unregister_callback("not-an-id")
+    end
+  end
+
+  def test_typed_arguments_convert_in_c
+    assert_tk_app("types: should convert callback args by position") do
+      got = nil
+      id = app.register_callback(proc { |*a| got = a }, types: [:int, :float, :bool])
+      app.tcl_eval("ruby_callback #{id} 42 1.5 yes extra")
+      assert_equal [42, 1.5, true, "extra"], got
+    end
+  end
+
+  def test_typed_argument_that_does_not_parse_stays_string
+    assert_tk_app("unparseable typed args should fall back to String") do
+      got = nil
+      id = app.register_callback(proc { |*a| got = a }, types: [:int])
+      app.tcl_eval("ruby_callback #{id} ??")
+      assert_equal ["??"], got
+    end
+  end
+
+  def test_unknown_type_raises
+    assert_tk_app("an unknown callback type should raise ArgumentError") do
+      assert_raises(ArgumentError) { app.register_callback(proc {}, types: [:nope]) }
+    end
+  end
+
+  # -- Widget-owned callbacks ----------------------------------------------
+
+  def test_same_proc_keeps_one_id
+    assert_tk_app("passing the same Proc twice should reuse its callback") do
+      handler = proc { }
+      before = app.callback_counts
+      app.command(:button, '.cb_same1', command: handler)
+      app.command(:button, '.cb_same2', command: handler)
+      after = app.callback_counts
+
+      assert_equal app.command('.cb_same1', :cget, '-command'),
+                   app.command('.cb_same2', :cget, '-command')
+      assert_equal before[:registered] + 1, after[:registered]
+      assert_equal before[:reused] + 1, after[:reused]
+      app.destroy('.cb_same1')
+      app.destroy('.cb_same2')
+    end
+  end
+
+  def test_destroy_frees_widget_callbacks
+    assert_tk_app("destroying a widget should free the callbacks it holds") do
+      app.update
+      base, owned = app.callback_counts.values_at(:live, :owned)
+      20.times do |i|
+        app.command(:button, ".cb_free#{i}", command: proc { })
+        app.bind(".cb_free#{i}", 'Enter') { }
+      end
+      assert_equal base + 40, app.callback_counts[:live]
+
+      20.times { |i| app.destroy(".cb_free#{i}") }
+      app.update
+      assert_equal [base, owned], app.callback_counts.values_at(:live, :owned)
+    end
+  end
+
+  def test_configure_replaces_previous_command
+    assert_tk_app("configure -command should release the Proc it replaces") do
+      hits = []
+      app.command(:button, '.cb_conf', command: proc { hits << 0 })
+      live = app.callback_counts[:live]
+      50.times { |i| app.command('.cb_conf', :configure, '-command', proc { hits << i + 1 }) }
+      app.command('.cb_conf', :configure, command: proc { hits << :kw })
+
+      assert_equal live, app.callback_counts[:live]
+      app.command('.cb_conf', :invoke)
+      assert_equal [:kw], hits
+      app.destroy('.cb_conf')
+    end
+  end
+
+  def test_rebind_replaces_and_unbind_frees
+    assert_tk_app("bind again should release the old block, unbind the current one") do
+      app.command(:frame, '.cb_bind')
+      app.bind('.cb_bind', 'Enter') { }
+      live = app.callback_counts[:live]
+      10.times { app.bind('.cb_bind', 'Enter') { } }
+      assert_equal live, app.callback_counts[:live]
+
+      app.unbind('.cb_bind', 'Enter')
+      assert_equal live - 1, app.callback_counts[:live]
+      app.destroy('.cb_bind')
+    end
+  end
+
+  def test_item_bindings_replace_per_tag
+    assert_tk_app("item binds and entryconfigure should release what they replace") do
+      app.command(:canvas, '.cb_items')
+      app.command(:text, '.cb_text')
+      app.command(:menu, '.cb_menu')
+      app.command('.cb_menu', :add, :command, label: 'A')
+      app.command('.cb_items', :bind, 'a', '<1>', proc { })
+      app.command('.cb_items', :bind, 'b', '<1>', proc { })
+      app.command('.cb_text', :tag, :bind, 'a', '<1>', proc { })
+      app.command('.cb_menu', :entryconfigure, 0, command: proc { })
+      live = app.callback_counts[:live]
+
+      10.times do
+        app.command('.cb_items', :bind, 'a', '<1>', proc { })
+        app.command('.cb_text', :tag, :bind, 'a', '<1>', proc { })
+        app.command('.cb_menu', :entryconfigure, 0, command: proc { })
+      end
+      assert_equal live, app.callback_counts[:live]
+
+      # Another tag's binding is still held
+      app.command('.cb_items', :bind, 'c', '<1>', proc { })
+      assert_equal live + 1, app.callback_counts[:live]
+      %w[.cb_items .cb_text .cb_menu].each { |w| app.destroy(w) }
+    end
+  end
+
+  def test_destroy_binding_still_runs
+    assert_tk_app("a <Destroy> binding should run before its callback is freed") do
+      fired = false
+      app.command(:frame, '.cb_destroy')
+      app.bind('.cb_destroy', 'Destroy') { fired = true }
+      app.destroy('.cb_destroy')
+      app.update
+      assert fired
+    end
+  end
+
+  def test_shared_proc_outlives_one_owner
+    assert_tk_app("a Proc held by two widgets should survive one of them") do
+      hits = 0
+      handler = proc { hits += 1 }
+      app.command(:button, '.cb_share1', command: handler)
+      app.command(:button, '.cb_share2', command: handler)
+      app.destroy('.cb_share1')
+      app.update
+      app.command('.cb_share2', :invoke)
+      assert_equal 1, hits
+      app.destroy('.cb_share2')
+    end
+  end
+
+  def test_unowned_proc_is_kept
+    assert_tk_app("a Proc given to a command that names no widget should stay registered") do
+      hits = 0
+      handler = proc { hits += 1 }
+      app.command(:set, '::cb_unowned', handler)
+      app.command(:button, '.cb_unowned', command: handler)
+      app.destroy('.cb_unowned')
+      app.update
+      app.tcl_eval('eval $::cb_unowned')
+      assert_equal 1, hits
+    end
+  end
+
+  def test_failed_command_frees_its_callbacks
+    assert_tk_app("a command that fails should not leak the Procs it converted") do
+      live = app.callback_counts[:live]
+      assert_raises(Teek::TclError) { app.command(:button, '.cb_fail', command: proc { }, bogus: 1) }
+      assert_equal live, app.callback_counts[:live]
+    end
+  end
+end
@@ -0,0 +1,77 @@
+# frozen_string_literal: true
+
+# Tests for App#command / Interp#command - native Ruby -> Tcl_Obj marshalling.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestCommand < Minitest::Test
+  include TeekTestHelper
+
+  def test_numeric_args_keep_numeric_rep
+    assert_tk_app("command should pass Integer and Float natively") do
+      assert_equal "42", app.command(:expr, 40, '+', 2)
+      assert_equal "1", app.command(:string, :is, :double, 1.5)
+      assert_equal "2.5", app.command(:expr, 1.25, '*', 2)
+    end
+  end
+
+  def test_strings_are_not_reparsed
+    assert_tk_app("command should not re-parse string args") do
+      app.command(:set, 'v', 'a {b $c [d]')
+      assert_equal 'a {b $c [d]', app.tcl_get_var('v')
+
+      app.command(:set, 'v', 'unbalanced {')
+      assert_equal 'unbalanced {', app.tcl_get_var('v')
+    end
+  end
+
+  def test_array_becomes_list
+    assert_tk_app("command should convert Arrays to Tcl lists") do
+      assert_equal "3", app.command(:llength, ['a', 'b c', 1])
+      assert_equal "b c", app.command(:lindex, ['a', 'b c', 1], 1)
+      assert_equal "y", app.command(:lindex, [['x', 'y'], 'z'], 0, 1)
+    end
+  end
+
+  def test_symbol_and_nil
+    assert_tk_app("command should pass Symbols bare and nil as empty") do
+      assert_equal "left", app.command(:set, 'v', :left)
+      assert_equal "", app.command(:set, 'v', nil)
+    end
+  end
+
+  def test_kwargs_become_options
+    assert_tk_app("command should map kwargs to -key value pairs") do
+      app.command('ttk::label', '.l', text: 'hello world', padding: [1, 2])
+      assert_equal "hello world", app.command('.l', :cget, '-text')
+      assert_equal "1 2", app.command('.l', :cget, '-padding')
+    end
+  end
+
+  def test_proc_with_substitutions
+    assert_tk_app("command should register Procs with trailing % subs") do
+      received = nil
+      cb = proc { |a, b| received = [a, b] }
+      app.command(:bind, '.', '<<Ping>>', cb, '%x', '%y')
+      app.command(:event, :generate, '.', '<<Ping>>', x: 5, y: 6)
+      assert_equal ["5", "6"], received
+    end
+  end
+
+  def test_error_raises_tcl_error
+    assert_tk_app("command should raise TclError on failure") do
+      assert_raises(Teek::TclError) { app.command(:no_such_command_xyz) }
+    end
+  end
+
+  def test_from_background_thread
+    assert_tk_app("command should be safe to call from a background thread") do
+      result = nil
+      t = Thread.new { result = app.command(:expr, 6, '*', 7) }
+      app.update until !t.alive?
+      t.join
+      assert_equal "42", result
+    end
+  end
+end
@@ -271,4 +271,47 @@ class TestDebugger < Minitest::Test
       assert_equal 'updated', result
     end
   end
+
+  def test_debugger_variables_follow_traces
+    assert_tk_app("variables tab updates from traces without a full refresh") do
+      app = Teek::App.new(debug: true)
+      app.tcl_eval('array set ::tracedarr {a 1}')
+      app.tcl_eval('.teek_debug.nb.vars.toolbar.refresh invoke')
+      app.update
+
+      vars_tree = '.teek_debug.nb.vars.tree'
+      assert_equal "1", app.tcl_eval("#{vars_tree} exists v:tracedarr:a")
+
+      app.tcl_eval('set ::tracedarr(b) 2; set ::tracedarr(a) changed')
+      app.update
+      assert_equal "1", app.tcl_eval("#{vars_tree} exists v:tracedarr:b")
+      assert_equal 'changed',
+        Teek.split_list(app.tcl_eval("#{vars_tree} item v:tracedarr:a -values"))[0]
+
+      app.tcl_eval('unset ::tracedarr')
+      app.update
+      assert_match(/\(deleted\)/, app.tcl_eval("#{vars_tree} item v:tracedarr -text"))
+    end
+  end
+
+  def test_debugger_profile_tab
+    assert_tk_app("profile tab lists callbacks") do
+      app = Teek::App.new(debug: true)
+      app.reset_stats
+      id = app.register_callback(proc { })
+      3.times { app.tcl_eval("ruby_callback #{id}") }
+
+      app.tcl_eval('.teek_debug.nb select .teek_debug.nb.profile')
+      app.update
+
+      prof_tree = '.teek_debug.nb.profile.tree'
+      assert_equal "1", app.tcl_eval("#{prof_tree} exists cb_#{id}")
+      values = Teek.split_list(app.tcl_eval("#{prof_tree} item cb_#{id} -values"))
+      assert_equal '3', values[0]
+
+      app.tcl_eval('.teek_debug.nb.profile.toolbar.reset invoke')
+      app.update
+      assert_equal "0", app.tcl_eval("#{prof_tree} exists cb_#{id}")
+    end
+  end
 end
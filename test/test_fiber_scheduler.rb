@@ -0,0 +1,133 @@
+# frozen_string_literal: true
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestFiberScheduler < Minitest::Test
+  include TeekTestHelper
+
+  def setup
+    skip "FiberScheduler needs Tcl file handlers (not on Windows)" if Gem.win_platform?
+  end
+
+  def test_sleep_runs_on_event_loop
+    assert_tk_app("sleep in a scheduled fiber should not block Tk") do
+      scheduler = Teek::FiberScheduler.new(app)
+      Fiber.set_scheduler(scheduler)
+      begin
+        log = []
+        app.after(20) { log << :timer }
+        Fiber.schedule { sleep 0.1; log << :slept }
+        assert_equal 1, scheduler.waiting_count
+        assert_empty log, "sleep should suspend only the fiber"
+      ensure
+        Fiber.set_scheduler(nil)
+      end
+
+      assert scheduler.closed?
+      assert_equal [:timer, :slept], log
+    end
+  end
+
+  def test_io_wait_resumes_when_readable
+    assert_tk_app("a fiber reading a pipe should resume when data arrives") do
+      r, w = IO.pipe
+      Fiber.set_scheduler(Teek::FiberScheduler.new(app))
+      begin
+        got = nil
+        Fiber.schedule { got = r.readpartial(100) }
+        app.update
+        assert_nil got
+
+        Fiber.schedule { sleep 0.02; w.write "data" }
+      ensure
+        Fiber.set_scheduler(nil)
+        r.close
+        w.close
+      end
+
+      assert_equal "data", got
+    end
+  end
+
+  def test_unblock_from_another_thread
+    assert_tk_app("Queue#pop should resume when another thread pushes") do
+      Fiber.set_scheduler(Teek::FiberScheduler.new(app))
+      begin
+        results = []
+        queue = Thread::Queue.new
+        Fiber.schedule { results << queue.pop }
+        Fiber.schedule { results << Thread.new { sleep 0.02; :joined }.value }
+        Thread.new { sleep 0.05; queue << :pushed }
+      ensure
+        Fiber.set_scheduler(nil)
+      end
+
+      assert_equal [:joined, :pushed], results
+    end
+  end
+
+  def test_bare_sleep_wakes_on_unblock
+    assert_tk_app("sleep with no duration should end on unblock (ConditionVariable#signal)") do
+      scheduler = Teek::FiberScheduler.new(app)
+      Fiber.set_scheduler(scheduler)
+      begin
+        log = []
+        mutex = Thread::Mutex.new
+        cond = Thread::ConditionVariable.new
+        ready = false
+        Fiber.schedule { mutex.synchronize { cond.wait(mutex) until ready; log << :signalled } }
+        Fiber.schedule { sleep 0.02; mutex.synchronize { ready = true; cond.signal } }
+        sleeper = Fiber.schedule { sleep; log << :woken }
+        Thread.new { sleep 0.05; scheduler.unblock(nil, sleeper) }
+      ensure
+        Fiber.set_scheduler(nil)
+      end
+
+      assert_equal [:signalled, :woken], log
+    end
+  end
+
+  def test_late_unblock_leaves_next_wait_alone
+    assert_tk_app("an unblock for a wait that ended should not end the next one") do
+      scheduler = Teek::FiberScheduler.new(app)
+      Fiber.set_scheduler(scheduler)
+      begin
+        sleeper = nil
+        elapsed = nil
+        # Fires just before the first sleep's own timer, in the same pass
+        app.after(10) { scheduler.unblock(nil, sleeper) }
+        sleeper = Fiber.schedule do
+          sleep 0.01
+          start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+          sleep 0.2
+          elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+        end
+      ensure
+        Fiber.set_scheduler(nil)
+      end
+
+      assert_operator elapsed, :>=, 0.15
+    end
+  end
+
+  def test_timeout_after
+    assert_tk_app("Timeout.timeout should interrupt a waiting fiber") do
+      require 'timeout'
+      Fiber.set_scheduler(Teek::FiberScheduler.new(app))
+      begin
+        outcome = nil
+        Fiber.schedule do
+          Timeout.timeout(0.05) { sleep 5 }
+          outcome = :finished
+        rescue Timeout::Error
+          outcome = :timed_out
+        end
+      ensure
+        Fiber.set_scheduler(nil)
+      end
+
+      assert_equal :timed_out, outcome
+    end
+  end
+end
@@ -0,0 +1,77 @@
+# frozen_string_literal: true
+
+# Tests for App#run_frames / Interp#run_frames - frame-paced loop driver.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestFrames < Minitest::Test
+  include TeekTestHelper
+
+  def test_runs_requested_number_of_frames
+    assert_tk_app("run_frames should yield FrameTiming once per frame") do
+      timings = []
+      count = app.run_frames(fps: 100, frames: 5) { |t| timings << t }
+
+      assert_equal 5, count
+      assert_equal [0, 1, 2, 3, 4], timings.map(&:frame)
+      assert_kind_of Teek::FrameTiming, timings.first
+      assert_equal 0.0, timings.first.dt
+      timings.drop(1).each do |t|
+        assert_in_delta 0.01, t.dt, 0.008
+        assert_operator t.event_ms, :>=, 0
+        assert_operator t.render_ms, :>=, 0
+      end
+    end
+  end
+
+  def test_processes_tk_events_between_frames
+    assert_tk_app("run_frames should dispatch Tk events and callbacks") do
+      fired = 0
+      app.after(0) { fired += 1 }
+      app.run_frames(fps: 100, frames: 3) { }
+      assert_equal 1, fired
+    end
+  end
+
+  def test_break_stops_loop
+    assert_tk_app("breaking out of the block should end run_frames") do
+      result = app.run_frames(fps: 200) { |t| break :done if t.frame == 2 }
+      assert_equal :done, result
+      # The interp is usable again afterwards
+      assert_equal 1, app.run_frames(frames: 1) { }
+    end
+  end
+
+  def test_slow_frame_reports_late
+    assert_tk_app("a frame that overruns should be reported as late") do
+      timings = []
+      app.run_frames(fps: 200, frames: 3) do |t|
+        timings << t
+        sleep 0.02 if t.frame == 0
+      end
+      assert timings[1].late
+      assert_operator timings[1].slack_ms, :<, 0
+      assert_operator timings[1].render_ms, :>=, 15
+    end
+  end
+
+  def test_zero_event_budget_still_processes_events
+    assert_tk_app("event_budget_ms: 0 should still handle one event per frame") do
+      fired = false
+      app.after(0) { fired = true }
+      app.run_frames(fps: 100, frames: 5, event_budget_ms: 0) { }
+      assert fired
+    end
+  end
+
+  def test_invalid_arguments
+    assert_tk_app("run_frames should validate fps and nesting") do
+      assert_raises(ArgumentError) { app.run_frames(fps: 0) { } }
+      assert_raises(ArgumentError) { app.run_frames(event_budget_ms: -1) { } }
+      assert_raises(Teek::TclError) do
+        app.interp.run_frames(frames: 1) { app.interp.run_frames { } }
+      end
+    end
+  end
+end
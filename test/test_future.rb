@@ -0,0 +1,79 @@
+# frozen_string_literal: true
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestFuture < Minitest::Test
+  include TeekTestHelper
+
+  def test_async_on_main_thread_is_already_done
+    assert_tk_app("tcl_eval_async on the main thread should settle immediately") do
+      f = app.tcl_eval_async("expr {6 * 7}", result: :int)
+      assert f.done?
+      assert_equal 42, f.value
+      assert_same f, f.wait(0)
+    end
+  end
+
+  def test_async_error_raised_from_value
+    assert_tk_app("a failed async call should raise from #value") do
+      f = app.tcl_invoke_async("error", "async boom")
+      assert f.done?
+      err = assert_raises(Teek::TclError) { f.value }
+      assert_equal "async boom", err.message
+    end
+  end
+
+  def test_pipelined_calls_from_background_thread
+    assert_tk_app("background thread should pipeline async calls") do
+      t = Thread.new do
+        futures = 50.times.map { |j| app.tcl_invoke_async("set", "::fut#{j}", j.to_s) }
+        20.times { |j| app.tcl_eval_nowait("set ::nw#{j} #{j}") }
+        sum = app.tcl_eval_async("expr {$::fut49 + $::nw19}", result: :int)
+        [futures.map(&:value), sum.value]
+      end
+
+      start = Time.now
+      while t.alive? && Time.now - start < 5
+        app.update
+        Thread.pass
+      end
+
+      values, sum = t.value
+      assert_equal 50.times.map(&:to_s), values
+      assert_equal 68, sum
+    end
+  end
+
+  def test_then_runs_with_result
+    assert_tk_app("Future#then should chain on the result") do
+      t = Thread.new do
+        doubled = app.tcl_eval_async("expr {20 + 1}", result: :int).then { |v| v * 2 }
+        failed = app.tcl_eval_async("error nope").then { |v| flunk "ran after error" }
+        [doubled.value, (failed.value rescue $!.message)]
+      end
+
+      start = Time.now
+      while t.alive? && Time.now - start < 5
+        app.update
+        Thread.pass
+      end
+
+      assert_equal [42, "nope"], t.value
+    end
+  end
+
+  def test_wait_times_out
+    assert_tk_app("Future#wait should return nil on timeout") do
+      t = Thread.new do
+        f = app.tcl_eval_async("set ::late 1")
+        [f.wait(0.05), f]
+      end
+      result, future = t.value  # main thread isn't pumping events meanwhile
+
+      assert_nil result
+      refute future.done?
+      assert_equal "1", future.value  # drains the queue on the main thread
+    end
+  end
+end
@@ -1,6 +1,6 @@
 # frozen_string_literal: true
 
-# Tests for Teek.split_list and Teek.make_list module functions.
+# Tests for Teek.split_list, Teek.split_dict and Teek.make_list module functions.
 # These are pure Tcl list ops with no Tk/interpreter dependency.
 
 require 'minitest/autorun'
@@ -31,6 +31,46 @@ class TestListOps < Minitest::Test
     assert_raises(Teek::TclError) { Teek.split_list('{"unclosed') }
   end
 
+  def test_split_list_deep
+    assert_equal ["a", ["b", "c"], ["d", "{e f} g"]],
+                 Teek.split_list('a {b c} {d {{e f} g}}', deep: 1)
+    assert_equal ["a", ["b", "c"], ["d", ["e f", "g"]]],
+                 Teek.split_list('a {b c} {d {{e f} g}}', deep: 2)
+    assert_equal ["a", ["b", "c"], ["d", [["e", "f"], "g"]]],
+                 Teek.split_list('a {b c} {d {{e f} g}}', deep: true)
+    assert_equal ["a", "b c"], Teek.split_list('a {b c}', deep: false)
+  end
+
+  def test_split_list_deep_leaves
+    # Empty elements stay "", single words stay Strings
+    assert_equal ["", "x", ["y"]], Teek.split_list('{} x {{y}}', deep: true)
+    assert_raises(ArgumentError) { Teek.split_list('a', deep: -1) }
+  end
+
+  def test_split_list_tclobj_numeric_reps
+    obj = Teek::TclObj.new([1, 2.5, 'three', [4, 'five']])
+    assert_equal [1, 2.5, 'three', '4 five'], Teek.split_list(obj)
+    assert_equal [1, 2.5, 'three', [4, 'five']], Teek.split_list(obj, deep: true)
+  end
+
+  # -- Teek.split_dict ---------------------------------------------------
+
+  def test_split_dict_basic
+    assert_equal({ '-family' => 'Helvetica', '-size' => '12', '-weight' => 'bold' },
+                 Teek.split_dict('-family Helvetica -size 12 -weight bold'))
+  end
+
+  def test_split_dict_deep_values
+    assert_equal({ 'pos' => %w[10 20], 'name' => 'x' },
+                 Teek.split_dict('pos {10 20} name x', deep: true))
+  end
+
+  def test_split_dict_empty_and_invalid
+    assert_equal({}, Teek.split_dict(''))
+    assert_equal({}, Teek.split_dict(nil))
+    assert_raises(Teek::TclError) { Teek.split_dict('a b c') }
+  end
+
   # -- Teek.make_list ----------------------------------------------------
 
   def test_make_list_basic
@@ -49,20 +89,44 @@ class TestListOps < Minitest::Test
   # -- make_list edge cases (crash resistance) ---------------------------
 
   def test_make_list_nil_arg
-    assert_raises(TypeError) { Teek.make_list(nil) }
+    assert_equal [""], Teek.split_list(Teek.make_list(nil))
   end
 
   def test_make_list_integer_arg
-    assert_raises(TypeError) { Teek.make_list(42) }
+    assert_equal "42 -7 12345678901234567890", Teek.make_list(42, -7, 12345678901234567890)
+  end
+
+  def test_make_list_float_arg
+    assert_equal "1.5 0.1", Teek.make_list(1.5, 0.1)
   end
 
   def test_make_list_symbol_arg
-    assert_raises(TypeError) { Teek.make_list(:foo) }
+    assert_equal "foo", Teek.make_list(:foo)
+  end
+
+  def test_make_list_nested_arrays
+    assert_equal "a {b {c d}} {}", Teek.make_list("a", ["b", %w[c d]], [])
+    assert_equal ["a", ["b", ["c", "d"]], ""],
+                 Teek.split_list(Teek.make_list("a", ["b", %w[c d]], []), deep: true)
+  end
+
+  def test_make_list_braces_in_nested_elements
+    list = Teek.make_list(["{", "a}b", "c d"])
+    assert_equal [["{", "a}b", "c d"]], Teek.split_list(list, deep: 1)
+  end
+
+  def test_make_list_tclobj_result
+    obj = Teek.make_list(10, 20, 30.5, result: :obj)
+    assert_kind_of Teek::TclObj, obj
+    assert_equal "10 20 30.5", obj.to_s
+    assert_equal [10, 20, 30.5], Teek.split_list(obj)
+    assert_equal Teek.make_list(obj, 1), "{10 20 30.5} 1"
+    assert_raises(ArgumentError) { Teek.make_list(1, result: :int) }
   end
 
   def test_make_list_bad_arg_after_good
     # First arg valid, second bad — must not leak Tcl objects or crash
-    assert_raises(TypeError) { Teek.make_list("good", 42) }
+    assert_raises(ArgumentError) { Teek.make_list("good", [1, proc {}]) }
   end
 
   def test_make_list_null_bytes
@@ -95,10 +159,82 @@ class TestListOps < Minitest::Test
     assert_equal [long], Teek.split_list(Teek.make_list(long))
   end
 
+  # -- Threads and Ractors -----------------------------------------------
+
+  def test_conversions_from_threads
+    results = 4.times.map { |i|
+      Thread.new do
+        200.times.map do |n|
+          list = Teek.make_list(i, n, ["x y", :z])
+          [Teek.split_list(list, deep: 1), Teek.tcl_to_bool(n.odd? ? "yes" : "off")]
+        end
+      end
+    }.map(&:value)
+
+    results.each_with_index do |rows, i|
+      assert_equal 200, rows.size
+      rows.each_with_index do |(list, bool), n|
+        assert_equal [i.to_s, n.to_s, ["x y", "z"]], list
+        assert_equal n.odd?, bool
+      end
+    end
+  end
+
+  def test_conversion_errors_from_thread
+    errors = Thread.new {
+      [-> { Teek.split_list('{"unclosed') },
+       -> { Teek.split_dict('a b c') },
+       -> { Teek.tcl_to_bool('maybe') }].map do |op|
+        op.call
+      rescue Teek::TclError => e
+        e.message
+      end
+    }.value
+
+    assert_match(/\Ainvalid Tcl list: .*unmatched open brace/, errors[0])
+    assert_match(/\Ainvalid Tcl dict: .*missing value/, errors[1])
+    assert_match(/expected boolean value but got "maybe"/, errors[2])
+  end
+
+  def test_conversions_in_ractor
+    skip "Ractor not available" unless defined?(Ractor)
+    with_ractor_warnings_off do
+      r = Ractor.new { [Teek.make_list(1, [2, "a b"]), Teek.split_list("x {y z}", deep: true)] }
+      assert_equal ["1 {2 {a b}}", ["x", ["y", "z"]]], ractor_result(r)
+    end
+  end
+
+  def test_interp_is_main_ractor_only
+    skip "Ractor not available" unless defined?(Ractor)
+    with_ractor_warnings_off do
+      r = Ractor.new do
+        Teek::Interp.new
+      rescue Ractor::UnsafeError => e
+        e.class.name
+      end
+      assert_equal "Ractor::UnsafeError", ractor_result(r)
+    end
+  end
+
   # -- Round-trip --------------------------------------------------------
 
   def test_round_trip
     inputs = ["hello world", "foo{bar}", 'back\\slash', "", "simple"]
     assert_equal inputs, Teek.split_list(Teek.make_list(*inputs))
   end
+
+  private
+
+  def with_ractor_warnings_off
+    saved = Warning[:experimental]
+    Warning[:experimental] = false
+    yield
+  ensure
+    Warning[:experimental] = saved
+  end
+
+  # Ractor#take was replaced by Ractor#value in Ruby 3.5
+  def ractor_result(ractor)
+    ractor.respond_to?(:value) ? ractor.value : ractor.take
+  end
 end
@@ -0,0 +1,75 @@
+# frozen_string_literal: true
+
+# Tests for the result: keyword on tcl_eval / tcl_invoke.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestResultTypes < Minitest::Test
+  include TeekTestHelper
+
+  def test_default_is_string
+    assert_tk_app("results should be Strings by default") do
+      assert_equal "42", app.tcl_eval('expr {6*7}')
+      assert_equal "a {b c}", app.tcl_invoke('list', 'a', 'b c')
+    end
+  end
+
+  def test_list_result
+    assert_tk_app("result: :list should return an Array of Strings") do
+      app.command('ttk::frame', '.f1')
+      app.command('ttk::frame', '.f2')
+      children = app.tcl_eval('winfo children .', result: :list)
+      assert_includes children, '.f1'
+      assert_includes children, '.f2'
+      assert_equal ['a', 'b c'], app.tcl_invoke('list', 'a', 'b c', result: :list)
+    end
+  end
+
+  def test_scalar_results
+    assert_tk_app("result: :int/:double/:bool should convert scalars") do
+      assert_equal 42, app.tcl_eval('expr {6*7}', result: :int)
+      assert_in_delta 0.5, app.tcl_eval('expr {1/2.0}', result: :double)
+      assert_equal true, app.tcl_invoke('set', 'flag', 'yes', result: :bool)
+      assert_equal false, app.tcl_invoke('set', 'flag', '0', result: :bool)
+    end
+  end
+
+  def test_dict_result
+    assert_tk_app("result: :dict should return a Hash") do
+      assert_equal({ 'a' => '1', 'b' => '2 3' },
+                   app.tcl_eval('dict create a 1 b {2 3}', result: :dict))
+    end
+  end
+
+  def test_auto_result_uses_internal_rep
+    assert_tk_app("result: :auto should follow the object's internal rep") do
+      # Reps come from the commands that build each value, not from how
+      # the bytecode compiler happens to type a literal (8.6 and 9 differ)
+      assert_equal 42, app.tcl_eval('expr {6*7}', result: :auto)
+      assert_equal [1, 2, 3],
+                   app.tcl_eval('list [expr {1}] [expr {2}] [expr {3}]', result: :auto)
+      assert_equal ['abc', 2.5, ['x', 'y']],
+                   app.tcl_eval('list abc [expr {2.5}] [list x y]', result: :auto)
+      assert_equal "plain", app.tcl_eval('string cat plain', result: :auto)
+    end
+  end
+
+  def test_unparseable_result_raises
+    assert_tk_app("a result that doesn't parse should raise TclError") do
+      assert_raises(Teek::TclError) { app.tcl_eval('set s abc', result: :int) }
+      assert_raises(Teek::TclError) { app.tcl_eval('set s "a {"', result: :list) }
+      assert_raises(ArgumentError) { app.tcl_eval('set s a', result: :nope) }
+    end
+  end
+
+  def test_result_mode_from_background_thread
+    assert_tk_app("result: should apply to calls queued from a background thread") do
+      value = nil
+      t = Thread.new { value = app.tcl_invoke('list', '1', '2', result: :list) }
+      app.update until !t.alive?
+      t.join
+      assert_equal ['1', '2'], value
+    end
+  end
+end
@@ -0,0 +1,56 @@
+# frozen_string_literal: true
+
+# Tests for App#compile / Teek::Script - reusable compiled scripts.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestScript < Minitest::Test
+  include TeekTestHelper
+
+  def test_compiled_script_runs_repeatedly
+    assert_tk_app("a compiled script should evaluate on every call") do
+      app.tcl_eval('set ::script_counter 0')
+      script = app.compile("incr ::script_counter\nset ::script_counter")
+      assert_equal "1", script.call
+      assert_equal "2", script.call
+      assert_equal 3, script.call(result: :int)
+    end
+  end
+
+  def test_params_bind_arguments
+    assert_tk_app("params: should bind call arguments") do
+      add = app.compile('expr {$a + $b}', params: [:a, :b])
+      assert_equal ['a', 'b'], add.params
+      assert_equal "3", add.call(1, 2)
+      assert_equal 5.5, add.call(2.5, 3, result: :auto)
+      assert_equal "3", app.compile('llength $l', params: ['l']).call([1, [2, 3], 'a b'])
+    end
+  end
+
+  def test_wrong_arity_raises
+    assert_tk_app("calling with the wrong number of args should raise") do
+      add = app.compile('expr {$a + $b}', params: [:a, :b])
+      assert_raises(Teek::TclError) { add.call(1) }
+      assert_raises(ArgumentError) { app.compile('set x 1').call(1) }
+    end
+  end
+
+  def test_error_raises_tcl_error
+    assert_tk_app("a failing script should raise TclError") do
+      err = assert_raises(Teek::TclError) { app.compile('error boom').call }
+      assert_equal "boom", err.message
+    end
+  end
+
+  def test_call_from_background_thread
+    assert_tk_app("a script should be callable from a background thread") do
+      double = app.compile('expr {$x * 2}', params: [:x])
+      result = nil
+      t = Thread.new { result = double.call(21) }
+      app.update until !t.alive?
+      t.join
+      assert_equal "42", result
+    end
+  end
+end
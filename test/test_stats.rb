@@ -0,0 +1,146 @@
+# frozen_string_literal: true
+
+# Tests for App#stats / Interp#stats - event loop instrumentation.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestStats < Minitest::Test
+  include TeekTestHelper
+
+  def test_snapshot_shape
+    assert_tk_app("stats should return a Hash snapshot of the counters") do
+      s = app.stats
+      assert_kind_of Integer, s[:iterations]
+      assert_equal %i[window timer_file idle cross_thread], s[:events].keys
+      assert_equal s[:events].keys, s[:event_us].keys
+      assert_equal %i[event callback queue_wait], s[:histograms].keys
+      s[:histograms].each_value do |hist|
+        assert_equal Teek::Stats::HISTOGRAM_BUCKETS, hist.size
+      end
+      assert_kind_of Integer, s[:queue_depth]
+    end
+  end
+
+  def test_counts_callbacks_by_id
+    assert_tk_app("ruby_callback should be timed per callback id") do
+      app.reset_stats
+      id = app.register_callback(proc { sleep 0.002 })
+      3.times { app.tcl_eval("ruby_callback #{id}") }
+
+      s = app.stats
+      entry = s[:callbacks][id]
+      assert_equal 3, entry[:calls]
+      assert_operator entry[:max_us], :>=, 1500
+      assert_operator entry[:total_us], :>=, entry[:max_us]
+      assert_equal 3, s[:callback_calls]
+      assert_equal 3, s[:histograms][:callback].sum
+    end
+  end
+
+  def test_counts_event_kinds
+    assert_tk_app("do_one_event should classify what it handled") do
+      app.update
+      app.reset_stats
+      app.tcl_eval('after idle {set ::stats_idle 1}')
+      app.tcl_eval('after 0 {set ::stats_timer 1}')
+      20.times { app.interp.do_one_event(Teek::ALL_EVENTS | Teek::DONT_WAIT) }
+
+      s = app.stats
+      assert_equal 20, s[:iterations]
+      assert_operator s[:events][:idle], :>=, 1
+      assert_operator s[:events][:timer_file], :>=, 1
+    end
+  end
+
+  def test_cross_thread_requests_counted
+    assert_tk_app("background requests should show up as cross_thread events") do
+      app.reset_stats
+      t = Thread.new { 5.times { app.tcl_eval('set ::stats_bg 1') } }
+      app.interp.do_one_event(Teek::ALL_EVENTS | Teek::DONT_WAIT) while t.alive?
+      t.join
+
+      s = app.stats
+      assert_operator s[:events][:cross_thread], :>=, 1
+      assert_equal 5, s[:histograms][:queue_wait].sum
+    end
+  end
+
+  def test_reset_stats
+    assert_tk_app("reset_stats should zero the counters") do
+      id = app.register_callback(proc { })
+      app.tcl_eval("ruby_callback #{id}")
+      app.update
+      app.reset_stats
+
+      s = app.stats
+      assert_equal 0, s[:iterations]
+      assert_equal 0, s[:callback_calls]
+      assert_empty s[:callbacks]
+      assert_equal 0, s[:histograms][:callback].sum
+    end
+  end
+
+  def test_callback_top
+    assert_tk_app("callback_top should rank callbacks by the chosen counter") do
+      app.reset_stats
+      slow = app.register_callback(proc { sleep 0.005 })
+      fast = app.register_callback(proc { })
+      bad = app.register_callback(proc { raise 'boom' })
+      app.tcl_eval("ruby_callback #{slow}")
+      5.times { app.tcl_eval("ruby_callback #{fast}") }
+      2.times { app.tcl_eval("catch {ruby_callback #{bad}}") }
+
+      top = app.callback_top(10)
+      assert_equal slow, top.first[:id]
+      assert_equal [fast, bad, slow], app.callback_top(3, by: :calls).map { |r| r[:id] }
+      assert_equal bad, app.callback_top(1, by: :errors).first[:id]
+      assert_equal 2, app.callback_top(1, by: :errors).first[:errors]
+      assert_equal 1, app.callback_top(1).size
+      assert_raises(ArgumentError) { app.callback_top(1, by: :bogus) }
+    end
+  end
+
+  def test_callback_site
+    assert_tk_app("register_callback, bind and after should record the caller") do
+      app.reset_stats
+      id = app.register_callback(proc { })
+      app.tcl_eval("ruby_callback #{id}")
+      site = app.stats[:callbacks][id][:site]
+      assert_match(/test_stats\.rb:\d+\z/, site)
+
+      ticks = 0
+      timer = app.every(1) { ticks += 1 }
+      deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+      until ticks > 0 || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+        app.update
+        sleep 0.005
+      end
+      assert ticks > 0, "repeating timer did not fire"
+      row = app.callback_top(10).find { |r| r[:id] == timer.timer.callback_id }
+      timer.cancel
+      assert_match(/test_stats\.rb:\d+\z/, row[:site])
+
+      # A one-shot timer's slot is gone once it has run; its stats stay
+      # under the site that created it
+      app.after(0) { }
+      app.update
+      row = app.callback_top(10).find { |r| r[:id].nil? }
+      assert_match(/test_stats\.rb:\d+\z/, row[:site])
+      assert_equal 1, row[:calls]
+      assert_equal row[:site], app.stats[:retired_callbacks][row[:site]][:site]
+    end
+  end
+
+  def test_percentile
+    assert_tk_app("Stats.percentile should return the bucket upper bound") do
+      hist = [0] * Teek::Stats::HISTOGRAM_BUCKETS
+      assert_nil Teek::Stats.percentile(hist, 50)
+      hist[3] = 90   # 8...16us
+      hist[10] = 10  # 1024...2048us
+      assert_equal 16, Teek::Stats.percentile(hist, 50)
+      assert_equal 2048, Teek::Stats.percentile(hist, 99)
+      assert_raises(ArgumentError) { Teek::Stats.percentile(hist, 101) }
+    end
+  end
+end
@@ -0,0 +1,68 @@
+# frozen_string_literal: true
+
+# Tests for Teek::TclObj - persistent Tcl_Obj handles.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestTclObj < Minitest::Test
+  include TeekTestHelper
+
+  def test_list_handle_keeps_list_rep
+    assert_tk_app("a TclObj built from an Array should stay a list") do
+      pts = Teek::TclObj.new((1..10).to_a)
+      assert_equal "list", pts.type
+      assert_equal 10, pts.length
+      assert_equal "10", app.tcl_invoke('llength', pts)
+      assert_equal "list", pts.type
+      assert_equal [1, 2, 3], pts.value.first(3)
+    end
+  end
+
+  def test_handle_as_argument_and_command_word
+    assert_tk_app("TclObj should work as an argument and as the command word") do
+      coords = Teek::TclObj.new([10, 10, 50, 50])
+      app.command(:canvas, '.c')
+      item = app.command('.c', :create, :line, coords)
+      assert_equal "10.0 10.0 50.0 50.0", app.command('.c', :coords, item)
+
+      cmd = Teek::TclObj.new('lindex')
+      assert_equal "50", app.command(cmd, coords, 3)
+      assert_equal "10", app.command(cmd, coords, 0)
+    end
+  end
+
+  def test_handle_in_batch
+    assert_tk_app("TclObj should be accepted by batch") do
+      list = Teek::TclObj.new(%w[a b c])
+      results = app.batch do |b|
+        b.invoke('llength', list)
+        b.command(:lindex, list, 1)
+      end
+      assert_equal ["3", "b"], results
+    end
+  end
+
+  def test_obj_result_mode
+    assert_tk_app("result: :obj should return a TclObj") do
+      obj = app.tcl_eval('lsort -integer {3 1 2}', result: :obj)
+      assert_kind_of Teek::TclObj, obj
+      assert_equal [1, 2, 3], obj.value
+      assert_equal "1 2 3", obj.to_s
+    end
+  end
+
+  def test_proc_is_rejected
+    assert_tk_app("TclObj.new should reject Procs") do
+      assert_raises(ArgumentError) { Teek::TclObj.new(proc {}) }
+    end
+  end
+
+  def test_use_from_other_thread_raises
+    assert_tk_app("a TclObj should only be usable on its owning thread") do
+      obj = Teek::TclObj.new("x")
+      err = Thread.new { obj.to_s rescue $! }.value
+      assert_kind_of Teek::TclError, err
+    end
+  end
+end
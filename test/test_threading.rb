@@ -95,4 +95,144 @@ class TestThreading < Minitest::Test
       assert_equal "hello from tcl", result
     end
   end
+
+  def test_background_request_burst
+    assert_tk_app("Bursts of background requests should all run in order") do
+      app.tcl_eval("set ::burst {}")
+      threads = 4.times.map do |k|
+        Thread.new { 500.times { |j| app.tcl_eval("lappend ::burst #{k}.#{j}") } }
+      end
+
+      start = Time.now
+      while threads.any?(&:alive?) && Time.now - start < 10
+        app.update
+        Thread.pass
+      end
+      threads.each(&:join)
+
+      values = app.tcl_eval("set ::burst").split
+      assert_equal 2000, values.size
+      4.times do |k|
+        mine = values.select { |v| v.start_with?("#{k}.") }
+        assert_equal 500.times.map { |j| "#{k}.#{j}" }, mine, "requests from one thread reordered"
+      end
+    end
+  end
+
+  def test_background_request_error_raised_in_thread
+    assert_tk_app("Errors from a background request should raise in the calling thread") do
+      t = Thread.new do
+        app.tcl_eval("error boom")
+      rescue Teek::TclError => e
+        e.message
+      end
+
+      start = Time.now
+      while t.alive? && Time.now - start < 5
+        app.update
+        Thread.pass
+      end
+
+      assert_equal "boom", t.value
+      assert_equal "4", app.tcl_eval("expr {2 + 2}")
+    end
+  end
+
+  def test_killed_waiter_does_not_block_queue
+    assert_tk_app("A killed waiting thread should not wedge later requests") do
+      t = Thread.new { app.tcl_eval("set ::abandoned 1") }
+      sleep 0.05
+      t.kill
+      t.join
+
+      t2 = Thread.new { app.tcl_eval("expr {6 * 7}") }
+      start = Time.now
+      while t2.alive? && Time.now - start < 5
+        app.update
+        Thread.pass
+      end
+
+      assert_equal "42", t2.value
+      assert_equal "1", app.tcl_eval("set ::abandoned")
+    end
+  end
+
+  def test_thread_queue_stats
+    assert_tk_app("thread_queue_stats should count background requests") do
+      interp = app.interp
+      interp.reset_thread_queue_stats
+      t = Thread.new { 200.times { |j| app.tcl_eval("set ::stat_v #{j}") } }
+
+      start = Time.now
+      while t.alive? && Time.now - start < 5
+        app.update
+        Thread.pass
+      end
+      t.join
+
+      stats = interp.thread_queue_stats
+      assert_equal 0, stats[:depth]
+      assert_equal 200, stats[:requests]
+      assert_operator stats[:drains], :>=, 1
+      assert_operator stats[:high_water], :>=, 1
+      assert_operator stats[:wait_us_total], :>=, stats[:wait_us_max]
+
+      interp.reset_thread_queue_stats
+      assert_equal 0, interp.thread_queue_stats[:requests]
+    end
+  end
+
+  def test_thread_drain_budget_ms
+    assert_tk_app("thread_drain_budget_ms should be adjustable and validated") do
+      interp = app.interp
+      assert_equal 8, interp.thread_drain_budget_ms
+
+      interp.thread_drain_budget_ms = 1
+      count = 0
+      50.times { interp.queue_for_main(proc { count += 1; sleep 0.001 }) }
+
+      start = Time.now
+      app.update while count < 50 && Time.now - start < 5
+
+      assert_equal 50, count
+      assert_operator interp.thread_queue_stats[:budget_yields], :>=, 1
+      assert_raises(ArgumentError) { interp.thread_drain_budget_ms = -1 }
+    end
+  end
+
+  def test_mainloop_mode_validation
+    assert_tk_app("mainloop_mode should accept :timer and :event only") do
+      interp = app.interp
+      assert_equal :timer, interp.mainloop_mode
+      interp.mainloop_mode = :event
+      assert_equal :event, interp.mainloop_mode
+      interp.mainloop_mode = :timer
+      assert_raises(ArgumentError) { interp.mainloop_mode = :poll }
+    end
+  end
+
+  def test_event_driven_mainloop_serves_background_threads
+    assert_tk_subprocess("event-driven mainloop should run requests and callbacks") do
+      <<~RUBY
+        require 'teek'
+        app = Teek::App.new
+        app.interp.mainloop_mode = :event
+        app.tcl_eval("after 10000 {destroy .}")  # watchdog
+
+        fired = false
+        app.after(20) { fired = true }
+        results = []
+        Thread.new do
+          sleep 0.1
+          results << app.tcl_eval("expr {1 + 1}")
+          results << app.tcl_eval_async("expr {2 * 3}", result: :int).value
+          app.tcl_eval("after 0 {destroy .}")
+        end
+        app.mainloop
+
+        raise "timer callback didn't fire" unless fired
+        raise "got \#{results.inspect}" unless results == ["2", 6]
+      RUBY
+    end
+  end
 end
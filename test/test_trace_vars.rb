@@ -0,0 +1,121 @@
+# frozen_string_literal: true
+
+# Tests for App#trace_vars / Interp#trace_vars - batched variable change
+# notifications from C-level Tcl traces.
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestTraceVars < Minitest::Test
+  include TeekTestHelper
+
+  def test_changes_batched_per_idle
+    assert_tk_app("writes between idles should arrive as one coalesced batch") do
+      app.tcl_eval('set ::tv_a 0; set ::tv_b 0; set ::other 0')
+      batches = []
+      trace = app.trace_vars('tv_*') { |changes| batches << changes }
+
+      100.times { |i| app.tcl_eval("set ::tv_a #{i}") }
+      app.tcl_eval('set ::tv_b x; set ::other 1')
+      app.update
+
+      assert_equal 1, batches.size
+      assert_equal [['tv_a', nil, '99'], ['tv_b', nil, 'x']], batches.first
+      assert_equal 2, trace.size
+      trace.cancel
+    end
+  end
+
+  def test_array_elements_and_unset
+    assert_tk_app("array elements and unsets should be reported") do
+      app.tcl_eval('array set ::tv_arr {x 1 y 2}; set ::tv_s 1')
+      got = []
+      trace = app.trace_vars('tv_*') { |changes| got.concat(changes) }
+
+      app.tcl_eval('set ::tv_arr(x) 10; unset ::tv_arr(y); unset ::tv_s')
+      app.update
+
+      assert_includes got, ['tv_arr', 'x', '10']
+      assert_includes got, ['tv_arr', 'y', nil]
+      assert_includes got, ['tv_s', nil, nil]
+      assert_equal 1, trace.size
+      trace.cancel
+    end
+  end
+
+  def test_read_trace_writing_traced_vars
+    assert_tk_app("writes made by read traces during a flush should come next batch") do
+      app.tcl_eval('set ::tv_a 1; array set ::tv_arr {x 1 y 2}')
+      app.tcl_eval('trace add variable ::tv_a read {apply {args {
+        for {set k 0} {$k < 100} {incr k} { set ::tv_arr(n$k) $k }
+        unset -nocomplain ::tv_arr(y)
+      }}}')
+      batches = []
+      trace = app.trace_vars('tv_*') { |changes| batches << changes }
+
+      app.tcl_eval('set ::tv_a 2; set ::tv_arr(x) 5')
+      app.update
+
+      assert_equal [['tv_a', nil, '2'], ['tv_arr', 'x', '5']], batches[0]
+      assert_equal 101, batches[1].size
+      assert_includes batches[1], ['tv_arr', 'y', nil]
+      trace.cancel
+    end
+  end
+
+  def test_rescan_picks_up_new_variables
+    assert_tk_app("rescan should trace globals created after trace_vars") do
+      got = []
+      trace = app.trace_vars('tv_*') { |changes| got.concat(changes) }
+      app.tcl_eval('set ::tv_new 1')
+      app.update
+      assert_empty got
+
+      assert_equal 1, trace.rescan
+      assert_equal 0, trace.rescan
+      app.update
+      assert_equal [['tv_new', nil, '1']], got
+
+      app.tcl_eval('set ::tv_new 2')
+      app.update
+      assert_equal ['tv_new', nil, '2'], got.last
+      trace.cancel
+    end
+  end
+
+  def test_cancel
+    assert_tk_app("cancel should stop notifications") do
+      app.tcl_eval('set ::tv_c 0')
+      got = []
+      trace = app.trace_vars('tv_c') { |changes| got.concat(changes) }
+      app.tcl_eval('set ::tv_c 1')
+      trace.cancel
+      app.update
+
+      assert_empty got
+      refute trace.active?
+      assert_nil trace.pattern
+      trace.cancel # idempotent
+      assert_raises(Teek::TclError) { trace.rescan }
+    end
+  end
+
+  def test_block_error_goes_to_bgerror
+    assert_tk_app("errors in the block should reach the background error handler") do
+      app.tcl_eval('set ::tv_e 0')
+      app.tcl_eval('proc tv_bgerror {msg opts} { set ::tv_bgerror $msg }')
+      saved = app.tcl_eval('interp bgerror {}')
+      app.tcl_eval('interp bgerror {} tv_bgerror')
+      begin
+        trace = app.trace_vars('tv_e') { raise 'trace boom' }
+        app.tcl_eval('set ::tv_e 1')
+        app.update
+
+        assert_equal 'trace boom', app.tcl_eval('set ::tv_bgerror')
+      ensure
+        trace&.cancel
+        app.tcl_eval("interp bgerror {} #{Teek.make_list(saved)}")
+      end
+    end
+  end
+end
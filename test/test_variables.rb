@@ -44,4 +44,56 @@ class TestVariables < Minitest::Test
       assert_equal '42', app.set_variable('rv', '42')
     end
   end
+
+  def test_set_and_get_variables_in_bulk
+    assert_tk_app("set_variables/get_variables should handle many keys at once") do
+      values = (1..300).to_h { |i| ["bulk_#{i}", "v#{i}"] }
+      app.set_variables(values)
+      assert_equal values, app.get_variables(values.keys)
+      assert_equal 'v150', app.get_variable('bulk_150')
+    end
+  end
+
+  def test_bulk_element_keys_and_missing
+    assert_tk_app("[name, index] keys should address array elements") do
+      app.set_variables(['form', 'email'] => 'ada@example.com', 'count' => 3, 'items' => ['a b', 'c'])
+      result = app.get_variables([['form', 'email'], 'count', 'items', 'nope', ['form', 'nope']])
+
+      assert_equal({ ['form', 'email'] => 'ada@example.com', 'count' => '3',
+                     'items' => '{a b} c', 'nope' => nil, ['form', 'nope'] => nil }, result)
+      assert_equal 'ada@example.com', app.tcl_eval('set form(email)')
+    end
+  end
+
+  def test_array_get_and_set
+    assert_tk_app("array_get/array_set should round-trip a Tcl array") do
+      app.array_set('cfg', 'host' => 'localhost', 'port' => 8080, 'odd key(1)' => 'x')
+      assert_equal({ 'host' => 'localhost', 'port' => '8080', 'odd key(1)' => 'x' }, app.array_get('cfg'))
+      assert_equal '1', app.tcl_eval('array exists cfg')
+      assert_equal({}, app.array_get('no_such_array'))
+    end
+  end
+
+  def test_set_variables_error
+    assert_tk_app("set_variables should raise on a refused write") do
+      app.set_variable('scalar', '1')
+      assert_raises(Teek::TclError) { app.set_variables(['scalar', 'x'] => 1) }
+      assert_raises(TypeError) { app.get_variables([42]) }
+    end
+  end
+
+  def test_bulk_from_background_thread
+    assert_tk_app("bulk variable calls should work from a background thread") do
+      t = Thread.new {
+        app.set_variables('bg_a' => 1, 'bg_b' => 2)
+        app.get_variables(%w[bg_a bg_b])
+      }
+      start = Time.now
+      while t.alive? && Time.now - start < 10
+        app.update
+        Thread.pass
+      end
+      assert_equal({ 'bg_a' => '1', 'bg_b' => '2' }, t.value)
+    end
+  end
 end
@@ -0,0 +1,208 @@
+# frozen_string_literal: true
+
+require 'minitest/autorun'
+require_relative 'tk_test_helper'
+
+class TestWatchIO < Minitest::Test
+  include TeekTestHelper
+
+  def setup
+    skip "watch_io needs Tcl file handlers (not on Windows)" if Gem.win_platform?
+  end
+
+  def test_fires_when_pipe_is_readable
+    assert_tk_app("watch_io should call the block when data arrives") do
+      r, w = IO.pipe
+      begin
+        got = []
+        watch = app.watch_io(r) { |io, ready| got << [io.read_nonblock(100), ready] }
+        assert_kind_of Teek::IOWatch, watch
+        assert_equal IO::READABLE, watch.events
+
+        app.update
+        assert_empty got, "fired before anything was written"
+
+        w.write "hello"
+        deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+        until got.any? || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+          app.update
+          sleep 0.01
+        end
+
+        assert_equal [["hello", IO::READABLE]], got
+        assert_equal 1, watch.calls
+        assert watch.active?
+        watch.cancel
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_cancel_stops_watching
+    assert_tk_app("IOWatch#cancel should stop the block") do
+      r, w = IO.pipe
+      begin
+        fired = 0
+        watch = app.watch_io(r) { fired += 1 }
+        watch.cancel
+        watch.cancel
+        refute watch.active?
+        assert watch.cancelled?
+        assert_nil watch.callback_id
+
+        w.write "x"
+        5.times { app.update; sleep 0.01 }
+        assert_equal 0, fired
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_read_and_write_watches_share_descriptor
+    assert_tk_app("watches on one descriptor should each get their events") do
+      r, w = IO.pipe
+      begin
+        seen = []
+        reader = app.watch_io(r, :read) { |io| seen << :read; io.read_nonblock(100) }
+        writer = app.watch_io(w, :write) { |_io, ready| seen << ready; writer.cancel }
+        second = app.watch_io(r, [:read]) { seen << :second; second.cancel }
+
+        w.write "x"
+        deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+        until seen.size >= 3 || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+          app.update
+          sleep 0.01
+        end
+
+        assert_includes seen, :read
+        assert_includes seen, :second
+        assert_includes seen, IO::WRITABLE
+        refute writer.active?
+        refute second.active?
+        assert reader.active?
+        reader.cancel
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_update_inside_block_does_not_reenter
+    assert_tk_app("a block calling update before reading should not recurse") do
+      r, w = IO.pipe
+      begin
+        depth = max_depth = 0
+        watch = app.watch_io(r) do |io|
+          depth += 1
+          max_depth = [max_depth, depth].max
+          app.update
+          io.read_nonblock(100)
+          depth -= 1
+        end
+        w.write "x"
+        10.times { app.update; sleep 0.01 }
+
+        assert_equal 1, max_depth
+        assert_equal 1, watch.calls
+        assert watch.active?
+        watch.cancel
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_closed_io_ends_watch
+    assert_tk_app("closing a watched IO should release the watch, not hang") do
+      r, w = IO.pipe
+      begin
+        watch = app.watch_io(r) { flunk "called for a closed IO" }
+        w.write "x"
+        r.close
+
+        deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+        while watch.active? && Process.clock_gettime(Process::CLOCK_MONOTONIC) < deadline
+          app.update
+          sleep 0.01
+        end
+
+        refute watch.active?
+        assert_nil watch.callback_id
+      ensure
+        r.close unless r.closed?
+        w.close
+      end
+    end
+  end
+
+  def test_exception_ends_watch
+    assert_tk_app("an exception from the block should end the watch") do
+      r, w = IO.pipe
+      begin
+        watch = app.watch_io(r) { raise "boom" }
+        w.write "x"
+
+        caught = nil
+        deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+        until caught || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+          begin
+            app.update
+          rescue RuntimeError => e
+            caught = e
+          end
+          sleep 0.01
+        end
+
+        assert_equal "boom", caught&.message
+        refute watch.active?
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_on_error_proc_keeps_watching
+    assert_tk_app("an on_error handler should keep the watch alive") do
+      r, w = IO.pipe
+      begin
+        errors = []
+        watch = app.watch_io(r, on_error: ->(e) { errors << e.message; r.read_nonblock(100) }) do
+          raise "soft"
+        end
+        w.write "x"
+        deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 2.0
+        until errors.any? || Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+          app.update
+          sleep 0.01
+        end
+
+        assert_equal ["soft"], errors
+        assert watch.active?
+        watch.cancel
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+
+  def test_bad_events_raise
+    assert_tk_app("unknown events should raise ArgumentError") do
+      r, w = IO.pipe
+      begin
+        assert_raises(ArgumentError) { app.watch_io(r, :bogus) {} }
+        assert_raises(ArgumentError) { app.watch_io(r, 0) {} }
+      ensure
+        r.close
+        w.close
+      end
+    end
+  end
+end
@@ -33,6 +33,67 @@ class TestWidgetTracking < Minitest::Test
     end
   end
 
+  def test_tracks_parent_and_child_destroy
+    assert_tk_app("destroying a parent drops its children") do
+      app.command('ttk::frame', ".f")
+      app.command('ttk::button', ".f.b", text: "x")
+      app.command(:toplevel, ".t")
+
+      assert_equal({ class: "TFrame", parent: "." }, app.widgets[".f"])
+      assert_equal({ class: "TButton", parent: ".f" }, app.widgets[".f.b"])
+      assert_equal "Toplevel", app.widgets[".t"][:class]
+      assert app.widget_tracked?(".f.b")
+
+      app.destroy(".f")
+      refute app.widget_tracked?(".f")
+      refute app.widget_tracked?(".f.b")
+      assert_equal [".t"], app.widgets.keys
+    end
+  end
+
+  def test_failed_create_not_tracked
+    assert_tk_app("a widget command that fails is not tracked") do
+      app.command(:button, ".b")
+      assert_raises(Teek::TclError) { app.command(:button, ".b") }
+      assert_raises(Teek::TclError) { app.command(:button, ".nope.b") }
+      assert_equal [".b"], app.widgets.keys
+    end
+  end
+
+  def test_track_widgets_twice_does_not_stack
+    assert_tk_app("repeated track_widgets installs one trace per command") do
+      app.interp.track_widgets(%w[button no_such_command])
+      traces = app.tcl_eval('trace info execution button')
+      assert_equal 1, traces.scan('teek_track_widget').size
+    end
+  end
+
+  def test_on_widget_change_batches
+    assert_tk_app("on_widget_change reports changes once per idle") do
+      batches = []
+      app.interp.on_widget_change { |changes| batches << changes }
+      begin
+        app.command(:frame, ".f")
+        app.command(:label, ".f.l")
+        app.destroy(".f")
+        assert_empty batches
+        app.update
+
+        assert_equal 1, batches.size
+        assert_equal [[:created, ".f", "Frame"], [:created, ".f.l", "Label"]],
+                     batches[0].first(2)
+        assert_equal [[:destroyed, ".f", nil], [:destroyed, ".f.l", nil]].sort,
+                     batches[0].drop(2).sort
+      ensure
+        app.interp.on_widget_change
+      end
+
+      app.command(:frame, ".g")
+      app.update
+      assert_equal 1, batches.size
+    end
+  end
+
   def test_tracking_disabled
     assert_tk_app("should not track when disabled") do
       app2 = Teek::App.new(track_widgets: false)